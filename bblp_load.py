@@ -0,0 +1,445 @@
+"""Headless MQTT load generator / replay tool for BLFLC benchmarks.
+
+Publishes printer reports to a local TLS broker (the one BLFLC is pointed at
+instead of a printer) at a fixed rate and reads the firmware counters from
+/api/metrics before and after each run, so report throughput and
+report-to-LED latency can be measured repeatably without a printer.
+
+    python bblp_load.py --device http://blflc.local --scenario lifecycle --rate 50 --duration 20
+    python bblp_load.py --device http://blflc.local --scenario hms-storm --sweep 1,10,50,100,200
+    python bblp_load.py --device http://blflc.local --replay capture.jsonl --rate 0
+
+Scenarios: lifecycle, hms-storm, pushall, door-flap, or a recording
+(--replay): a JSON lines file (one report per line, or
+{"t": seconds, "payload": {...}} per line) or a capture.bin downloaded from
+the device. --rate 0 keeps the recorded timing.
+"""
+
+import argparse
+import base64
+import itertools
+import json
+import random
+import ssl
+import struct
+import sys
+import threading
+import time
+import urllib.request
+
+import paho.mqtt.client as mqtt
+
+# === Report scenarios ===
+# Every generator yields report payloads forever; the runner stops it.
+
+LIFECYCLE_STEPS = [
+    (1, "PREPARE"), (14, "RUNNING"), (8, "RUNNING"), (2, "RUNNING"),
+    (0, "RUNNING"), (10, "RUNNING"), (0, "RUNNING"), (16, "PAUSE"),
+    (0, "RUNNING"), (-1, "FINISH"), (-1, "IDLE"),
+]
+
+HMS_CODES = [
+    0x0300120000020001, 0x0C0003000003000B, 0x0700200000030001,
+    0x0300020000010001, 0x0300010000010007, 0x0600100000010004,
+    0x0500200000030001, 0x0800100000010001,
+]
+
+TRAY_COLORS = ["FF0000FF", "00FF00FF", "0000FFFF", "FFFFFFFF", "000000FF", "FFA500FF", "80008000", "00000000"]
+
+
+class PrinterState:
+    """What the simulated printer reports; ledctrl requests update the light."""
+
+    def __init__(self):
+        self.chamber_light = "on"
+        self.lock = threading.Lock()
+
+    def lights_report(self):
+        with self.lock:
+            return [{"node": "chamber_light", "mode": self.chamber_light}]
+
+
+def lifecycle(state):
+    # mc_percent and the layer move on every report so no two are identical
+    for n in itertools.count():
+        stage, gcode_state = LIFECYCLE_STEPS[(n // 20) % len(LIFECYCLE_STEPS)]
+        yield {"print": {
+            "command": "push_status",
+            "gcode_state": gcode_state,
+            "stg_cur": stage,
+            "mc_percent": n % 101,
+            "layer_num": n % 500,
+            "total_layer_num": 500,
+            "nozzle_temper": 215.0 + (n % 10) / 10,
+            "nozzle_target_temper": 220,
+            "bed_temper": 59.5 + (n % 5) / 10,
+            "bed_target_temper": 60,
+            "home_flag": 0,
+            "lights_report": state.lights_report(),
+        }}
+
+
+def hms_storm(state):
+    # A different set of HMS entries on every report
+    for n in itertools.count():
+        count = 1 + n % 4
+        hms = []
+        for i in range(count):
+            code = HMS_CODES[(n + i) % len(HMS_CODES)]
+            hms.append({"attr": (code >> 32) & 0xFFFFFFFF, "code": code & 0xFFFFFFFF})
+        yield {"print": {
+            "command": "push_status",
+            "gcode_state": "RUNNING",
+            "stg_cur": 0,
+            "mc_percent": n % 101,
+            "hms": hms,
+            "lights_report": state.lights_report(),
+        }}
+
+
+def pushall(state):
+    # Full status the way a printer answers a pushall: several KB with AMS data
+    for n in itertools.count():
+        units = []
+        for unit in range(4):
+            trays = []
+            for tray in range(4):
+                trays.append({
+                    "id": str(tray),
+                    "remain": random.randint(0, 100),
+                    "k": 0.02,
+                    "n": 1.0,
+                    "tag_uid": "0000000000000000",
+                    "tray_id_name": "A00-K0",
+                    "tray_info_idx": "GFA00",
+                    "tray_type": "PLA",
+                    "tray_sub_brands": "PLA Basic",
+                    "tray_color": TRAY_COLORS[(unit * 4 + tray + n) % len(TRAY_COLORS)],
+                    "tray_weight": "1000",
+                    "tray_diameter": "1.75",
+                    "tray_temp": "55",
+                    "tray_time": "8",
+                    "bed_temp_type": "1",
+                    "bed_temp": "35",
+                    "nozzle_temp_max": "230",
+                    "nozzle_temp_min": "190",
+                    "xcam_info": "000000000000000000000000",
+                    "tray_uuid": "00000000000000000000000000000000",
+                    "cols": [TRAY_COLORS[(unit + tray) % len(TRAY_COLORS)]],
+                    "ctype": 0,
+                })
+            units.append({"id": str(unit), "humidity": "4", "temp": "24.5", "tray": trays})
+        yield {"print": {
+            "command": "push_status",
+            "msg": 0,
+            "sequence_id": str(n),
+            "gcode_state": "RUNNING",
+            "stg_cur": 0,
+            "mc_percent": n % 101,
+            "mc_remaining_time": 120 - n % 120,
+            "layer_num": n % 500,
+            "total_layer_num": 500,
+            "nozzle_temper": 220.0,
+            "nozzle_target_temper": 220,
+            "bed_temper": 60.0,
+            "bed_target_temper": 60,
+            "home_flag": 0,
+            "hms": [],
+            "gcode_file": "/data/Metadata/plate_1.gcode",
+            "subtask_name": "benchmark",
+            "ams": {
+                "ams": units,
+                "ams_exist_bits": "f",
+                "tray_exist_bits": "ffff",
+                "tray_now": str(n % 16),
+                "tray_pre": "255",
+                "tray_tar": "255",
+                "version": n,
+            },
+            "vt_tray": {"id": "254", "tray_color": "FFFFFFFF", "tray_type": "PLA"},
+            "lights_report": state.lights_report(),
+            "upgrade_state": {"status": "IDLE", "progress": "", "message": ""},
+            "ipcam": {"ipcam_dev": "1", "ipcam_record": "enable", "timelapse": "disable"},
+        }}
+
+
+def door_flap(state):
+    # Door opens and closes on every report (home_flag bit 23)
+    for n in itertools.count():
+        yield {"print": {
+            "command": "push_status",
+            "gcode_state": "RUNNING",
+            "stg_cur": 0,
+            "mc_percent": (n // 2) % 101,
+            "home_flag": (1 << 23) if n % 2 else 0,
+            "lights_report": state.lights_report(),
+        }}
+
+
+SCENARIOS = {
+    "lifecycle": lifecycle,
+    "hms-storm": hms_storm,
+    "pushall": pushall,
+    "door-flap": door_flap,
+}
+
+
+CAPTURE_MAGIC = b"BLFCAP"
+
+
+def load_device_capture(data):
+    """capture.bin from the device: raw reports, replayed byte for byte."""
+    if data[6] != 1:
+        sys.exit(f"Unsupported capture format version {data[6]}")
+    entries = []
+    offset = 8
+    previous_us = None
+    t = 0.0
+    while offset + 8 <= len(data):
+        us, length = struct.unpack_from("<II", data, offset)
+        offset += 8
+        if previous_us is not None:
+            t += ((us - previous_us) & 0xFFFFFFFF) / 1e6  # The device clock wraps
+        previous_us = us
+        entries.append((t, data[offset:offset + length]))
+        offset += length
+    return entries
+
+
+def load_capture(path):
+    """Recorded reports as (seconds from start, payload) pairs."""
+    with open(path, "rb") as f:
+        if f.read(len(CAPTURE_MAGIC)) == CAPTURE_MAGIC:
+            f.seek(0)
+            return load_device_capture(f.read())
+
+    entries = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            item = json.loads(line)
+            if isinstance(item, dict) and "payload" in item:
+                entries.append((float(item.get("t", 0)), item["payload"]))
+            else:
+                entries.append((None, item))
+    return entries
+
+
+def replay(capture):
+    """Loop a capture; each pass is shifted by the length of the recording."""
+    span = max((t for t, _ in capture if t is not None), default=0) + 1
+    for n in itertools.count():
+        for t, payload in capture:
+            yield (t + n * span if t is not None else None), payload
+
+
+# === Firmware metrics ===
+
+def fetch_metrics(device, auth):
+    request = urllib.request.Request(device.rstrip("/") + "/api/metrics")
+    if auth:
+        request.add_header("Authorization", "Basic " + base64.b64encode(auth.encode()).decode())
+    with urllib.request.urlopen(request, timeout=5) as response:
+        return json.load(response)
+
+
+def counter_delta(before, after, *path):
+    a, b = after, before
+    for key in path:
+        a = a.get(key, {}) if isinstance(a, dict) else {}
+        b = b.get(key, {}) if isinstance(b, dict) else {}
+    a = a if isinstance(a, (int, float)) else 0
+    b = b if isinstance(b, (int, float)) else 0
+    return a - b
+
+
+def percentile_us(buckets, pct):
+    # Same log2 buckets as the firmware: bucket i counts [2^i, 2^(i+1)) us
+    total = sum(buckets)
+    if total == 0:
+        return 0
+    rank = (total * pct + 99) // 100
+    seen = 0
+    for i, count in enumerate(buckets):
+        seen += count
+        if seen >= rank:
+            return 1 << (i + 1)
+    return 1 << len(buckets)
+
+
+def latency_delta(before, after):
+    """Per stage latency of the reports sent during the run only."""
+    result = {}
+    for stage, item in after.get("latency", {}).items():
+        old = before.get("latency", {}).get(stage, {}).get("buckets", [0] * len(item["buckets"]))
+        buckets = [a - b for a, b in zip(item["buckets"], old)]
+        result[stage] = {
+            "count": sum(buckets),
+            "p50Us": percentile_us(buckets, 50),
+            "p99Us": percentile_us(buckets, 99),
+            "maxUs": item.get("maxUs", 0),
+        }
+    return result
+
+
+def summarize(sent, elapsed, before, after):
+    received = counter_delta(before, after, "ingest", "messages")
+    summary = {
+        "sent": sent,
+        "seconds": round(elapsed, 2),
+        "sentRate": round(sent / elapsed, 1) if elapsed else 0,
+    }
+    if after is None:
+        return summary
+    summary.update({
+        "received": received,
+        "lost": max(sent - received, 0),
+        "parseErrors": counter_delta(before, after, "ingest", "parseErrors"),
+        "duplicates": counter_delta(before, after, "ingest", "duplicates"),
+        "rawOverflows": counter_delta(before, after, "ingest", "rawOverflows"),
+        "largeReports": counter_delta(before, after, "ingest", "largeReports"),
+        "minFreeHeapDuringReport": after.get("ingest", {}).get("minFreeHeapDuringReport", 0),
+        "maxDispatchUs": after.get("mqttTask", {}).get("maxDispatchUs", 0),
+        "stateTransitions": counter_delta(before, after, "stateFilter", "committed"),
+        "droppedTransitions": counter_delta(before, after, "stateFilter", "dropped"),
+        "ledChanges": counter_delta(before, after, "stateFilter", "ledChanges"),
+        "relayDropped": counter_delta(before, after, "relay", "wsDropped")
+                        + counter_delta(before, after, "relay", "mqttDropped"),
+        "freeHeap": after.get("freeHeap", 0),
+        "latency": latency_delta(before, after),
+    })
+    return summary
+
+
+def print_summary(label, summary):
+    print(f"\n== {label} ==")
+    print(f"sent {summary['sent']} in {summary['seconds']} s ({summary['sentRate']} msg/s)")
+    if "received" not in summary:
+        return
+    print(f"received {summary['received']}, lost {summary['lost']}, parse errors {summary['parseErrors']}, "
+          f"duplicates {summary['duplicates']}, raw overflows {summary['rawOverflows']}")
+    print(f"state transitions {summary['stateTransitions']} (dropped {summary['droppedTransitions']}), "
+          f"LED changes {summary['ledChanges']}, relay drops {summary['relayDropped']}")
+    print(f"max dispatch {summary['maxDispatchUs']} us, free heap {summary['freeHeap']}, "
+          f"min heap during large report {summary['minFreeHeapDuringReport']}")
+    for stage, item in summary["latency"].items():
+        print(f"  {stage:<8} n={item['count']:<6} p50<{item['p50Us']:>8} us  p99<{item['p99Us']:>8} us  "
+              f"max {item['maxUs']} us (since boot)")
+
+
+# === Runner ===
+
+def make_client(args, state):
+    try:
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1)
+    except AttributeError:
+        client = mqtt.Client()  # paho-mqtt 1.x
+    client.tls_set(cert_reqs=ssl.CERT_NONE)
+    client.tls_insecure_set(True)
+    client.username_pw_set(args.user, args.password)
+    connected = threading.Event()
+
+    def on_connect(client, userdata, flags, rc):
+        client.subscribe(f"device/{args.serial}/request")
+        connected.set()
+
+    def on_message(client, userdata, msg):
+        # Answer ledctrl like the printer: the next reports carry the new state
+        try:
+            system = json.loads(msg.payload.decode()).get("system", {})
+        except ValueError:
+            return
+        if system.get("command") == "ledctrl" and system.get("led_node") == "chamber_light":
+            with state.lock:
+                state.chamber_light = system.get("led_mode", state.chamber_light)
+
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.broker, args.port)
+    client.loop_start()
+    if not connected.wait(10):
+        sys.exit("MQTT connect timed out")
+    return client
+
+
+def run(client, args, payloads, rate, timed=False):
+    """Publish until the duration / count is reached; returns (sent, seconds)."""
+    topic = f"device/{args.serial}/report"
+    interval = 1.0 / rate if rate > 0 else 0
+    start = time.perf_counter()
+    sent = 0
+    for t, payload in payloads:
+        if args.count and sent >= args.count:
+            break
+        if timed and t is not None:
+            due = start + t
+        else:
+            due = start + sent * interval
+        now = time.perf_counter()
+        if now - start >= args.duration:
+            break
+        if due > now:
+            time.sleep(due - now)
+        if not isinstance(payload, bytes):
+            payload = json.dumps(payload, separators=(",", ":"))
+        client.publish(topic, payload, qos=0)
+        sent += 1
+    return sent, time.perf_counter() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description="BLFLC MQTT load generator / replay tool")
+    parser.add_argument("--broker", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8883)
+    parser.add_argument("--user", default="bblp")
+    parser.add_argument("--password", default="bblp", help="The access code configured in BLFLC")
+    parser.add_argument("--serial", default="0000")
+    parser.add_argument("--scenario", choices=sorted(SCENARIOS), default="lifecycle")
+    parser.add_argument("--replay", help="Recorded reports (JSON lines) instead of a scenario")
+    parser.add_argument("--rate", type=float, default=10, help="Reports per second (0 = recorded timing)")
+    parser.add_argument("--sweep", help="Comma separated rates, one run each (e.g. 1,10,50,100,200)")
+    parser.add_argument("--duration", type=float, default=10, help="Seconds per run")
+    parser.add_argument("--count", type=int, default=0, help="Stop after this many reports")
+    parser.add_argument("--settle", type=float, default=2, help="Seconds to wait before reading metrics")
+    parser.add_argument("--device", help="BLFLC base URL for /api/metrics, e.g. http://192.168.1.50")
+    parser.add_argument("--auth", help="Web login as user:password")
+    parser.add_argument("--json", help="Write the results to this file")
+    args = parser.parse_args()
+
+    rates = [float(r) for r in args.sweep.split(",")] if args.sweep else [args.rate]
+    state = PrinterState()
+    client = make_client(args, state)
+
+    results = []
+    try:
+        for rate in rates:
+            if args.replay:
+                payloads = replay(load_capture(args.replay))
+                label = f"{args.replay} @ {'recorded timing' if rate == 0 else f'{rate:g} msg/s'}"
+            else:
+                payloads = ((None, p) for p in SCENARIOS[args.scenario](state))
+                label = f"{args.scenario} @ {rate:g} msg/s"
+
+            before = fetch_metrics(args.device, args.auth) if args.device else None
+            sent, elapsed = run(client, args, payloads, rate, timed=args.replay is not None and rate == 0)
+            time.sleep(args.settle)
+            after = fetch_metrics(args.device, args.auth) if args.device else None
+
+            summary = summarize(sent, elapsed, before, after)
+            summary["label"] = label
+            summary["rate"] = rate
+            print_summary(label, summary)
+            results.append(summary)
+    finally:
+        client.loop_stop()
+        client.disconnect()
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
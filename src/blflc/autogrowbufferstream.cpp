@@ -3,28 +3,52 @@
 
 AutoGrowBufferStream::AutoGrowBufferStream() {
     _len = 0;
-    _buffer = (char*)malloc(BUFFER_INCREMENTS);
-    buffer_size = BUFFER_INCREMENTS;
+    _overflowed = false;
+    _messageCount = 0;
+    _maxMessageSize = 0;
+    _overflowCount = 0;
+    _growCount = 0;
+    _buffer = (char*)malloc(BUFFER_INITIAL_SIZE);
+    buffer_size = _buffer ? BUFFER_INITIAL_SIZE : 0;
 }
 
 AutoGrowBufferStream::~AutoGrowBufferStream() {
     free(_buffer);
 }
 
+// Grow the slab to at least minSize bytes (doubling, capped at MAX_BUFFER_SIZE)
+bool AutoGrowBufferStream::grow(uint32_t minSize) {
+    if (minSize > MAX_BUFFER_SIZE) {
+        return false;
+    }
+    uint32_t newSize = buffer_size ? buffer_size : BUFFER_INITIAL_SIZE;
+    while (newSize < minSize) {
+        newSize *= 2;
+    }
+    if (newSize > MAX_BUFFER_SIZE) {
+        newSize = MAX_BUFFER_SIZE;
+    }
+    auto tmp = (char*)realloc(_buffer, newSize);
+    if (tmp == NULL) {
+        LogSerial.println(F("Failed to grow buffer"));
+        return false;
+    }
+    _buffer = tmp;
+    buffer_size = newSize;
+    _growCount++;
+    return true;
+}
+
 size_t AutoGrowBufferStream::write(uint8_t byte) {
-    if (_len + 1 > MAX_BUFFER_SIZE) {
-        LogSerial.println(F("Max buffer size reached — flushing"));
-        flush();
+    if (_overflowed) {
         return 0;
     }
-    if (_len + 1 > buffer_size) {
-        auto tmp = (char*)realloc(_buffer, buffer_size + BUFFER_INCREMENTS);
-        if (tmp == NULL) {
-            LogSerial.println(F("Failed to grow buffer"));
-            return 0;
-        }
-        _buffer = tmp;
-        buffer_size += BUFFER_INCREMENTS;
+    // Always keep one byte spare for the terminator added by get_string()
+    if (_len + 1 >= buffer_size && !grow(_len + 2)) {
+        LogSerial.println(F("Max buffer size reached — dropping message"));
+        _overflowed = true;
+        _overflowCount++;
+        return 0;
     }
     _buffer[_len] = byte;
     _len++;
@@ -39,10 +63,14 @@ int AutoGrowBufferStream::available() {
     return 1;
 }
 
+// Marks the end of a message; the slab is kept for the next one
 void AutoGrowBufferStream::flush() {
+    _messageCount++;
+    if (_len > _maxMessageSize) {
+        _maxMessageSize = _len;
+    }
     _len = 0;
-    _buffer = (char*)realloc(_buffer, BUFFER_INCREMENTS);
-    buffer_size = BUFFER_INCREMENTS;
+    _overflowed = false;
 }
 
 int AutoGrowBufferStream::peek() {
@@ -50,6 +78,9 @@ int AutoGrowBufferStream::peek() {
 }
 
 const char* AutoGrowBufferStream::get_string() const {
+    if (buffer_size == 0) {
+        return "";
+    }
     _buffer[_len] = '\0';
     return _buffer;
 }
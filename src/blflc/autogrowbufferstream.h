@@ -5,15 +5,26 @@
 #include <Arduino.h>
 #include <Stream.h>
 
-#define BUFFER_INCREMENTS 128
+// The buffer is allocated once and only ever grows (doubling) to fit the
+// largest message seen, so long running units do not fragment the heap.
+#define BUFFER_INITIAL_SIZE 4096
 #define MAX_BUFFER_SIZE 65536
 
 class AutoGrowBufferStream : public Stream
 {
 private:
-    uint16_t _len;
-    uint16_t buffer_size;
+    uint32_t _len;
+    uint32_t buffer_size;
     char* _buffer;
+    bool _overflowed;
+
+    // Statistics
+    uint32_t _messageCount;
+    uint32_t _maxMessageSize;
+    uint32_t _overflowCount;
+    uint32_t _growCount;
+
+    bool grow(uint32_t minSize);
 
 public:
     AutoGrowBufferStream();
@@ -25,10 +36,19 @@ public:
     virtual void flush();
     int peek();
 
-    const uint16_t current_length() const { return _len; }
+    const uint32_t current_length() const { return _len; }
     const char* get_buffer() const { return _buffer; }
     const char* get_string() const;
 
+    // True if the current message did not fit and has been truncated
+    bool overflowed() const { return _overflowed; }
+
+    uint32_t capacity() const { return buffer_size; }
+    uint32_t message_count() const { return _messageCount; }
+    uint32_t max_message_size() const { return _maxMessageSize; }
+    uint32_t overflow_count() const { return _overflowCount; }
+    uint32_t grow_count() const { return _growCount; }
+
     using Print::write;
 };
 
@@ -0,0 +1,119 @@
+#include "commandqueue.h"
+#include "logserial.h"
+#include "socketwait.h"
+
+CommandQueueStats commandQueueStats;
+
+enum CommandIntent : uint8_t {
+    INTENT_NONE = 0,
+    INTENT_OFF,
+    INTENT_ON
+};
+
+static const char *const nodeNames[LED_NODE_COUNT] = {"chamber_light"};
+
+static const char commandTemplate[] =
+    "{\"system\":{\"command\":\"ledctrl\",\"sequence_id\":\"blflc_auto\",\"led_node\":\"%s\",\"led_mode\":\"%s\","
+    "\"led_on_time\":500,\"led_off_time\":500,\"loop_times\":0,\"interval_time\":1000}}";
+
+// Room for the template with the longest node name and "off"
+static char commandBuffer[sizeof(commandTemplate) + 24];
+static char commandTopic[48] = "";
+
+// Latest request per node, taken by the MQTT task
+static std::atomic<uint8_t> pendingIntent[LED_NODE_COUNT];
+
+// Sent, not yet acknowledged commands (MQTT task only)
+struct InFlightCommand {
+    uint8_t intent = INTENT_NONE;
+    unsigned long sentMs = 0;
+};
+static InFlightCommand inFlight[LED_NODE_COUNT];
+
+void setCommandTopic(const char *serialNumber)
+{
+    snprintf(commandTopic, sizeof(commandTopic), "device/%s/request", serialNumber);
+}
+
+void queueLedCommand(LedNode node, bool on)
+{
+    commandQueueStats.requested.fetch_add(1, std::memory_order_relaxed);
+    uint8_t previous = pendingIntent[node].exchange(on ? INTENT_ON : INTENT_OFF);
+    if (previous != INTENT_NONE)
+        commandQueueStats.coalesced.fetch_add(1, std::memory_order_relaxed);
+    wakeMqttTask();
+}
+
+void sendQueuedCommands(PubSubClient &client)
+{
+    unsigned long now = millis();
+    for (uint8_t node = 0; node < LED_NODE_COUNT; node++)
+    {
+        InFlightCommand &command = inFlight[node];
+        if (command.intent != INTENT_NONE && now - command.sentMs > COMMAND_ACK_TIMEOUT_MS)
+        {
+            command.intent = INTENT_NONE;
+            commandQueueStats.timeouts++;
+        }
+
+        uint8_t intent = pendingIntent[node].exchange(INTENT_NONE);
+        if (intent == INTENT_NONE)
+            continue;
+
+        const char *mode = intent == INTENT_ON ? "on" : "off";
+        if (!client.connected() || commandTopic[0] == '\0')
+        {
+            commandQueueStats.dropped++;
+            LogSerial.printf("[MQTT] Skipped %s %s – MQTT not connected\n", nodeNames[node], mode);
+            continue;
+        }
+
+        snprintf(commandBuffer, sizeof(commandBuffer), commandTemplate, nodeNames[node], mode);
+        if (!client.publish(commandTopic, commandBuffer))
+        {
+            commandQueueStats.dropped++;
+            LogSerial.printf("[MQTT] Publishing %s %s failed\n", nodeNames[node], mode);
+            continue;
+        }
+
+        // A command still waiting for its ack is superseded by this one
+        command.intent = intent;
+        command.sentMs = now;
+        commandQueueStats.sent++;
+        LogSerial.printf("[MQTT] %s %s sent to topic: %s\n", nodeNames[node], mode, commandTopic);
+    }
+}
+
+void acknowledgeLedCommand(LedNode node, bool on)
+{
+    InFlightCommand &command = inFlight[node];
+    if (command.intent != (on ? INTENT_ON : INTENT_OFF))
+        return;
+
+    unsigned long ackMs = millis() - command.sentMs;
+    command.intent = INTENT_NONE;
+    commandQueueStats.acked++;
+    commandQueueStats.lastAckMs = ackMs;
+    if (ackMs > commandQueueStats.maxAckMs)
+        commandQueueStats.maxAckMs = ackMs;
+}
+
+void serializeCommandQueue(JsonObject out)
+{
+    out["requested"] = commandQueueStats.requested.load(std::memory_order_relaxed);
+    out["coalesced"] = commandQueueStats.coalesced.load(std::memory_order_relaxed);
+    out["sent"] = commandQueueStats.sent;
+    out["dropped"] = commandQueueStats.dropped;
+    out["acked"] = commandQueueStats.acked;
+    out["timeouts"] = commandQueueStats.timeouts;
+    out["lastAckMs"] = commandQueueStats.lastAckMs;
+    out["maxAckMs"] = commandQueueStats.maxAckMs;
+
+    uint32_t pending = 0;
+    for (uint8_t node = 0; node < LED_NODE_COUNT; node++)
+    {
+        if (inFlight[node].intent != INTENT_NONE)
+            pending++;
+    }
+    out["awaitingAck"] = pending;
+}
@@ -0,0 +1,50 @@
+#ifndef _COMMANDQUEUE
+#define _COMMANDQUEUE
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <PubSubClient.h>
+#include <atomic>
+
+// Outbound ledctrl commands. Any task may request a light state; only the
+// latest request per led_node is kept and the MQTT task publishes it, so a
+// door flapping open / closed sends one command instead of several
+// contradictory ones. A command counts as acknowledged when the next
+// lights_report shows the requested state.
+
+constexpr unsigned long COMMAND_ACK_TIMEOUT_MS = 5000;
+
+enum LedNode : uint8_t {
+    LED_NODE_CHAMBER_LIGHT = 0,
+    LED_NODE_COUNT
+};
+
+// Counters reported via /api/metrics (requests come from several tasks)
+struct CommandQueueStats {
+    std::atomic<uint32_t> requested{0};
+    std::atomic<uint32_t> coalesced{0};     // Replaced by a newer request before it was sent
+    uint32_t sent = 0;
+    uint32_t dropped = 0;       // Not connected / publish failed
+    uint32_t acked = 0;
+    uint32_t timeouts = 0;      // No matching lights_report within COMMAND_ACK_TIMEOUT_MS
+    unsigned long lastAckMs = 0;
+    unsigned long maxAckMs = 0;
+};
+
+extern CommandQueueStats commandQueueStats;
+
+// Topic of the printer the commands go to (call when the serial number is known)
+void setCommandTopic(const char *serialNumber);
+
+// Request a light state (any task); wakes the MQTT task
+void queueLedCommand(LedNode node, bool on);
+
+// Publish pending commands and expire unacknowledged ones (MQTT task)
+void sendQueuedCommands(PubSubClient &client);
+
+// A lights_report entry arrived (MQTT task)
+void acknowledgeLedCommand(LedNode node, bool on);
+
+void serializeCommandQueue(JsonObject out);
+
+#endif
@@ -6,6 +6,9 @@
 #include "types.h"
 #include "logserial.h"
 #include "leds.h"
+#include "statefilter.h"
+#include "mqttparsingutility.h"
+#include "hmscatalogue.h"
 
 const char *configPath = "/blflcconfig.json";
 
@@ -25,7 +28,7 @@ char *generateRandomString(int length)
     return randomString;
 }
 
-void saveFileSystem()
+void saveFileSystem(const ExtraPrinter *extraPrinters)
 {
     LogSerial.println(F("[Filesystem] Saving config"));
 
@@ -38,6 +41,19 @@ void saveFileSystem()
     json["printerIp"] = printerConfig.printerIP;
     json["accessCode"] = printerConfig.accessCode;
     json["serialNumber"] = printerConfig.serialNumber;
+    if (extraPrinters == nullptr)
+        extraPrinters = printerConfig.extraPrinters;
+    JsonArray extraPrinterList = json["extraPrinters"].to<JsonArray>();
+    for (uint8_t i = 0; i < MAX_EXTRA_PRINTERS; i++)
+    {
+        const ExtraPrinter &extra = extraPrinters[i];
+        JsonObject item = extraPrinterList.add<JsonObject>();
+        item["printerIp"] = extra.printerIP;
+        item["accessCode"] = extra.accessCode;
+        item["serialNumber"] = extra.serialNumber;
+        item["ledStart"] = extra.ledStart;
+        item["ledCount"] = extra.ledCount;
+    }
     // json["webpagePassword"] = printerConfig.webpagePassword;
     json["bssi"] = printerConfig.BSSID;
     json["brightness"] = printerConfig.brightness;
@@ -60,10 +76,13 @@ void saveFileSystem()
     json["inactivityEnabled"] = printerConfig.inactivityEnabled;
     json["inactivityTimeOut"] = printerConfig.inactivityTimeOut;
     json["controlChamberLight"] = printerConfig.controlChamberLight; //control chamber light
+    json["amsColorMirror"] = printerConfig.amsColorMirror;
+    json["stateDebounceMs"] = printerConfig.stateDebounceMs;
     // Debugging
     json["debugging"] = printerConfig.debugging;
     json["debugOnChange"] = printerConfig.debugOnChange;
     json["mqttdebug"] = printerConfig.mqttdebug;
+    json["reportRelayMqtt"] = printerConfig.reportRelayMqtt;
     // Printer Dependant
     json["p1Printer"] = printerVariables.isP1Printer;
     json["doorSwitch"] = printerVariables.useDoorSwitch;
@@ -180,6 +199,16 @@ void loadFileSystem()
         strlcpy(printerConfig.printerIP, json["printerIp"] | "", sizeof(printerConfig.printerIP));
         strlcpy(printerConfig.accessCode, json["accessCode"] | "", sizeof(printerConfig.accessCode));
         strlcpy(printerConfig.serialNumber, json["serialNumber"] | "", sizeof(printerConfig.serialNumber));
+        for (uint8_t i = 0; i < MAX_EXTRA_PRINTERS; i++)
+        {
+            ExtraPrinter &extra = printerConfig.extraPrinters[i];
+            JsonObject item = json["extraPrinters"][i];
+            strlcpy(extra.printerIP, item["printerIp"] | "", sizeof(extra.printerIP));
+            strlcpy(extra.accessCode, item["accessCode"] | "", sizeof(extra.accessCode));
+            strlcpy(extra.serialNumber, item["serialNumber"] | "", sizeof(extra.serialNumber));
+            extra.ledStart = item["ledStart"] | 0;
+            extra.ledCount = item["ledCount"] | 0;
+        }
         strlcpy(printerConfig.BSSID, json["bssi"] | "", sizeof(printerConfig.BSSID));
         printerConfig.brightness = json["brightness"];
         // LED Behaviour (Choose One)
@@ -201,10 +230,13 @@ void loadFileSystem()
         printerConfig.inactivityEnabled = json["inactivityEnabled"];
         printerConfig.inactivityTimeOut = json["inactivityTimeOut"];
         printerConfig.controlChamberLight = json["controlChamberLight"]; //control chamber light
+        printerConfig.amsColorMirror = json["amsColorMirror"] | false;
+        printerConfig.stateDebounceMs = min(json["stateDebounceMs"] | DEFAULT_STATE_DEBOUNCE_MS, MAX_STATE_DEBOUNCE_MS);
         // Debugging
         printerConfig.debugging = json["debugging"];
         printerConfig.debugOnChange = json["debugOnChange"];
         printerConfig.mqttdebug = json["mqttdebug"];
+        printerConfig.reportRelayMqtt = json["reportRelayMqtt"] | false;
         // Printer Dependant
         printerVariables.isP1Printer = json["p1Printer"];
         printerVariables.useDoorSwitch = json["doorSwitch"];
@@ -228,6 +260,7 @@ void loadFileSystem()
         printerConfig.bedTempRGB = hex2rgb(json["bedTempRGB"] | "#FF0000");
         // HMS Error handling
         printerConfig.hmsIgnoreList = json["hmsIgnoreList"] | "";
+        compileHMSIgnoreList(printerConfig.hmsIgnoreList);
 
         // LED Hardware Configuration (with defaults for migration)
         printerConfig.ledConfig.chipType = json["ledChipType"] | CHIP_WS2812B;
@@ -282,6 +315,8 @@ void deleteFileSystem()
 {
     LogSerial.println(F("[Filesystem] Deleting LittleFS"));
     LittleFS.remove(configPath);
+    LittleFS.remove(hmsCataloguePath);
+    LittleFS.remove(hmsCatalogueUploadPath);
 }
 
 bool hasFileSystem()
@@ -2,6 +2,7 @@
 #define _BLFLCFILESYSTEM
 
 #include <Arduino.h>
+#include "types.h"
 
 // Config file path
 extern const char *configPath;
@@ -9,8 +10,9 @@ extern const char *configPath;
 // Generate a random string of given length
 char *generateRandomString(int length);
 
-// Save current configuration to filesystem
-void saveFileSystem();
+// Save current configuration to filesystem. When extraPrinters is given
+// (MAX_EXTRA_PRINTERS entries) it is saved in place of printerConfig.extraPrinters
+void saveFileSystem(const ExtraPrinter *extraPrinters = nullptr);
 
 // Load configuration from filesystem
 void loadFileSystem();
@@ -0,0 +1,217 @@
+#include "hmscatalogue.h"
+#include <LittleFS.h>
+#include <algorithm>
+#include "leds.h"
+#include "logserial.h"
+#include "mqttparsingutility.h"
+
+const char *hmsCataloguePath = "/hmscatalogue.json";
+const char *hmsCatalogueUploadPath = "/hmscatalogue.tmp";
+
+// Entries that used to be hard coded in applyHMSOverride()
+static const struct
+{
+    uint64_t code;
+    int16_t stage;
+} builtinEntries[] = {
+    {0x0C0003000003000B, 10}, // First layer inspection
+    {0x0300120000020001, 17}, // Front cover removed
+    {0x0700200000030001, 6},  // Filament runout
+    {0x0300020000010001, 20}, // Nozzle temp fail
+    {0x0300010000010007, 21}, // Bed temp fail
+};
+
+// Two banks so a reload from the web task never hands the MQTT task a
+// half-built table. Exact codes are sorted by code at the front of the
+// table, patterns follow (most specific first).
+static HMSCatalogueEntry catalogue[2][MAX_HMS_CATALOGUE_ENTRIES];
+static uint8_t catalogueCount[2] = {0, 0};
+static uint8_t catalogueExactCount[2] = {0, 0};
+static volatile uint8_t catalogueBank = 0;
+static bool catalogueBuilt = false;
+
+static const char *const severityKeys[] = {"", "fatal", "serious", "common", "info"};
+
+static uint8_t parseSeverity(const char *name)
+{
+    for (uint8_t i = HMS_FATAL; i <= HMS_INFO; i++)
+    {
+        if (strcasecmp(name, severityKeys[i]) == 0)
+            return i;
+    }
+    return HMS_NONE;
+}
+
+static int maskBits(uint64_t mask)
+{
+    return __builtin_popcountll(mask);
+}
+
+static bool entryOrder(const HMSCatalogueEntry &a, const HMSCatalogueEntry &b)
+{
+    bool aExact = a.mask == ~0ULL;
+    bool bExact = b.mask == ~0ULL;
+    if (aExact != bExact)
+        return aExact;
+    if (aExact)
+        return a.code < b.code;
+    return maskBits(a.mask) > maskBits(b.mask);
+}
+
+// Add or replace the entry with the same code / mask
+static bool addEntry(HMSCatalogueEntry *table, uint8_t &count, const HMSCatalogueEntry &entry)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (table[i].code == entry.code && table[i].mask == entry.mask)
+        {
+            table[i] = entry;
+            return true;
+        }
+    }
+    if (count >= MAX_HMS_CATALOGUE_ENTRIES)
+        return false;
+    table[count++] = entry;
+    return true;
+}
+
+static int readCatalogueFile(const char *path, HMSCatalogueEntry *table, uint8_t &count)
+{
+    if (!LittleFS.exists(path))
+        return 0;
+
+    File file = LittleFS.open(path, "r");
+    if (!file)
+        return -1;
+
+    JsonDocument json;
+    DeserializationError error = deserializeJson(json, file);
+    file.close();
+    if (error)
+        return -1;
+
+    int loaded = 0;
+    for (JsonObject item : json["codes"].as<JsonArray>())
+    {
+        const char *codeText = item["code"] | "";
+        HMSCatalogueEntry entry = {};
+        if (!parseHMSCodeString(codeText, strlen(codeText), entry.code, entry.mask))
+        {
+            LogSerial.print(F("[HMS] Invalid catalogue code: "));
+            LogSerial.println(codeText);
+            continue;
+        }
+        entry.code &= entry.mask;
+        entry.stage = item["stage"] | HMS_NO_STAGE;
+        entry.severity = parseSeverity(item["severity"] | "");
+        entry.hasColor = !item["color"].isNull();
+        if (entry.hasColor)
+            entry.color = hex2rgb(item["color"] | "#FF0000");
+        entry.pattern = item["pattern"] | PATTERN_BREATHING;
+
+        if (!addEntry(table, count, entry))
+        {
+            LogSerial.println(F("[HMS] Catalogue full, remaining entries skipped"));
+            break;
+        }
+        loaded++;
+    }
+    return loaded;
+}
+
+int loadHMSCatalogue(const char *path)
+{
+    uint8_t bank = catalogueBank ^ 1;
+    HMSCatalogueEntry *table = catalogue[bank];
+    uint8_t count = 0;
+
+    for (const auto &builtin : builtinEntries)
+    {
+        HMSCatalogueEntry entry = {};
+        entry.code = builtin.code;
+        entry.mask = ~0ULL;
+        entry.stage = builtin.stage;
+        entry.severity = HMS_NONE;
+        entry.pattern = PATTERN_BREATHING;
+        addEntry(table, count, entry);
+    }
+
+    int loaded = readCatalogueFile(path, table, count);
+    if (loaded < 0)
+    {
+        // Only a catalogue that loaded replaces the active one
+        if (catalogueBuilt)
+        {
+            LogSerial.printf("[HMS] Failed to read %s, keeping the active catalogue\n", path);
+            return loaded;
+        }
+        LogSerial.println(F("[HMS] Failed to read HMS catalogue, using built-in entries"));
+    }
+
+    std::sort(table, table + count, entryOrder);
+    uint8_t exactCount = 0;
+    while (exactCount < count && table[exactCount].mask == ~0ULL)
+        exactCount++;
+
+    catalogueCount[bank] = count;
+    catalogueExactCount[bank] = exactCount;
+    catalogueBank = bank;
+    catalogueBuilt = true;
+
+    LogSerial.printf("[HMS] Catalogue loaded: %u entries (%d from file)\n", count, loaded < 0 ? 0 : loaded);
+    return loaded;
+}
+
+const HMSCatalogueEntry *findHMSCatalogueEntry(uint64_t code)
+{
+    uint8_t bank = catalogueBank;
+    const HMSCatalogueEntry *table = catalogue[bank];
+    const HMSCatalogueEntry *exactEnd = table + catalogueExactCount[bank];
+
+    const HMSCatalogueEntry *found = std::lower_bound(table, exactEnd, code,
+                                                      [](const HMSCatalogueEntry &entry, uint64_t value)
+                                                      { return entry.code < value; });
+    if (found != exactEnd && found->code == code)
+        return found;
+
+    for (const HMSCatalogueEntry *entry = exactEnd; entry < table + catalogueCount[bank]; entry++)
+    {
+        if ((code & entry->mask) == entry->code)
+            return entry;
+    }
+    return nullptr;
+}
+
+void serializeHMSCatalogue(JsonDocument &doc)
+{
+    uint8_t bank = catalogueBank;
+    JsonArray codes = doc["codes"].to<JsonArray>();
+
+    for (uint8_t i = 0; i < catalogueCount[bank]; i++)
+    {
+        const HMSCatalogueEntry &entry = catalogue[bank][i];
+        JsonObject item = codes.add<JsonObject>();
+
+        char text[24];
+        formatHMSCodeShort(entry.code, text, sizeof(text));
+        // Wildcard digits are written as X
+        for (int nibble = 0, pos = 18; nibble < 16; nibble++, pos--)
+        {
+            if (text[pos] == '_')
+                pos--;
+            if (((entry.mask >> (nibble * 4)) & 0xF) == 0)
+                text[pos] = 'X';
+        }
+        item["code"] = text;
+
+        if (entry.stage != HMS_NO_STAGE)
+            item["stage"] = entry.stage;
+        if (entry.severity != HMS_NONE)
+            item["severity"] = severityKeys[entry.severity];
+        if (entry.hasColor)
+        {
+            item["color"] = entry.color.RGBhex;
+            item["pattern"] = entry.pattern;
+        }
+    }
+}
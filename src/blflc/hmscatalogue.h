@@ -0,0 +1,38 @@
+#ifndef _HMSCATALOGUE
+#define _HMSCATALOGUE
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "types.h"
+
+// Catalogue file in LittleFS (optional, built-in entries are used without it)
+extern const char *hmsCataloguePath;
+// Uploads land here and only replace hmsCataloguePath once they loaded
+extern const char *hmsCatalogueUploadPath;
+
+constexpr uint8_t MAX_HMS_CATALOGUE_ENTRIES = 64;
+constexpr int16_t HMS_NO_STAGE = -1;
+
+// What to do when a given HMS code (or code pattern) is reported
+typedef struct HMSCatalogueEntryStruct {
+    uint64_t code;
+    uint64_t mask;                  // Bits that must match, ~0 for an exact code
+    COLOR color;                    // Dedicated LED color (if hasColor)
+    int16_t stage;                  // Stage override, HMS_NO_STAGE for none
+    uint8_t severity;               // HMSSeverity, HMS_NONE to use the code's own severity
+    uint8_t pattern;
+    bool hasColor;
+} HMSCatalogueEntry;
+
+// Build the catalogue from the built-in entries plus path and make it active.
+// Returns the number of entries read from the file. -1 if it could not be
+// parsed: the active catalogue is then kept (built-in entries only at boot).
+int loadHMSCatalogue(const char *path = hmsCataloguePath);
+
+// Entry for a raw 64-bit HMS code, or nullptr if the code is not catalogued
+const HMSCatalogueEntry *findHMSCatalogueEntry(uint64_t code);
+
+// Write the active catalogue in the file format
+void serializeHMSCatalogue(JsonDocument &doc);
+
+#endif
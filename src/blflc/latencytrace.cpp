@@ -0,0 +1,127 @@
+#include "latencytrace.h"
+
+static LatencyHistogram histograms[LATENCY_STAGE_COUNT];
+static const char *const stageNames[LATENCY_STAGE_COUNT] = {"parse", "resolve", "render", "show", "total"};
+
+// Trace of the report being handled (MQTT task only)
+static bool traceOpen = false;
+static TaskHandle_t traceTask = nullptr;
+static uint32_t traceStartUs = 0;
+static uint32_t traceParsedUs = 0;
+
+// Hand-off to the loop task: odd sequence = being written
+static std::atomic<uint32_t> handoffSeq{0};
+static std::atomic<uint32_t> handoffStartUs{0};
+static std::atomic<uint32_t> handoffResolvedUs{0};
+
+// Frame waiting for FastLED.show() (loop task only)
+static uint32_t consumedSeq = 0;
+static bool frameInFlight = false;
+static uint32_t frameStartUs = 0;
+static uint32_t frameRenderedUs = 0;
+
+void traceReportParsed(uint32_t firstByteUs)
+{
+    uint32_t now = micros();
+    histograms[LATENCY_PARSE].record(now - firstByteUs);
+
+    traceStartUs = firstByteUs;
+    traceParsedUs = now;
+    traceTask = xTaskGetCurrentTaskHandle();
+    traceOpen = true;
+}
+
+void traceReportDone()
+{
+    traceOpen = false;
+}
+
+void traceResolved()
+{
+    // updateleds() also runs for door / timer events on the loop task
+    if (!traceOpen || xTaskGetCurrentTaskHandle() != traceTask)
+        return;
+
+    uint32_t now = micros();
+    histograms[LATENCY_RESOLVE].record(now - traceParsedUs);
+    traceOpen = false;
+
+    uint32_t seq = handoffSeq.load(std::memory_order_relaxed);
+    handoffSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    handoffStartUs.store(traceStartUs, std::memory_order_relaxed);
+    handoffResolvedUs.store(now, std::memory_order_relaxed);
+    handoffSeq.store(seq + 2, std::memory_order_release);
+}
+
+void traceFrameRendered()
+{
+    uint32_t seq = handoffSeq.load(std::memory_order_acquire);
+    if (seq == consumedSeq || (seq & 1))
+        return;
+
+    uint32_t startUs = handoffStartUs.load(std::memory_order_relaxed);
+    uint32_t resolvedUs = handoffResolvedUs.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (handoffSeq.load(std::memory_order_relaxed) != seq)
+        return; // Overwritten while reading, the newer trace is taken next frame
+
+    consumedSeq = seq;
+    uint32_t now = micros();
+    histograms[LATENCY_RENDER].record(now - resolvedUs);
+    frameInFlight = true;
+    frameStartUs = startUs;
+    frameRenderedUs = now;
+}
+
+void traceFrameShown()
+{
+    if (!frameInFlight)
+        return;
+
+    uint32_t now = micros();
+    histograms[LATENCY_SHOW].record(now - frameRenderedUs);
+    histograms[LATENCY_TOTAL].record(now - frameStartUs);
+    frameInFlight = false;
+}
+
+// Upper bound of the bucket that holds the given percentile
+static uint32_t percentileUs(const uint32_t *buckets, uint32_t count, uint8_t percent)
+{
+    if (count == 0)
+        return 0;
+
+    uint32_t target = ((uint64_t)count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen >= target)
+            return 2UL << i;
+    }
+    return 2UL << (LATENCY_BUCKETS - 1);
+}
+
+void serializeLatencyTrace(JsonObject out)
+{
+    for (uint8_t stage = 0; stage < LATENCY_STAGE_COUNT; stage++)
+    {
+        const LatencyHistogram &histogram = histograms[stage];
+        uint32_t buckets[LATENCY_BUCKETS];
+        uint32_t count = 0;
+        for (uint8_t i = 0; i < LATENCY_BUCKETS; i++)
+        {
+            buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+            count += buckets[i];
+        }
+
+        JsonObject item = out[stageNames[stage]].to<JsonObject>();
+        item["count"] = count;
+        item["maxUs"] = histogram.maxUs.load(std::memory_order_relaxed);
+        item["p50Us"] = percentileUs(buckets, count, 50);
+        item["p99Us"] = percentileUs(buckets, count, 99);
+        JsonArray list = item["buckets"].to<JsonArray>();
+        for (uint8_t i = 0; i < LATENCY_BUCKETS; i++)
+            list.add(buckets[i]);
+    }
+}
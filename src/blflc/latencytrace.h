@@ -0,0 +1,57 @@
+#ifndef _LATENCYTRACE
+#define _LATENCYTRACE
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <atomic>
+
+// Report-to-LED latency tracing. A report is timestamped when its first byte
+// is read off the socket, when it is parsed, when updateleds() resolved it
+// (MQTT task), when the next frame is rendered and when FastLED.show()
+// returns (loop task). Stage latencies go into log2 histograms.
+//
+// Each histogram has a single writer task and the MQTT task hands the trace
+// to the loop task through a sequence counter, so recording never locks.
+
+// Bucket i counts latencies in [2^i, 2^(i+1)) us; the last one is open ended (>= ~0.5 s)
+constexpr uint8_t LATENCY_BUCKETS = 20;
+
+enum LatencyStage : uint8_t {
+    LATENCY_PARSE = 0,  // First byte -> report parsed
+    LATENCY_RESOLVE,    // Parsed -> updateleds() done
+    LATENCY_RENDER,     // Resolved -> next frame rendered
+    LATENCY_SHOW,       // Rendered -> FastLED.show() returned
+    LATENCY_TOTAL,      // First byte -> FastLED.show() returned
+    LATENCY_STAGE_COUNT
+};
+
+struct LatencyHistogram {
+    std::atomic<uint32_t> buckets[LATENCY_BUCKETS];
+    std::atomic<uint32_t> maxUs;
+
+    void record(uint32_t us)
+    {
+        uint8_t bucket = us == 0 ? 0 : 31 - __builtin_clz(us);
+        if (bucket >= LATENCY_BUCKETS)
+            bucket = LATENCY_BUCKETS - 1;
+        buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        if (us > maxUs.load(std::memory_order_relaxed))
+            maxUs.store(us, std::memory_order_relaxed);
+    }
+};
+
+// MQTT task: a report has been parsed (firstByteUs from ReportStream)
+void traceReportParsed(uint32_t firstByteUs);
+// MQTT task: the report has been handled (closes the trace if nothing resolved)
+void traceReportDone();
+// End of updateleds(): hands the open report trace to the loop task
+void traceResolved();
+
+// Loop task: frame rendered / FastLED.show() returned
+void traceFrameRendered();
+void traceFrameShown();
+
+// Histograms for /api/metrics
+void serializeLatencyTrace(JsonObject out);
+
+#endif
@@ -0,0 +1,251 @@
+#include "ledpreview.h"
+#include <ESPAsyncWebServer.h>
+#include <memory>
+#include <vector>
+#include "logserial.h"
+
+static_assert(sizeof(CRGB) == 3, "CRGB must be packed R, G, B");
+
+constexpr size_t PREVIEW_HEADER_BYTES = 4;
+
+struct PreviewClient {
+    uint32_t id = 0;                // 0 = free slot
+    uint16_t intervalMs = 1000 / PREVIEW_DEFAULT_FPS;
+    uint16_t maxLeds = 0;           // 0 = full resolution
+};
+
+AsyncWebSocket wsPreview("/ws/preview");
+PreviewStats previewStats;
+
+// Only touched by the async_tcp task (websocket events); the LED loop reads
+// what they add up to
+static PreviewClient previewClients[PREVIEW_MAX_CLIENTS];
+static volatile uint8_t previewClientCount = 0;
+static volatile uint16_t previewIntervalMs = 1000 / PREVIEW_DEFAULT_FPS;    // Shortest client interval
+static volatile uint16_t previewMaxLeds = 0;                                // Largest client resolution
+static volatile bool previewResend = false;     // Send the next frame even if unchanged
+static unsigned long lastSnapshotMs = 0;
+
+// Snapshots are handed to the websocket queues as they are; a buffer is only
+// written again once no queue holds it any more
+static AsyncWebSocketSharedBuffer frameBuffers[PREVIEW_FRAME_BUFFERS];
+static AsyncWebSocketSharedBuffer currentFrame;
+
+static PreviewClient *findClient(uint32_t id)
+{
+    for (PreviewClient &client : previewClients)
+    {
+        if (client.id == id)
+            return &client;
+    }
+    return nullptr;
+}
+
+// After the table changed: frames go out at the rate and resolution of the
+// most demanding client
+static void updateClients()
+{
+    uint8_t count = 0;
+    uint16_t interval = 1000 / PREVIEW_DEFAULT_FPS;
+    uint16_t maxLeds = 0;
+    for (const PreviewClient &client : previewClients)
+    {
+        if (!client.id)
+            continue;
+        interval = count == 0 ? client.intervalMs : min(interval, client.intervalMs);
+        // 0 (full resolution) wins
+        if (count == 0 || (maxLeds != 0 && client.maxLeds != 0))
+            maxLeds = max(maxLeds, client.maxLeds);
+        else
+            maxLeds = 0;
+        count++;
+    }
+    previewIntervalMs = interval;
+    previewMaxLeds = maxLeds;
+    previewClientCount = count;
+    previewResend = true;
+}
+
+// ============================================================================
+// Frames
+// ============================================================================
+
+static bool sameFrame(const CRGB *pixels, uint16_t count, uint8_t brightness)
+{
+    return currentFrame && currentFrame->size() == PREVIEW_HEADER_BYTES + count * 3 &&
+           (*currentFrame)[1] == brightness &&
+           memcmp(currentFrame->data() + PREVIEW_HEADER_BYTES, pixels, count * 3) == 0;
+}
+
+// Copy the strip into a free snapshot buffer. False if every buffer is still
+// queued somewhere (the frame is skipped).
+static bool takeSnapshot(const CRGB *pixels, uint16_t count, uint8_t brightness)
+{
+    AsyncWebSocketSharedBuffer *buffer = nullptr;
+    for (AsyncWebSocketSharedBuffer &candidate : frameBuffers)
+    {
+        if (!candidate)
+            candidate = std::make_shared<std::vector<uint8_t>>();
+        // currentFrame holds a reference of its own
+        if (candidate.use_count() == 1)
+        {
+            buffer = &candidate;
+            break;
+        }
+    }
+    if (!buffer)
+    {
+        previewStats.busy++;
+        return false;
+    }
+
+    // Sized once for the strip, resize() keeps the capacity afterwards
+    std::vector<uint8_t> &frame = **buffer;
+    frame.resize(PREVIEW_HEADER_BYTES + count * 3);
+    frame[0] = PREVIEW_FRAME_VERSION;
+    frame[1] = brightness;
+    frame[2] = count & 0xFF;
+    frame[3] = count >> 8;
+    memcpy(frame.data() + PREVIEW_HEADER_BYTES, pixels, count * 3);
+    currentFrame = *buffer;
+    previewStats.snapshots++;
+    return true;
+}
+
+// Average blocks of the current frame down to target pixels
+static AsyncWebSocketSharedBuffer downsample(uint16_t count, uint16_t target)
+{
+    AsyncWebSocketSharedBuffer scaled = std::make_shared<std::vector<uint8_t>>(PREVIEW_HEADER_BYTES + target * 3);
+    const uint8_t *in = currentFrame->data() + PREVIEW_HEADER_BYTES;
+    uint8_t *out = scaled->data();
+    out[0] = PREVIEW_FRAME_VERSION;
+    out[1] = (*currentFrame)[1];
+    out[2] = target & 0xFF;
+    out[3] = target >> 8;
+    out += PREVIEW_HEADER_BYTES;
+    for (uint16_t i = 0; i < target; i++)
+    {
+        uint16_t start = (uint32_t)i * count / target;
+        uint16_t end = (uint32_t)(i + 1) * count / target;
+        for (uint8_t c = 0; c < 3; c++)
+        {
+            uint32_t sum = 0;
+            for (uint16_t p = start; p < end; p++)
+                sum += in[p * 3 + c];
+            out[i * 3 + c] = sum / (end - start);
+        }
+    }
+    return scaled;
+}
+
+void previewFrame(const CRGB *pixels, uint16_t count, uint8_t brightness)
+{
+    if (previewClientCount == 0)
+        return;
+    unsigned long now = millis();
+    if (now - lastSnapshotMs < previewIntervalMs)
+        return;
+    lastSnapshotMs = now;
+
+    if (!previewResend && sameFrame(pixels, count, brightness))
+        return;
+    if (!takeSnapshot(pixels, count, brightness))
+        return;
+
+    AsyncWebSocketSharedBuffer frame = currentFrame;
+    uint16_t maxLeds = previewMaxLeds;
+    if (maxLeds != 0 && maxLeds < count)
+        frame = downsample(count, maxLeds);
+
+    // This runs on the LED task: only binaryAll() walks the client list under
+    // the lock the async_tcp task takes to remove clients
+    previewResend = false;
+    AsyncWebSocket::SendStatus status = wsPreview.binaryAll(frame);
+    if (status != AsyncWebSocket::DISCARDED)
+    {
+        previewStats.sent++;
+        previewStats.bytes += frame->size();
+    }
+    if (status != AsyncWebSocket::ENQUEUED)
+    {
+        // A client missed it, the next frame goes out even if it is the same
+        previewStats.dropped++;
+        previewResend = true;
+    }
+}
+
+// ============================================================================
+// Clients
+// ============================================================================
+
+// {"fps":N,"leds":M}
+static void handleClientMessage(AsyncWebSocketClient *client, AwsFrameInfo *info, uint8_t *data, size_t len)
+{
+    if (!info->final || info->index != 0 || info->len != len || info->opcode != WS_TEXT)
+        return;
+
+    JsonDocument doc;
+    if (deserializeJson(doc, data, len))
+        return;
+
+    PreviewClient *slot = findClient(client->id());
+    if (!slot)
+        return;
+    if (doc["fps"].is<int>())
+        slot->intervalMs = 1000 / constrain(doc["fps"].as<int>(), 1, PREVIEW_MAX_FPS);
+    if (doc["leds"].is<int>())
+        slot->maxLeds = constrain(doc["leds"].as<int>(), 0, UINT16_MAX);
+    updateClients();
+}
+
+static void onPreviewEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
+                           void *arg, uint8_t *data, size_t len)
+{
+    if (type == WS_EVT_CONNECT)
+    {
+        PreviewClient *slot = findClient(0);
+        if (!slot)
+        {
+            client->close();
+            return;
+        }
+        *slot = PreviewClient();
+        slot->id = client->id();
+        // A client that cannot keep up misses frames instead of being
+        // disconnected
+        client->setCloseClientOnQueueFull(false);
+        updateClients();
+    }
+    else if (type == WS_EVT_DISCONNECT || type == WS_EVT_ERROR)
+    {
+        PreviewClient *slot = findClient(client->id());
+        if (slot)
+        {
+            slot->id = 0;
+            updateClients();
+        }
+        wsPreview.cleanupClients();
+    }
+    else if (type == WS_EVT_DATA)
+    {
+        handleClientMessage(client, (AwsFrameInfo *)arg, data, len);
+    }
+}
+
+void setupLedPreview(AsyncWebServer &server)
+{
+    wsPreview.onEvent(onPreviewEvent);
+    server.addHandler(&wsPreview);
+}
+
+void serializeLedPreview(JsonObject out)
+{
+    out["clients"] = previewClientCount;
+    out["fps"] = 1000 / previewIntervalMs;
+    out["leds"] = previewMaxLeds;
+    out["snapshots"] = previewStats.snapshots;
+    out["sent"] = previewStats.sent;
+    out["bytes"] = previewStats.bytes;
+    out["dropped"] = previewStats.dropped;
+    out["busy"] = previewStats.busy;
+}
@@ -0,0 +1,45 @@
+#ifndef _LEDPREVIEW
+#define _LEDPREVIEW
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <FastLED.h>
+
+class AsyncWebServer;
+
+// Live preview of the strip on websocket /ws/preview. Every message is one
+// binary frame of what was last shown:
+//   uint8 PREVIEW_FRAME_VERSION, uint8 brightness (0-255), uint16 pixel count
+//   (little endian), then R, G, B per pixel
+// A client can send {"fps":N,"leds":M}: N frames per second (default
+// PREVIEW_DEFAULT_FPS) and M pixels, averaged from the strip (0 = all). Frames
+// are broadcast to every client at the highest rate and resolution asked for.
+// Unchanged frames are not sent, except to bring a new client or one that
+// missed a frame up to date. A client that cannot keep up misses frames,
+// nothing is queued for it and the LED loop never waits.
+constexpr uint8_t PREVIEW_FRAME_VERSION = 1;
+constexpr uint8_t PREVIEW_DEFAULT_FPS = 10;
+constexpr uint8_t PREVIEW_MAX_FPS = 30;
+constexpr uint8_t PREVIEW_MAX_CLIENTS = 4;
+constexpr uint8_t PREVIEW_FRAME_BUFFERS = 3;    // Snapshots that can be in flight at once
+
+// Counters reported via /api/metrics
+struct PreviewStats {
+    uint32_t snapshots = 0;     // Changed frames copied from the strip
+    uint32_t sent = 0;          // Frames broadcast
+    uint32_t bytes = 0;
+    uint32_t dropped = 0;       // Frames a client missed (queue full)
+    uint32_t busy = 0;          // All snapshot buffers still in flight, frame skipped
+};
+
+extern PreviewStats previewStats;
+
+// Register /ws/preview on the web server
+void setupLedPreview(AsyncWebServer &server);
+
+// LED loop, after FastLED.show(): snapshot the frame if a client is due
+void previewFrame(const CRGB *pixels, uint16_t count, uint8_t brightness);
+
+void serializeLedPreview(JsonObject out);
+
+#endif
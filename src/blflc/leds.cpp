@@ -1,5 +1,12 @@
 #include "leds.h"
+#include <WiFi.h>
 #include "logserial.h"
+#include "statefilter.h"
+#include "mqttparsingutility.h"
+#include "printersession.h"
+#include "latencytrace.h"
+#include "liveness.h"
+#include "ledpreview.h"
 
 // LED array
 CRGB leds[MAX_LEDS];
@@ -163,6 +170,10 @@ void setupLeds()
 // Set current color and pattern (replaces tweenToColor)
 void setLedState(CRGB color, uint8_t pattern, CRGB bgColor)
 {
+    if (color != currentColor || pattern != currentPattern || bgColor != currentBgColor)
+    {
+        stateFilterStats.ledChanges++;
+    }
 
     currentColor = color;
     currentPattern = pattern;
@@ -202,14 +213,65 @@ bool areLedsOff()
     return currentColor == CRGB::Black;
 }
 
-void printLogs(String Desc, COLOR thisColor)
+// Names for LedReason codes, indexed by code
+static const char *const ledReasonNames[REASON_COUNT] PROGMEM = {
+    "Initializing",
+    "Maintenance Mode",
+    "WiFi Signal Strength",
+    "Color Test",
+    "RGB Cycle",
+    "Progress Bar",
+    "Booting",
+    "Door Toggle",
+    "Filament Runout",
+    "Front Cover Open",
+    "Nozzle Temp Fail",
+    "Bed Temp Fail",
+    "HMS Serious Error",
+    "HMS Fatal Error",
+    "Error",
+    "First Layer Error",
+    "Nozzle Clog",
+    "Paused",
+    "Printer Offline",
+    "Chamber Light Off",
+    "Cleaning Nozzle",
+    "Bed Leveling",
+    "Calibrating Extrusion",
+    "Scanning Bed",
+    "First Layer Scan",
+    "Calibrating Lidar",
+    "Idle Timeout",
+    "Preheating",
+    "Printing",
+    "Preparing",
+    "Idle",
+    "Failed",
+    "Homing",
+    "Offline",
+    "Print Finished",
+    "Chamber Light On",
+    "HMS Catalogue",
+};
+
+const char *ledReasonName(uint8_t reason)
+{
+    if (reason >= REASON_COUNT)
+        return "Unknown";
+    return (const char *)pgm_read_ptr(&ledReasonNames[reason]);
+}
+
+// Records the reason of the LED state a handler just set and logs it
+void printLogs(uint8_t reason, const COLOR &thisColor)
 {
     static COLOR lastColor = {0, 0, 0, ""};
-    static String lastDesc = "";
+    static uint8_t lastReason = REASON_COUNT;
     static unsigned long lastPrintTime = 0;
 
+    printerVariables.ledReason = reason;
+
     // Skip if same state and printed less than 3 seconds ago
-    if (Desc == lastDesc &&
+    if (reason == lastReason &&
         thisColor.r == lastColor.r &&
         thisColor.g == lastColor.g &&
         thisColor.b == lastColor.b &&
@@ -220,7 +282,7 @@ void printLogs(String Desc, COLOR thisColor)
 
     if (printerConfig.debugging || printerConfig.debugOnChange)
     {
-        LogSerial.printf("%s - Turning LEDs to:", Desc.c_str());
+        LogSerial.printf("%s - Turning LEDs to:", ledReasonName(reason));
         if ((thisColor.r + thisColor.g + thisColor.b) == 0)
         {
             LogSerial.println(" OFF");
@@ -234,17 +296,17 @@ void printLogs(String Desc, COLOR thisColor)
     }
 
     lastColor = thisColor;
-    lastDesc = Desc;
+    lastReason = reason;
     lastPrintTime = millis();
 }
 
-void printLogs(String Desc, uint8_t r, uint8_t g, uint8_t b)
+void printLogs(uint8_t reason, uint8_t r, uint8_t g, uint8_t b)
 {
     COLOR tempColor;
     tempColor.r = r;
     tempColor.g = g;
     tempColor.b = b;
-    printLogs(Desc, tempColor);
+    printLogs(reason, tempColor);
 }
 
 // ============================================================================
@@ -260,7 +322,7 @@ bool handleMaintenanceMode()
     setRelayState(true);
     setLedState(CRGB::White, PATTERN_SOLID);
     printerConfig.maintMode_update = false;
-    printLogs("Maintenance Mode", 255, 255, 255);
+    printLogs(REASON_MAINTENANCE, 255, 255, 255);
     LogSerial.printf("[%lu] ** Maintenance Mode **\n", millis());
     return true;
 }
@@ -271,6 +333,7 @@ bool handleWifiDebugMode()
     if (!printerConfig.debugwifi)
         return false;
 
+    printerVariables.ledReason = REASON_WIFI_SIGNAL;
     if (WiFi.status() == WL_CONNECTED)
     {
         long wifiNow = WiFi.RSSI();
@@ -305,7 +368,7 @@ bool handleTestColorMode()
 
     setRelayState(true);
     setLedColor(printerConfig.testColor);
-    printLogs("LED Test ON", printerConfig.testColor);
+    printLogs(REASON_COLOR_TEST, printerConfig.testColor);
     LogSerial.printf("[%lu] ** Test Color Mode **\n", millis());
     printerConfig.testcolor_update = false;
     return true;
@@ -317,6 +380,7 @@ bool handleProgressBarMode()
     if (!printerConfig.progressBarEnabled)
         return false;
 
+    printerVariables.ledReason = REASON_PROGRESS_BAR;
     // Only show progress bar when printing
     if (printerVariables.gcodeState == "RUNNING" && printerVariables.stage == 0)
     {
@@ -349,6 +413,7 @@ bool handleDiscoMode()
     if (!printerConfig.discoMode)
         return false;
 
+    printerVariables.ledReason = REASON_RGB_CYCLE;
     if (printerConfig.discoMode_update)
     {
         printerConfig.discoMode_update = false;
@@ -374,6 +439,7 @@ bool handleInitialBoot()
         return false;
 
     printerVariables.initializedLEDs = true;
+    printerVariables.ledReason = REASON_BOOTING;
     printerConfig.inactivityStartms = millis();
     printerConfig.isIdleOFFActive = false;
     printerVariables.waitingForDoor = false;
@@ -389,6 +455,7 @@ bool handleDoorDoubleTap()
     if (!printerVariables.doorSwitchTriggered)
         return false;
 
+    printerVariables.ledReason = REASON_DOOR_TOGGLE;
     bool ledsAreOff = areLedsOff();
     bool chamberLightIsOff = !printerVariables.printerLedState;
 
@@ -430,12 +497,21 @@ bool handleErrorStates()
     if (!printerConfig.errordetection)
         return false;
 
+    // HMS code with a dedicated color in the HMS catalogue
+    if (printerVariables.hmsstate && printerVariables.hmsColorOverride)
+    {
+        setRelayState(true);
+        setLedState(printerVariables.hmsColor, printerVariables.hmsPattern);
+        printLogs(REASON_HMS_CATALOGUE, printerVariables.hmsColor);
+        return true;
+    }
+
     // Filament runout (Stage 6)
     if (printerVariables.stage == 6 || printerVariables.overridestage == 6)
     {
         setRelayState(true);
         setLedState(printerConfig.filamentRunoutRGB, printerConfig.filamentRunoutPattern);
-        printLogs("Stage 6, FILAMENT RUNOUT", printerConfig.filamentRunoutRGB);
+        printLogs(REASON_FILAMENT_RUNOUT, printerConfig.filamentRunoutRGB);
         return true;
     }
 
@@ -444,7 +520,7 @@ bool handleErrorStates()
     {
         setRelayState(true);
         setLedState(printerConfig.frontCoverRGB, printerConfig.frontCoverPattern);
-        printLogs("Stage 17, FRONT COVER REMOVED", printerConfig.frontCoverRGB);
+        printLogs(REASON_FRONT_COVER, printerConfig.frontCoverRGB);
         return true;
     }
 
@@ -453,7 +529,7 @@ bool handleErrorStates()
     {
         setRelayState(true);
         setLedState(printerConfig.nozzleTempRGB, printerConfig.nozzleTempPattern);
-        printLogs("Stage 20, NOZZLE TEMP FAIL", printerConfig.nozzleTempRGB);
+        printLogs(REASON_NOZZLE_TEMP_FAIL, printerConfig.nozzleTempRGB);
         return true;
     }
 
@@ -462,27 +538,27 @@ bool handleErrorStates()
     {
         setRelayState(true);
         setLedState(printerConfig.bedTempRGB, printerConfig.bedTempPattern);
-        printLogs("Stage 21, BED TEMP FAIL", printerConfig.bedTempRGB);
+        printLogs(REASON_BED_TEMP_FAIL, printerConfig.bedTempRGB);
         return true;
     }
 
     // HMS Serious
-    if (printerVariables.parsedHMSlevel == "Serious")
+    if (printerVariables.parsedHMSlevel == HMS_SERIOUS)
     {
         setRelayState(true);
         setLedState(printerConfig.hmsSeriousRGB, printerConfig.hmsSeriousPattern);
         LogSerial.printf("HMS SERIOUS Severity - Error Code: %016llX\n", printerVariables.parsedHMScode);
-        printLogs("PROBLEM", printerConfig.hmsSeriousRGB);
+        printLogs(REASON_HMS_SERIOUS, printerConfig.hmsSeriousRGB);
         return true;
     }
 
     // HMS Fatal
-    if (printerVariables.parsedHMSlevel == "Fatal")
+    if (printerVariables.parsedHMSlevel == HMS_FATAL)
     {
         setRelayState(true);
         setLedState(printerConfig.hmsFatalRGB, printerConfig.hmsFatalPattern);
         LogSerial.printf("HMS FATAL Severity - Error Code: %016llX\n", printerVariables.parsedHMScode);
-        printLogs("PROBLEM", printerConfig.hmsFatalRGB);
+        printLogs(REASON_HMS_FATAL, printerConfig.hmsFatalRGB);
         return true;
     }
 
@@ -498,7 +574,7 @@ bool handlePauseStates()
     {
         setRelayState(true);
         setLedState(printerConfig.pauseRGB, printerConfig.pausePattern);
-        printLogs("PAUSED", printerConfig.pauseRGB);
+        printLogs(REASON_PAUSED, printerConfig.pauseRGB);
         return true;
     }
 
@@ -507,7 +583,7 @@ bool handlePauseStates()
     {
         setRelayState(true);
         setLedState(printerConfig.firstlayerRGB, printerConfig.firstlayerPattern);
-        printLogs("Stage 34, FIRST LAYER ERROR", printerConfig.firstlayerRGB);
+        printLogs(REASON_FIRST_LAYER_ERROR, printerConfig.firstlayerRGB);
         return true;
     }
 
@@ -516,7 +592,7 @@ bool handlePauseStates()
     {
         setRelayState(true);
         setLedState(printerConfig.nozzleclogRGB, printerConfig.nozzleclogPattern);
-        printLogs("Stage 35, NOZZLE CLOG", printerConfig.nozzleclogRGB);
+        printLogs(REASON_NOZZLE_CLOG, printerConfig.nozzleclogRGB);
         return true;
     }
 
@@ -526,13 +602,13 @@ bool handlePauseStates()
 // Handle Off States
 bool handleOffStates()
 {
-    // Printer offline
+    // Printer offline: confirmed dark, or disconnected for MQTT_OFFLINE_TIMEOUT_MS
     if (!printerVariables.online &&
-        (millis() - printerVariables.disconnectMQTTms) >= MQTT_OFFLINE_TIMEOUT_MS)
+        (printerLiveness.isDark() || (millis() - printerVariables.disconnectMQTTms) >= MQTT_OFFLINE_TIMEOUT_MS))
     {
         setLedsOff();
         setRelayState(false);
-        printLogs("Printer offline", 0, 0, 0);
+        printLogs(REASON_PRINTER_OFFLINE, 0, 0, 0);
         return true;
     }
 
@@ -542,7 +618,7 @@ bool handleOffStates()
     {
         setLedsOff();
         setRelayState(false);
-        printLogs("LED Replication OFF", 0, 0, 0);
+        printLogs(REASON_CHAMBER_LIGHT_OFF, 0, 0, 0);
         printerConfig.replicate_update = false;
         return true;
     }
@@ -558,7 +634,7 @@ bool handleStageColors()
     {
         setRelayState(true);
         setLedState(printerConfig.stage14Color, printerConfig.stage14Pattern);
-        printLogs("Stage 14, CLEANING NOZZLE", printerConfig.stage14Color);
+        printLogs(REASON_CLEANING_NOZZLE, printerConfig.stage14Color);
         return true;
     }
 
@@ -567,7 +643,7 @@ bool handleStageColors()
     {
         setRelayState(true);
         setLedState(printerConfig.stage1Color, printerConfig.stage1Pattern);
-        printLogs("Stage 1, BED LEVELING", printerConfig.stage1Color);
+        printLogs(REASON_BED_LEVELING, printerConfig.stage1Color);
         return true;
     }
 
@@ -576,7 +652,7 @@ bool handleStageColors()
     {
         setRelayState(true);
         setLedState(printerConfig.stage8Color, printerConfig.stage8Pattern);
-        printLogs("Stage 8, CALIBRATING EXTRUSION", printerConfig.stage8Color);
+        printLogs(REASON_CALIBRATING_EXTRUSION, printerConfig.stage8Color);
         return true;
     }
 
@@ -585,7 +661,7 @@ bool handleStageColors()
     {
         setRelayState(true);
         setLedState(printerConfig.stage9Color, printerConfig.stage9Pattern);
-        printLogs("Stage 9, SCANNING BED SURFACE", printerConfig.stage9Color);
+        printLogs(REASON_SCANNING_BED, printerConfig.stage9Color);
         return true;
     }
 
@@ -594,7 +670,7 @@ bool handleStageColors()
     {
         setRelayState(true);
         setLedState(printerConfig.stage10Color, printerConfig.stage10Pattern);
-        printLogs("Stage 10, FIRST LAYER INSPECTION", printerConfig.stage10Color);
+        printLogs(REASON_FIRST_LAYER_SCAN, printerConfig.stage10Color);
         return true;
     }
 
@@ -603,7 +679,7 @@ bool handleStageColors()
     {
         setRelayState(true);
         setLedState(printerConfig.stage10Color, printerConfig.stage10Pattern);
-        printLogs("Stage 12, CALIBRATING MICRO LIDAR", printerConfig.stage10Color);
+        printLogs(REASON_CALIBRATING_LIDAR, printerConfig.stage10Color);
         return true;
     }
 
@@ -623,6 +699,7 @@ bool handleIdleTimeout(bool inFinishWindow)
         setRelayState(false);
         controlChamberLight(false);
         printerConfig.isIdleOFFActive = true;
+        printerVariables.ledReason = REASON_IDLE_TIMEOUT;
         if (printerConfig.debugging || printerConfig.debugOnChange)
         {
             LogSerial.printf("Idle Timeout [%d mins] - Turning LEDs OFF\n",
@@ -633,6 +710,22 @@ bool handleIdleTimeout(bool inFinishWindow)
     return false;
 }
 
+// Color while a print is active: the filament of the active AMS tray if mirroring is on
+static COLOR printingColor()
+{
+    if (printerConfig.amsColorMirror && printerVariables.amsColorValid)
+        return printerVariables.amsColor;
+    return printerConfig.runningColor;
+}
+
+// Running pattern for states outside a print (idle, failed, offline, chamber
+// light): the telemetry patterns follow the print, so these show it solid
+static uint8_t idlePattern()
+{
+    uint8_t pattern = printerConfig.runningPattern;
+    return (pattern == PATTERN_HEATMAP || pattern == PATTERN_LAYER_PULSE) ? PATTERN_SOLID : pattern;
+}
+
 // Handle Running/Active States
 bool handleRunningStates(bool inFinishWindow)
 {
@@ -640,8 +733,8 @@ bool handleRunningStates(bool inFinishWindow)
     if (printerVariables.stage == 2)
     {
         setRelayState(true);
-        setLedState(printerConfig.runningColor, printerConfig.runningPattern);
-        printLogs("Stage 2, PREHEATING BED", printerConfig.runningColor);
+        setLedState(printingColor(), printerConfig.runningPattern);
+        printLogs(REASON_PREHEATING, printingColor());
         return true;
     }
 
@@ -649,8 +742,8 @@ bool handleRunningStates(bool inFinishWindow)
     if (printerVariables.stage == 0 && printerVariables.gcodeState == "RUNNING")
     {
         setRelayState(true);
-        setLedState(printerConfig.runningColor, printerConfig.runningPattern);
-        printLogs("PRINTING", printerConfig.runningColor);
+        setLedState(printingColor(), printerConfig.runningPattern);
+        printLogs(REASON_PRINTING, printingColor());
         return true;
     }
 
@@ -660,8 +753,8 @@ bool handleRunningStates(bool inFinishWindow)
         (millis() - printerConfig.inactivityStartms < printerConfig.inactivityTimeOut))
     {
         setRelayState(true);
-        setLedState(printerConfig.runningColor, printerConfig.runningPattern);
-        printLogs("IDLE", printerConfig.runningColor);
+        setLedState(printerConfig.runningColor, idlePattern());
+        printLogs(REASON_IDLE, printerConfig.runningColor);
         return true;
     }
 
@@ -669,8 +762,8 @@ bool handleRunningStates(bool inFinishWindow)
     if (printerVariables.gcodeState == "FAILED")
     {
         setRelayState(true);
-        setLedState(printerConfig.runningColor, printerConfig.runningPattern);
-        printLogs("FAILED", printerConfig.runningColor);
+        setLedState(printerConfig.runningColor, idlePattern());
+        printLogs(REASON_FAILED, printerConfig.runningColor);
         return true;
     }
 
@@ -678,8 +771,8 @@ bool handleRunningStates(bool inFinishWindow)
     if (printerVariables.gcodeState == "PREPARE")
     {
         setRelayState(true);
-        setLedState(printerConfig.runningColor, printerConfig.runningPattern);
-        printLogs("PREPARE", printerConfig.runningColor);
+        setLedState(printingColor(), printerConfig.runningPattern);
+        printLogs(REASON_PREPARING, printingColor());
         return true;
     }
 
@@ -687,6 +780,7 @@ bool handleRunningStates(bool inFinishWindow)
     if (printerVariables.stage == 13)
     {
         LogSerial.println(F("STAGE 13, HOMING TOOL HEAD"));
+        printerVariables.ledReason = REASON_HOMING;
         return true;
     }
 
@@ -694,8 +788,8 @@ bool handleRunningStates(bool inFinishWindow)
     if (printerVariables.gcodeState == "OFFLINE" || printerVariables.stage == -2)
     {
         setRelayState(true);
-        setLedState(printerConfig.runningColor, printerConfig.runningPattern);
-        printLogs("OFFLINE", printerConfig.runningColor);
+        setLedState(printerConfig.runningColor, idlePattern());
+        printLogs(REASON_OFFLINE, printerConfig.runningColor);
         return true;
     }
 
@@ -709,7 +803,7 @@ bool handleFinishIndication()
     {
         setRelayState(true);
         setLedState(printerConfig.finishColor, printerConfig.finishPattern);
-        printLogs("Finished print", printerConfig.finishColor);
+        printLogs(REASON_PRINT_FINISHED, printerConfig.finishColor);
         printerVariables.finished = false;
         return true;
     }
@@ -723,8 +817,8 @@ bool handleLedReplicationOn(bool inFinishWindow)
         printerVariables.printerLedState && !inFinishWindow)
     {
         setRelayState(true);
-        setLedState(printerConfig.runningColor, printerConfig.runningPattern);
-        printLogs("LED Replication ON", printerConfig.runningColor);
+        setLedState(printerConfig.runningColor, idlePattern());
+        printLogs(REASON_CHAMBER_LIGHT_ON, printerConfig.runningColor);
         printerConfig.replicate_update = false;
         return true;
     }
@@ -734,7 +828,24 @@ bool handleLedReplicationOn(bool inFinishWindow)
 // ============================================================================
 // Main LED Update Dispatcher
 // ============================================================================
+static void resolveLedState();
+
 void updateleds()
+{
+    uint32_t ledChangesBefore = stateFilterStats.ledChanges;
+
+    resolveLedState();
+
+    stateFilterStats.resolves++;
+    if (stateFilterStats.ledChanges == ledChangesBefore)
+    {
+        stateFilterStats.redundantResolves++;
+    }
+
+    traceResolved();
+}
+
+static void resolveLedState()
 {
     // Prevent replicate OFF immediately after door event
     if ((millis() - printerVariables.lastdoorOpenms) < DOOR_DEBOUNCE_MS ||
@@ -744,11 +855,12 @@ void updateleds()
     }
 
     // Priority 1: Special modes (highest priority)
-    if (handleMaintenanceMode()) { printerVariables.ledReason = "Maintenance Mode"; return; }
-    if (handleWifiDebugMode()) { printerVariables.ledReason = "WiFi Signal Strength"; return; }
-    if (handleTestColorMode()) { printerVariables.ledReason = "Color Test"; return; }
-    if (handleDiscoMode()) { printerVariables.ledReason = "RGB Cycle"; return; }
-    if (handleProgressBarMode()) { printerVariables.ledReason = "Progress Bar"; return; }
+    // Each handler records its own printerVariables.ledReason
+    if (handleMaintenanceMode()) return;
+    if (handleWifiDebugMode()) return;
+    if (handleTestColorMode()) return;
+    if (handleDiscoMode()) return;
+    if (handleProgressBarMode()) return;
 
     // Debug output
     if (printerConfig.debugging)
@@ -758,11 +870,11 @@ void updateleds()
                          printerVariables.gcodeState.c_str(),
                          printerVariables.printerLedState ? "true" : "false",
                          printerVariables.hmsstate ? "true" : "false",
-                         printerVariables.parsedHMSlevel.c_str());
+                         hmsSeverityName(printerVariables.parsedHMSlevel));
     }
 
     // Priority 2: Initial boot
-    if (handleInitialBoot()) { printerVariables.ledReason = "Booting"; return; }
+    if (handleInitialBoot()) return;
 
     // Skip remaining handlers if in special mode
     if (printerConfig.testcolorEnabled || printerConfig.maintMode ||
@@ -773,94 +885,35 @@ void updateleds()
     }
 
     // Priority 3: Door interaction
-    if (handleDoorDoubleTap()) { printerVariables.ledReason = "Door Toggle"; return; }
+    if (handleDoorDoubleTap()) return;
 
     // Priority 4: Error states (red indicators)
-    if (handleErrorStates()) {
-        // Set specific reason based on current error
-        if (printerVariables.stage == 6 || printerVariables.overridestage == 6)
-            printerVariables.ledReason = "Filament Runout";
-        else if (printerVariables.stage == 17 || printerVariables.overridestage == 17)
-            printerVariables.ledReason = "Front Cover Open";
-        else if (printerVariables.stage == 20 || printerVariables.overridestage == 20)
-            printerVariables.ledReason = "Nozzle Temp Fail";
-        else if (printerVariables.stage == 21 || printerVariables.overridestage == 21)
-            printerVariables.ledReason = "Bed Temp Fail";
-        else if (printerVariables.parsedHMSlevel == "Serious")
-            printerVariables.ledReason = "HMS Serious Error";
-        else if (printerVariables.parsedHMSlevel == "Fatal")
-            printerVariables.ledReason = "HMS Fatal Error";
-        else
-            printerVariables.ledReason = "Error";
-        return;
-    }
+    if (handleErrorStates()) return;
 
     // Priority 5: Pause states (blue indicators)
-    if (handlePauseStates()) {
-        if (printerVariables.stage == 34)
-            printerVariables.ledReason = "First Layer Error";
-        else if (printerVariables.stage == 35)
-            printerVariables.ledReason = "Nozzle Clog";
-        else
-            printerVariables.ledReason = "Paused";
-        return;
-    }
+    if (handlePauseStates()) return;
 
     // Priority 6: Off states
-    if (handleOffStates()) {
-        if (!printerVariables.online)
-            printerVariables.ledReason = "Printer Offline";
-        else
-            printerVariables.ledReason = "Chamber Light Off";
-        return;
-    }
+    if (handleOffStates()) return;
 
     // Priority 7: Stage-specific colors
-    if (handleStageColors()) {
-        if (printerVariables.stage == 14)
-            printerVariables.ledReason = "Cleaning Nozzle";
-        else if (printerVariables.stage == 1)
-            printerVariables.ledReason = "Bed Leveling";
-        else if (printerVariables.stage == 8)
-            printerVariables.ledReason = "Calibrating Extrusion";
-        else if (printerVariables.stage == 9)
-            printerVariables.ledReason = "Scanning Bed";
-        else if (printerVariables.stage == 10 || printerVariables.overridestage == 10)
-            printerVariables.ledReason = "First Layer Scan";
-        else if (printerVariables.stage == 12)
-            printerVariables.ledReason = "Calibrating Lidar";
-        else
-            printerVariables.ledReason = "Stage " + String(printerVariables.stage);
-        return;
-    }
+    if (handleStageColors()) return;
 
     // Calculate finish window for remaining handlers
     bool inFinishWindow = (printerConfig.finishExit && printerVariables.waitingForDoor) ||
                           (!printerConfig.finishExit && ((millis() - printerConfig.finishStartms) < printerConfig.finishTimeOut));
 
     // Priority 8: Idle timeout
-    if (handleIdleTimeout(inFinishWindow)) { printerVariables.ledReason = "Idle Timeout"; return; }
+    if (handleIdleTimeout(inFinishWindow)) return;
 
     // Priority 9: Running/active states
-    if (handleRunningStates(inFinishWindow)) {
-        if (printerVariables.stage == 2)
-            printerVariables.ledReason = "Preheating";
-        else if (printerVariables.stage == 0 && printerVariables.gcodeState == "RUNNING")
-            printerVariables.ledReason = "Printing";
-        else if (printerVariables.gcodeState == "PREPARE")
-            printerVariables.ledReason = "Preparing";
-        else if (printerVariables.stage == -1 || printerVariables.stage == 255)
-            printerVariables.ledReason = "Idle";
-        else
-            printerVariables.ledReason = printerVariables.gcodeState;
-        return;
-    }
+    if (handleRunningStates(inFinishWindow)) return;
 
     // Priority 10: Finish indication
-    if (handleFinishIndication()) { printerVariables.ledReason = "Print Finished"; return; }
+    if (handleFinishIndication()) return;
 
     // Priority 11: LED replication ON
-    if (handleLedReplicationOn(inFinishWindow)) { printerVariables.ledReason = "Chamber Light On"; return; }
+    if (handleLedReplicationOn(inFinishWindow)) return;
 
     // Ensure doorSwitchTriggered is processed (recursive call if needed)
     if (printerVariables.doorSwitchTriggered)
@@ -869,49 +922,10 @@ void updateleds()
     }
 }
 
-void ledsloop()
+// Door interaction after a finish, finish window, inactivity and chamber
+// light timeouts
+void checkLedTimers()
 {
-    // Apply current pattern to LED array
-    uint16_t count = min((uint16_t)printerConfig.ledConfig.ledCount, MAX_LEDS);
-
-    // Handle test mode separately (it manages its own patterns)
-    if (printerConfig.ledTestMode)
-    {
-        if (!runTestSequence(leds, count, patternState))
-        {
-            // Test complete
-            printerConfig.ledTestMode = false;
-            setRelayState(false);
-            LogSerial.println(F("[LED] Test sequence complete"));
-        }
-    }
-    else
-    {
-        setRelayState(true);
-        applyPattern(leds, count, currentPattern, currentColor,
-                     patternState, currentBgColor, printerVariables.printProgress);
-    }
-
-    FastLED.setBrightness(printerConfig.brightness * 255 / 100);
-    FastLED.show();
-
-    // Periodic status logging
-    if ((millis() - lastUpdatems) > MQTT_OFFLINE_TIMEOUT_MS &&
-        (printerConfig.maintMode || printerConfig.testcolorEnabled ||
-         printerConfig.discoMode || printerConfig.debugwifi))
-    {
-        LogSerial.printf("[%lu] ", millis());
-        if (printerConfig.maintMode)
-            LogSerial.println(F("Maintenance Mode - next update in 30 seconds"));
-        if (printerConfig.testcolorEnabled)
-            LogSerial.println(F("Test Color - next update in 30 seconds"));
-        if (printerConfig.discoMode)
-            LogSerial.println(F("RGB Cycle Mode - next update in 30 seconds"));
-        if (printerConfig.debugwifi)
-            LogSerial.println(F("WiFi Debug Mode - next update in 30 seconds"));
-        lastUpdatems = millis();
-    }
-
     // Finish indication door interaction check
     if (printerVariables.waitingForDoor && printerConfig.finishIndication &&
         printerConfig.finishExit &&
@@ -963,6 +977,56 @@ void ledsloop()
         if (printerConfig.debugOnChange)
             LogSerial.println(F("[LED] Timeout - Chamber light OFF and lock released"));
     }
+}
+
+void ledsloop()
+{
+    // Apply current pattern to LED array
+    uint16_t count = min((uint16_t)printerConfig.ledConfig.ledCount, MAX_LEDS);
+
+    // Handle test mode separately (it manages its own patterns)
+    if (printerConfig.ledTestMode)
+    {
+        if (!runTestSequence(leds, count, patternState))
+        {
+            // Test complete
+            printerConfig.ledTestMode = false;
+            setRelayState(false);
+            LogSerial.println(F("[LED] Test sequence complete"));
+        }
+    }
+    else
+    {
+        setRelayState(true);
+        applyPattern(leds, count, currentPattern, currentColor,
+                     patternState, currentBgColor, printerVariables.printProgress, &printerTelemetry);
+        renderPrinterSegments(leds, count);
+        traceFrameRendered();
+    }
+
+    FastLED.setBrightness(printerConfig.brightness * 255 / 100);
+    FastLED.show();
+    traceFrameShown();
+    previewFrame(leds, count, FastLED.getBrightness());
+
+    // Periodic status logging
+    if ((millis() - lastUpdatems) > MQTT_OFFLINE_TIMEOUT_MS &&
+        (printerConfig.maintMode || printerConfig.testcolorEnabled ||
+         printerConfig.discoMode || printerConfig.debugwifi))
+    {
+        LogSerial.printf("[%lu] ", millis());
+        if (printerConfig.maintMode)
+            LogSerial.println(F("Maintenance Mode - next update in 30 seconds"));
+        if (printerConfig.testcolorEnabled)
+            LogSerial.println(F("Test Color - next update in 30 seconds"));
+        if (printerConfig.discoMode)
+            LogSerial.println(F("RGB Cycle Mode - next update in 30 seconds"));
+        if (printerConfig.debugwifi)
+            LogSerial.println(F("WiFi Debug Mode - next update in 30 seconds"));
+        lastUpdatems = millis();
+    }
+
+    checkLedTimers();
 
     delay(10);
 }
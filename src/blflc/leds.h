@@ -70,8 +70,9 @@ void setLedsOff();
 bool areLedsOff();
 
 // Logging functions
-void printLogs(String Desc, COLOR thisColor);
-void printLogs(String Desc, uint8_t r, uint8_t g, uint8_t b);
+const char *ledReasonName(uint8_t reason);
+void printLogs(uint8_t reason, const COLOR &thisColor);
+void printLogs(uint8_t reason, uint8_t r, uint8_t g, uint8_t b);
 
 // LED State Handlers
 bool handleMaintenanceMode();
@@ -92,6 +93,9 @@ bool handleLedReplicationOn(bool inFinishWindow);
 // Main LED update dispatcher
 void updateleds();
 
+// Timeouts that change the LED state without a report
+void checkLedTimers();
+
 // Main LED loop
 void ledsloop();
 
@@ -0,0 +1,140 @@
+#include "liveness.h"
+#include <Client.h>
+#include <lwip/sockets.h>
+
+LivenessTracker printerLiveness;
+
+void LivenessTracker::connected()
+{
+    state = LIVENESS_ALIVE;
+    lastRxMs = millis();
+    lastReportMs = 0;
+}
+
+void LivenessTracker::disconnected()
+{
+    if (state != LIVENESS_DARK)
+        state = LIVENESS_UNKNOWN;
+}
+
+LivenessEvent LivenessTracker::connectFailed()
+{
+    if (state == LIVENESS_DARK)
+        return LIVENESS_EVENT_NONE;
+
+    state = LIVENESS_DARK;
+    darkEvents++;
+    lastDetectMs = lastRxMs != 0 ? millis() - lastRxMs : 0;
+    return LIVENESS_EVENT_DARK;
+}
+
+LivenessEvent LivenessTracker::received()
+{
+    lastRxMs = millis();
+    if (state == LIVENESS_PROBING)
+    {
+        probesAnswered++;
+        state = LIVENESS_ALIVE;
+    }
+    else if (state == LIVENESS_DARK)
+    {
+        falsePositives++;
+        state = LIVENESS_ALIVE;
+        return LIVENESS_EVENT_ALIVE;
+    }
+    return LIVENESS_EVENT_NONE;
+}
+
+LivenessEvent LivenessTracker::reportReceived()
+{
+    unsigned long now = millis();
+    if (lastReportMs != 0)
+    {
+        // Long idle gaps are covered by the probe, they would only slow detection down
+        unsigned long interval = now - lastReportMs;
+        if (interval < LIVENESS_MAX_SILENCE_MS)
+            cadenceMs = (cadenceMs * 7 + interval) / 8;
+    }
+    lastReportMs = now;
+    return received();
+}
+
+unsigned long LivenessTracker::silenceThresholdMs() const
+{
+    return constrain(cadenceMs * LIVENESS_CADENCE_FACTOR, LIVENESS_MIN_SILENCE_MS, LIVENESS_MAX_SILENCE_MS);
+}
+
+LivenessEvent LivenessTracker::poll()
+{
+    unsigned long now = millis();
+    if (state == LIVENESS_ALIVE && now - lastRxMs >= silenceThresholdMs())
+    {
+        state = LIVENESS_PROBING;
+        probeSentMs = now;
+        probes++;
+        return LIVENESS_EVENT_PROBE;
+    }
+    if (state == LIVENESS_PROBING && now - probeSentMs >= LIVENESS_PROBE_TIMEOUT_MS)
+    {
+        state = LIVENESS_DARK;
+        darkEvents++;
+        lastDetectMs = now - lastRxMs;
+        return LIVENESS_EVENT_DARK;
+    }
+    return LIVENESS_EVENT_NONE;
+}
+
+unsigned long LivenessTracker::msUntilCheck() const
+{
+    unsigned long elapsed;
+    unsigned long limit;
+    if (state == LIVENESS_ALIVE)
+    {
+        elapsed = millis() - lastRxMs;
+        limit = silenceThresholdMs();
+    }
+    else if (state == LIVENESS_PROBING)
+    {
+        elapsed = millis() - probeSentMs;
+        limit = LIVENESS_PROBE_TIMEOUT_MS;
+    }
+    else
+    {
+        return ULONG_MAX;
+    }
+    return elapsed >= limit ? 0 : limit - elapsed;
+}
+
+void configureTcpKeepalive(int fd)
+{
+    if (fd < 0)
+        return;
+
+    int enable = 1;
+    int idle = TCP_KEEPALIVE_IDLE_S;
+    int interval = TCP_KEEPALIVE_INTERVAL_S;
+    int count = TCP_KEEPALIVE_COUNT;
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+}
+
+bool sendMqttPing(Client &client)
+{
+    static const uint8_t pingRequest[] = {0xC0, 0x00};
+    return client.write(pingRequest, sizeof(pingRequest)) == sizeof(pingRequest);
+}
+
+void serializeLiveness(const LivenessTracker &tracker, JsonObject out)
+{
+    static const char *const stateNames[] = {"unknown", "alive", "probing", "dark"};
+    out["state"] = stateNames[tracker.state];
+    out["cadenceMs"] = tracker.cadenceMs;
+    out["silenceThresholdMs"] = tracker.silenceThresholdMs();
+    out["probes"] = tracker.probes;
+    out["probesAnswered"] = tracker.probesAnswered;
+    out["darkEvents"] = tracker.darkEvents;
+    out["falsePositives"] = tracker.falsePositives;
+    out["lastDetectMs"] = tracker.lastDetectMs;
+}
@@ -0,0 +1,81 @@
+#ifndef _LIVENESS
+#define _LIVENESS
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+class Client;
+
+// Active printer liveness. The report interval of each printer is learned;
+// when the printer is silent for longer than expected it is probed with an
+// MQTT PINGREQ, and if that is not answered within LIVENESS_PROBE_TIMEOUT_MS
+// the printer is dark. Together with TCP keepalive on the socket this takes
+// about a second instead of waiting for the MQTT keepalive to expire.
+constexpr unsigned long LIVENESS_MIN_SILENCE_MS = 800;     // Shortest silence before a probe
+constexpr unsigned long LIVENESS_MAX_SILENCE_MS = 5000;    // Longest silence before a probe (idle printers)
+constexpr uint8_t LIVENESS_CADENCE_FACTOR = 2;             // Silence threshold = factor x learned interval
+constexpr unsigned long LIVENESS_PROBE_TIMEOUT_MS = 400;   // PINGRESP expected within this on the LAN
+constexpr unsigned long LIVENESS_DEFAULT_CADENCE_MS = 1000;
+
+// TCP keepalive on printer sockets (closes a dead connection in ~5 s)
+constexpr int TCP_KEEPALIVE_IDLE_S = 2;
+constexpr int TCP_KEEPALIVE_INTERVAL_S = 1;
+constexpr int TCP_KEEPALIVE_COUNT = 3;
+
+enum LivenessState : uint8_t {
+    LIVENESS_UNKNOWN = 0,   // Not connected, printer was not found dark
+    LIVENESS_ALIVE,
+    LIVENESS_PROBING,       // Silent for too long, PINGREQ sent
+    LIVENESS_DARK           // Probe / reconnect failed
+};
+
+enum LivenessEvent : uint8_t {
+    LIVENESS_EVENT_NONE = 0,
+    LIVENESS_EVENT_PROBE,   // Send a PINGREQ now
+    LIVENESS_EVENT_DARK,    // Printer went dark: show it offline
+    LIVENESS_EVENT_ALIVE    // Dark printer was heard from again
+};
+
+struct LivenessTracker {
+    LivenessState state = LIVENESS_UNKNOWN;
+    unsigned long lastRxMs = 0;
+    unsigned long lastReportMs = 0;
+    unsigned long probeSentMs = 0;
+    unsigned long cadenceMs = LIVENESS_DEFAULT_CADENCE_MS;  // Learned report interval
+
+    // Statistics reported via /api/metrics
+    uint32_t probes = 0;
+    uint32_t probesAnswered = 0;
+    uint32_t darkEvents = 0;
+    uint32_t falsePositives = 0;    // Dark, then heard from on the same connection
+    unsigned long lastDetectMs = 0; // Last data to dark
+
+    // Connection (re)established
+    void connected();
+    // Connection lost (stays dark if it was)
+    void disconnected();
+    // A reconnect failed: the printer is dark (LIVENESS_EVENT_DARK once)
+    LivenessEvent connectFailed();
+    // Any data arrived / a report arrived (learns the cadence)
+    LivenessEvent received();
+    LivenessEvent reportReceived();
+    // Check for silence / unanswered probe (call on every wakeup)
+    LivenessEvent poll();
+    // Milliseconds until poll() has something to do (ULONG_MAX if nothing)
+    unsigned long msUntilCheck() const;
+    unsigned long silenceThresholdMs() const;
+    bool isDark() const { return state == LIVENESS_DARK; }
+};
+
+// Liveness of the main printer
+extern LivenessTracker printerLiveness;
+
+// Enable TCP keepalive on a connected printer socket
+void configureTcpKeepalive(int fd);
+
+// Send an MQTT PINGREQ (PubSubClient treats the answer like its own keepalive)
+bool sendMqttPing(Client &client);
+
+void serializeLiveness(const LivenessTracker &tracker, JsonObject out);
+
+#endif
@@ -2,6 +2,16 @@
 #include "mqttparsingutility.h"
 #include "leds.h"
 #include "logserial.h"
+#include "statefilter.h"
+#include "hmscatalogue.h"
+#include "statecache.h"
+#include "reportrelay.h"
+#include "printersession.h"
+#include "reconnect.h"
+#include "latencytrace.h"
+#include "commandqueue.h"
+#include "liveness.h"
+#include "reportcapture.h"
 
 #ifdef USE_ETHERNET
 #include "eth-manager.h"
@@ -12,17 +22,17 @@
 #define NETWORK_CONNECTED() (WiFi.status() == WL_CONNECTED && WiFi.getMode() == WIFI_MODE_STA)
 #endif
 
-WiFiClientSecure wifiSecureClient;
+PrinterTlsClient wifiSecureClient;
 PubSubClient mqttClient(wifiSecureClient);
 
 String device_topic;
 String report_topic;
 String clientId = "BLFLC-";
 
-AutoGrowBufferStream stream;
-
-unsigned long mqttattempt = 0;
-unsigned long lastMQTTupdate = 0;
+ReportStream stream;
+AutoGrowBufferStream rawStream;
+MqttConnectTiming connectTiming;
+ConnectionTracker mqttConnection;
 
 TaskHandle_t mqttTaskHandle = NULL;
 bool mqttTaskRunning = false;
@@ -46,6 +56,77 @@ bool noPrinterInfo = false;
 // FINISH	    -1	        White	                After door interaction
 // FINISH	    -1	        OFF                     Inactivity after 30mins
 
+// Resolve the printer address and bring up the TLS session, timing each phase.
+// The Arduino WiFiClientSecure starts every connect with a fresh mbedTLS
+// context and offers no hook to restore a saved session, so every reconnect
+// is a full handshake; the timings below show what that costs.
+static ConnectFailure connectPrinterTls()
+{
+    connectTiming.attemptStartMs = millis();
+    connectTiming.awaitingFirstReport = false;
+
+    // Free the previous session before allocating the next one
+    wifiSecureClient.stop();
+
+    IPAddress printerAddress;
+    unsigned long phaseStart = millis();
+    if (!printerAddress.fromString(printerConfig.printerIP) &&
+        !WiFi.hostByName(printerConfig.printerIP, printerAddress))
+    {
+        connectTiming.failedPhase = CONNECT_PHASE_DNS;
+        LogSerial.print(F("[MQTT] Could not resolve printer address "));
+        LogSerial.println(printerConfig.printerIP);
+        return FAILURE_NETWORK;
+    }
+    connectTiming.dnsMs = millis() - phaseStart;
+
+    uint32_t heapBefore = ESP.getFreeHeap();
+    phaseStart = millis();
+    if (!wifiSecureClient.connect(printerAddress, 8883))
+    {
+        connectTiming.failedPhase = CONNECT_PHASE_TLS;
+        char error[64];
+        int code = wifiSecureClient.lastError(error, sizeof(error));
+        LogSerial.print(F("[MQTT] TLS connect failed: "));
+        LogSerial.println(error);
+        return classifyTlsError(code, millis() - phaseStart, MQTT_TLS_TIMEOUT_S * 1000UL);
+    }
+    connectTiming.tlsMs = millis() - phaseStart;
+    if (connectTiming.tlsMs > connectTiming.maxTlsMs)
+        connectTiming.maxTlsMs = connectTiming.tlsMs;
+    uint32_t heapAfter = ESP.getFreeHeap();
+    connectTiming.tlsHeap = heapBefore > heapAfter ? heapBefore - heapAfter : 0;
+    connectTiming.failedPhase = CONNECT_PHASE_NONE;
+    configureTcpKeepalive(wifiSecureClient.socketFd());
+    return FAILURE_NONE;
+}
+
+// React to a liveness change of the main printer
+static void applyLivenessEvent(LivenessEvent event)
+{
+    if (event == LIVENESS_EVENT_PROBE)
+    {
+        sendMqttPing(wifiSecureClient);
+    }
+    else if (event == LIVENESS_EVENT_DARK)
+    {
+        LogSerial.printf("[MQTT] Printer went dark (%lu ms since it was last heard)\n", printerLiveness.lastDetectMs);
+        printerVariables.online = false;
+        updateleds();
+    }
+    else if (event == LIVENESS_EVENT_ALIVE)
+    {
+        LogSerial.println(F("[MQTT] Printer heard from again"));
+        printerVariables.online = true;
+        updateleds();
+    }
+}
+
+bool hasPrinterInfo()
+{
+    return strlen(printerConfig.printerIP) > 0 && strlen(printerConfig.accessCode) > 0;
+}
+
 void connectMqtt()
 {
     if (mqttConnectInProgress)
@@ -59,7 +140,7 @@ void connectMqtt()
         return;
     }
 
-    if (strlen(printerConfig.printerIP) == 0 || strlen(printerConfig.accessCode) == 0)
+    if (!hasPrinterInfo())
     {
         if (noPrinterInfo == false)
         {
@@ -70,40 +151,82 @@ void connectMqtt()
         return;
     }
 
-    if (!mqttClient.connected() && (millis() - mqttattempt) >= MQTT_RETRY_INTERVAL_MS)
+    if (!mqttClient.connected() && mqttConnection.beginAttempt())
     {
         // tweenToColor(10, 10, 10, 10, 10);
         Serial.println(F("Connecting to mqtt..."));
 
-        if (mqttClient.connect(clientId.c_str(), "bblp", printerConfig.accessCode))
+        ConnectFailure failure = connectPrinterTls();
+        if (failure == FAILURE_NONE)
         {
-            Serial.print(F("[MQTT] connected, subscribing to MQTT Topic:  "));
-            Serial.println(report_topic);
-            mqttClient.subscribe(report_topic.c_str());
-            printerVariables.online = true;
-            printerVariables.disconnectMQTTms = 0;
+            // The TLS session is already up, PubSubClient only sends CONNECT
+            unsigned long phaseStart = millis();
+            if (mqttClient.connect(clientId.c_str(), "bblp", printerConfig.accessCode))
+            {
+                connectTiming.mqttMs = millis() - phaseStart;
+                mqttConnection.connected();
+
+                Serial.print(F("[MQTT] connected, subscribing to MQTT Topic:  "));
+                Serial.println(report_topic);
+                mqttClient.subscribe(report_topic.c_str());
+                connectTiming.subscribedMs = millis();
+                connectTiming.awaitingFirstReport = true;
+                stream.reset();
+                stream.forgetReport();
+                resetStateFilter();
+                beginStateBootstrap();
+                requestPushAll();
+                printerLiveness.connected();
+                printerVariables.online = true;
+                printerVariables.disconnectMQTTms = 0;
+            }
+            else
+            {
+                connectTiming.failedPhase = CONNECT_PHASE_MQTT;
+                Serial.println(F("Failed to connect with error code: "));
+                Serial.print(mqttClient.state());
+                Serial.print(F("  "));
+                ParseMQTTState(mqttClient.state());
+                failure = classifyMqttState(mqttClient.state());
+            }
         }
-        else
-        {
-            Serial.println(F("Failed to connect with error code: "));
-            Serial.print(mqttClient.state());
-            Serial.print(F("  "));
-            ParseMQTTState(mqttClient.state());
 
-            if (mqttClient.state() == 5)
+        if (failure != FAILURE_NONE)
+        {
+            mqttConnection.failed(failure);
+            if (failure == FAILURE_AUTH)
             {
-                setLedColor(CRGB(127, 0, 0)); // Red - MQTT connection failed
-                mqttattempt = millis() - MQTT_RETRY_INTERVAL_MS;
+                setLedColor(CRGB(127, 0, 0)); // Red - access code rejected
             }
+            LogSerial.printf("[MQTT] Connect failed (%s), next attempt in %lu s\n",
+                             connectFailureName(failure), mqttConnection.lastDelayMs / 1000);
+            // Not reachable at all: show it offline now instead of after MQTT_OFFLINE_TIMEOUT_MS
+            if (failure == FAILURE_NETWORK || failure == FAILURE_TIMEOUT)
+                applyLivenessEvent(printerLiveness.connectFailed());
         }
     }
 
     mqttConnectInProgress = false;
 }
 
+// Record a dropped connection once, so the reconnect starts from the base delay
+static void noteMqttDisconnect()
+{
+    if (mqttConnection.state == CONNECTION_CONNECTED)
+    {
+        mqttConnection.disconnected(classifyMqttState(mqttClient.state()));
+        printerLiveness.disconnected();
+    }
+}
+
+// The task sleeps in select() until a printer socket is readable, the next
+// deadline (keepalive, held transition, bootstrap, reconnect) is due or
+// another task calls wakeMqttTask().
 void mqttTask(void *parameter)
 {
     mqttTaskRunning = true;
+    setupSocketWait();
+    unsigned long wokeUs = 0;   // When a readable socket ended the last wait
 
     while (true)
     {
@@ -114,6 +237,8 @@ void mqttTask(void *parameter)
             continue;
         }
 
+        unsigned long waitMs = MQTT_KEEPALIVE_WAKE_MS;
+
         if (!mqttClient.connected())
         {
             printerVariables.online = false;
@@ -124,17 +249,48 @@ void mqttTask(void *parameter)
                 LogSerial.println(F("[MQTT Task] Disconnected"));
                 ParseMQTTState(mqttClient.state());
             }
+            noteMqttDisconnect();
 
             connectMqtt();
-            vTaskDelay(pdMS_TO_TICKS(32));
+            if (hasPrinterInfo())
+                waitMs = min(waitMs, mqttConnection.msUntilAttempt());
         }
         else
         {
             printerVariables.disconnectMQTTms = 0;
-            mqttClient.loop();
+            // PubSubClient handles one packet per loop() (and sends the keepalive
+            // ping when due): drain everything that has arrived
+            do
+            {
+                if (wifiSecureClient.available())
+                    applyLivenessEvent(printerLiveness.received());
+                mqttClient.loop();
+            } while (mqttClient.connected() && wifiSecureClient.available());
+            if (wokeUs != 0)
+            {
+                unsigned long dispatchUs = micros() - wokeUs;
+                if (dispatchUs > socketWaitStats.maxDispatchUs)
+                    socketWaitStats.maxDispatchUs = dispatchUs;
+            }
+            applyHeldTransitions();
+            completeStateBootstrap();
+            if (mqttClient.connected())
+            {
+                applyLivenessEvent(printerLiveness.poll());
+                waitMs = min(waitMs, printerLiveness.msUntilCheck());
+            }
+            waitMs = min(waitMs, min(msUntilSettled(), msUntilBootstrapTimeout()));
         }
 
-        vTaskDelay(pdMS_TO_TICKS(10));
+        sendQueuedCommands(mqttClient);
+        printerSessionsLoop();
+        waitMs = min(waitMs, msUntilPrinterSessionWork());
+
+        SocketWaitSet waitSet;
+        if (mqttClient.connected())
+            waitSet.add(wifiSecureClient.socketFd());
+        addPrinterSessionSockets(waitSet);
+        wokeUs = waitSet.wait(waitMs) ? micros() : 0;
     }
 
     mqttTaskRunning = false;
@@ -142,559 +298,148 @@ void mqttTask(void *parameter)
     LogSerial.printf("[MQTT Task] HighWaterMark: %d bytes\n", uxTaskGetStackHighWaterMark(NULL));
 }
 
-// ============================================================================
-// MQTT Parser Functions - Each handles a specific part of the payload
-// ============================================================================
-
-// Set up JSON filter for MQTT messages
-void setupMqttFilter(JsonDocument& filter)
-{
-    filter["print"]["command"] = true;
-    filter["print"]["fail_reason"] = true;
-    filter["print"]["gcode_state"] = true;
-    filter["print"]["print_gcode_action"] = true;
-    filter["print"]["print_real_action"] = true;
-    filter["print"]["hms"] = true;
-    filter["print"]["home_flag"] = true;
-    filter["print"]["lights_report"] = true;
-    filter["print"]["stg_cur"] = true;
-    filter["print"]["print_error"] = true;
-    filter["print"]["wifi_signal"] = true;
-    filter["print"]["mc_percent"] = true;
-    filter["system"]["command"] = true;
-    filter["system"]["led_mode"] = true;
-}
-
-// Check if command should be skipped (noise filtering)
-bool shouldSkipCommand(JsonDocument& msg)
+// Ask the printer for a full status report
+bool publishPushAll(PubSubClient &client, const String &deviceTopic)
 {
-    if (msg["print"]["command"].isNull())
-        return false;
-
-    const char* cmd = msg["print"]["command"];
-    return (strcmp(cmd, "gcode_line") == 0 ||
-            strcmp(cmd, "project_prepare") == 0 ||
-            strcmp(cmd, "project_file") == 0 ||
-            strcmp(cmd, "clean_print_error") == 0 ||
-            strcmp(cmd, "resume") == 0 ||
-            strcmp(cmd, "get_accessories") == 0 ||
-            strcmp(cmd, "prepare") == 0 ||
-            strcmp(cmd, "extrusion_cali_get") == 0);
-}
+    static const char payload[] = "{\"pushing\":{\"sequence_id\":\"0\",\"command\":\"pushall\",\"version\":1,\"push_target\":1}}";
 
-// Check if in special mode (maintenance, test, disco, wifi debug)
-bool isInSpecialMode()
-{
-    return printerConfig.maintMode || printerConfig.testcolorEnabled ||
-           printerConfig.discoMode || printerConfig.debugwifi;
+    String topic = deviceTopic + "/request";
+    return client.publish(topic.c_str(), payload);
 }
 
-// Handle door opened event
-void handleDoorOpened()
+void requestPushAll()
 {
-    printerVariables.lastdoorOpenms = millis();
-
-    // If light is off, turn it on and lock it
-    if (printerConfig.controlChamberLight && !printerVariables.printerLedState)
-    {
-        printerVariables.chamberLightLocked = true;
-        printerVariables.printerLedState = true;
-        printerConfig.replicate_update = false;
-        controlChamberLight(true);
-        printerVariables.stage = 255;
-        LogSerial.println(F("[MQTT] Door opened – Light forced ON"));
-    }
-
-    // Restart inactivity timer
-    printerConfig.inactivityStartms = millis();
-    printerConfig.isIdleOFFActive = false;
-}
-
-// Handle door closed event
-void handleDoorClosed()
-{
-    printerVariables.lastdoorClosems = millis();
-
-    // Release chamber light lock
-    if (printerConfig.controlChamberLight)
-    {
-        printerVariables.chamberLightLocked = false;
-    }
-
-    // Turn off LED bar immediately if inactivity disabled
-    if (!printerConfig.inactivityEnabled)
-    {
-        printerVariables.printerLedState = false;
-        printerConfig.replicate_update = false;
-        printerVariables.stage = 999;
-        setLedsOff();
-        controlChamberLight(false);
-        LogSerial.println(F("[MQTT] Door closed – LED bar OFF (inactivity disabled)"));
-    }
-
-    // Reset inactivity timer
-    printerConfig.inactivityStartms = millis();
-    printerConfig.isIdleOFFActive = false;
-
-    // Double-close detection for toggle
-    if ((millis() - printerVariables.lastdoorOpenms) < DOOR_DOUBLE_TAP_MS)
+    if (!publishPushAll(mqttClient, device_topic))
     {
-        printerVariables.doorSwitchTriggered = true;
+        LogSerial.println(F("[MQTT] pushall request failed"));
     }
 }
 
-// Parse door status from home_flag
-bool parseDoorStatus(JsonDocument& msg, bool& changed)
-{
-    if (msg["print"]["home_flag"].isNull())
-        return false;
-
-    long homeFlag = msg["print"]["home_flag"];
-    bool doorState = bitRead(homeFlag, 23);  // Bit 23 = door open
-
-    if (printerVariables.doorOpen == doorState)
-        return false;
-
-    printerVariables.doorOpen = doorState;
-
-    if (printerConfig.debugOnChange)
-    {
-        LogSerial.print(F("[MQTT] Door "));
-        LogSerial.println(doorState ? F("Opened") : F("Closed"));
-    }
-
-    if (doorState)
-    {
-        handleDoorOpened();
-    }
-    else
-    {
-        handleDoorClosed();
-    }
-
-    changed = true;
-    updateleds();
-    return true;
-}
-
-// Parse printer stage (stg_cur)
-bool parseStage(JsonDocument& msg, bool& changed)
-{
-    if (msg["print"]["stg_cur"].isNull())
-        return false;
-
-    int newStage = msg["print"]["stg_cur"].as<int>();
-    if (printerVariables.stage == newStage)
-        return false;
-
-    printerVariables.stage = newStage;
-
-    if (printerConfig.debugOnChange || printerConfig.debugging)
-    {
-        LogSerial.print(F("[MQTT] update - stg_cur now: "));
-        LogSerial.println(printerVariables.stage);
-    }
-
-    changed = true;
-    return true;
-}
-
-// Parse print progress percentage (mc_percent)
-bool parsePrintProgress(JsonDocument& msg, bool& changed)
+// ============================================================================
+// Main MQTT Parse Callback - Dispatcher
+// ============================================================================
+void ParseCallback(const ReportDelta& report)
 {
-    if (msg["print"]["mc_percent"].isNull())
-        return false;
+    mergeStateReport(report);
+    if (report.present & TELEMETRY_FIELDS)
+        applyTelemetry(report);
+    if (report.has(FIELD_CHAMBER_LIGHT))
+        acknowledgeLedCommand(LED_NODE_CHAMBER_LIGHT, report.chamberLightOn);
 
-    uint8_t newProgress = msg["print"]["mc_percent"].as<uint8_t>();
-    if (newProgress > 100) newProgress = 100;  // Clamp to valid range
-
-    if (printerVariables.printProgress == newProgress)
-        return false;
-
-    uint8_t oldProgress = printerVariables.printProgress;
-    printerVariables.printProgress = newProgress;
+    // Early exit for noise commands
+    if (shouldSkipCommand(report))
+        return;
 
-    // Infer RUNNING state from active print progress (for P1 printers that don't send gcode_state)
-    if (newProgress > 0 && newProgress < 100 && printerVariables.gcodeState != "RUNNING")
-    {
-        printerVariables.gcodeState = "RUNNING";
-        printerVariables.overridestage = 999;  // Reset HMS override
-        printerConfig.inactivityStartms = millis();
-        if (printerConfig.debugOnChange || printerConfig.debugging)
-        {
-            LogSerial.println(F("[MQTT] Inferred RUNNING state from print progress"));
-        }
-    }
+    // Early exit for messages without any recognised field (telemetry is stored above)
+    if ((report.present & ~TELEMETRY_FIELDS) == 0)
+        return;
 
-    // Infer FINISH state when progress reaches 100% (for P1 printers)
-    if (newProgress == 100 && oldProgress < 100 && printerVariables.gcodeState == "RUNNING")
+    // Skip reports that repeat the last processed one (push_status is resent
+    // every second), only the per-report timers need refreshing
+    if (stream.isDuplicate())
     {
-        printerVariables.gcodeState = "FINISH";
-        printerVariables.finished = true;
-        printerVariables.waitingForDoor = true;
-        printerConfig.finishStartms = millis();
-        printerConfig.finish_check = true;
-        if (printerConfig.debugOnChange || printerConfig.debugging)
+        if (report.has(FIELD_GCODE_STATE) && (millis() - lastMQTTupdate) > MQTT_STATUS_DEBOUNCE_MS)
         {
-            LogSerial.println(F("[MQTT] Inferred FINISH state from 100% progress"));
+            refreshActiveGcodeState(report.gcodeState);
         }
+        return;
     }
 
-    if (printerConfig.debugOnChange || printerConfig.debugging)
-    {
-        LogSerial.print(F("[MQTT] update - print progress: "));
-        LogSerial.print(printerVariables.printProgress);
-        LogSerial.println(F("%"));
-    }
-
-    changed = true;
-    return true;
-}
-
-// Parse gcode state
-bool parseGcodeState(JsonDocument& msg, bool& changed)
-{
-    if (msg["print"]["gcode_state"].isNull())
-        return false;
-
-    if ((millis() - lastMQTTupdate) <= MQTT_STATUS_DEBOUNCE_MS)
-        return false;
-
-    String mqttgcodeState = msg["print"]["gcode_state"].as<String>();
-
-    // Keep inactivity timer running during active states
-    if (mqttgcodeState == "RUNNING" || mqttgcodeState == "PAUSE")
-    {
-        printerConfig.inactivityStartms = millis();
-    }
-
-    // Turn on chamber light at print start
-    if (mqttgcodeState == "RUNNING" && printerConfig.controlChamberLight &&
-        !printerVariables.printerLedState)
-    {
-        controlChamberLight(true);
-        LogSerial.println(F("[MQTT] Print started – Chamber Light ON requested"));
-    }
-
-    // Handle state change
-    if (printerVariables.gcodeState == mqttgcodeState)
-        return false;
-
-    if (mqttgcodeState == "RUNNING")
-    {
-        printerVariables.overridestage = 999;  // Reset HMS override
-    }
-
-    if (mqttgcodeState == "FINISH")
+    // Debug: show the raw message (only buffered while mqttdebug is on)
+    if (printerConfig.mqttdebug && rawStream.current_length() > 0)
     {
-        printerVariables.finished = true;
-        printerVariables.waitingForDoor = true;
-        printerConfig.finishStartms = millis();
-        printerConfig.finish_check = true;
+        LogSerial.print(F("MQTT payload, ["));
+        LogSerial.print(stream.current_length());
+        LogSerial.print(F("], "));
+        LogSerial.write((const uint8_t *)rawStream.get_buffer(), rawStream.current_length());
+        if (rawStream.overflowed())
+            LogSerial.print(F("..."));
+        LogSerial.println();
     }
 
-    printerVariables.gcodeState = mqttgcodeState;
-
-    if (printerConfig.debugOnChange || printerConfig.debugging)
+    // Skip processing in special modes (but allow debug output above)
+    if (printerConfig.mqttdebug && isInSpecialMode())
     {
-        LogSerial.print(F("[MQTT] update - gcode_state now: "));
-        LogSerial.println(printerVariables.gcodeState);
+        stream.forgetReport();
+        LogSerial.print(F("[MQTT] Message Ignored while in "));
+        if (printerConfig.maintMode) LogSerial.print(F("Maintenance"));
+        if (printerConfig.testcolorEnabled) LogSerial.print(F("Test Color"));
+        if (printerConfig.discoMode) LogSerial.print(F("RGB Cycle"));
+        if (printerConfig.debugwifi) LogSerial.print(F("Wifi Debug"));
+        LogSerial.println(F(" mode"));
+        return;
     }
 
-    changed = true;
-    return true;
-}
-
-// Parse manual pause command
-bool parsePauseCommand(JsonDocument& msg, bool& changed)
-{
-    if (msg["print"]["command"].isNull())
-        return false;
-
-    if (msg["print"]["command"] != "pause")
-        return false;
-
-    lastMQTTupdate = millis();
-    LogSerial.println(F("[MQTT] update - manual PAUSE"));
-    printerVariables.gcodeState = "PAUSE";
-    changed = true;
-    return true;
-}
-
-// Parse lights report (chamber light status)
-bool parseLightsReport(JsonDocument& msg, bool& changed)
-{
-    if (msg["print"]["lights_report"].isNull())
-        return false;
-
-    if ((millis() - lastMQTTupdate) <= MQTT_STATUS_DEBOUNCE_MS)
-        return false;
+    bool changed = parseReportFields(report);
 
-    JsonArray lightsReport = msg["print"]["lights_report"];
-    for (JsonObject light : lightsReport)
+    // Reports received inside the gcode_state debounce window were not fully
+    // applied, so an identical follow-up must not be skipped
+    if ((millis() - lastMQTTupdate) > MQTT_STATUS_DEBOUNCE_MS)
     {
-        if (light["node"] != "chamber_light")
-            continue;
-
-        bool newState = (light["mode"] == "on");
-        if (printerVariables.printerLedState == newState)
-            continue;
-
-        printerVariables.printerLedState = newState;
-        printerConfig.replicate_update = true;
-
-        if (printerConfig.debugOnChange || printerConfig.debugging)
-        {
-            LogSerial.print(F("[MQTT] chamber_light now: "));
-            LogSerial.println(printerVariables.printerLedState);
-        }
-
-        if (printerVariables.waitingForDoor && printerConfig.finish_check)
-        {
-            printerVariables.finished = true;
-        }
-
-        changed = true;
+        stream.acceptReport();
     }
-    return changed;
-}
-
-// Parse system LED control commands
-bool parseSystemCommand(JsonDocument& msg, bool& changed)
-{
-    if (msg["system"]["command"].isNull())
-        return false;
-
-    if (msg["system"]["command"] != "ledctrl")
-        return false;
-
-    bool newState = (msg["system"]["led_mode"] == "on");
-    if (printerVariables.printerLedState == newState)
-        return false;
-
-    printerVariables.printerLedState = newState;
-    printerConfig.replicate_update = true;
-    lastMQTTupdate = millis();
-
-    if (printerConfig.debugOnChange || printerConfig.debugging)
+    else
     {
-        LogSerial.print(F("[MQTT] led_mode now: "));
-        LogSerial.println(printerVariables.printerLedState);
+        stream.forgetReport();
     }
 
-    if (printerVariables.waitingForDoor && printerConfig.finish_check)
+    // Apply changes if any parser detected a change
+    if (changed)
     {
-        printerVariables.finished = true;
+        applyMqttChanges();
     }
-
-    changed = true;
-    return true;
+    completeStateBootstrap();
 }
 
-// Map HMS codes to stage overrides
-void applyHMSOverride(uint64_t code)
+// The raw report is only kept for the debug log, local relay subscribers and the capture
+static Stream *rawReportTap()
 {
-    // HMS code to stage mappings
-    struct HMSMapping {
-        uint64_t code;
-        int stage;
-    };
-
-    static const HMSMapping mappings[] = {
-        {0x0C0003000003000B, 10},  // First layer inspection
-        {0x0300120000020001, 17},  // Front cover removed
-        {0x0700200000030001, 6},   // Filament runout
-        {0x0300020000010001, 20},  // Nozzle temp fail
-        {0x0300010000010007, 21},  // Bed temp fail
-    };
-
-    for (const auto& mapping : mappings)
-    {
-        if (code == mapping.code)
-        {
-            printerVariables.overridestage = mapping.stage;
-            return;
-        }
-    }
+    return (printerConfig.mqttdebug || reportRelayActive() || reportCaptureActive()) ? &rawStream : nullptr;
 }
 
-// Parse HMS (Health Management System) errors
-bool parseHMS(JsonDocument& msg, bool& changed)
+// The report has already been parsed while PubSubClient streamed it in
+void mqttCallback(char *topic, byte *payload, unsigned int length)
 {
-    if (msg["print"]["hms"].isNull())
-        return false;
-
-    String oldHMSlevel = printerVariables.parsedHMSlevel;
-
-    // Normalize ignore list once before the loop
-    String normalizedIgnoreList = printerConfig.hmsIgnoreList;
-    normalizedIgnoreList.replace("-", "_");
-    normalizedIgnoreList.replace(" ", "");
-    normalizedIgnoreList.replace("\r", "");
-    normalizedIgnoreList.replace("\n", ",");
-    String wrappedIgnoreList = "," + normalizedIgnoreList + ",";
-
-    printerVariables.hmsstate = false;
-    printerVariables.parsedHMSlevel = "";
+    applyLivenessEvent(printerLiveness.reportReceived());
 
-    for (const auto& hms : msg["print"]["hms"].as<JsonArray>())
+    if (connectTiming.awaitingFirstReport)
     {
-        uint64_t code = ((uint64_t)hms["attr"] << 32) + (uint64_t)hms["code"];
-
-        char strHMScode[32];
-        formatHMSCode(code, strHMScode, sizeof(strHMScode));
-
-        // Check ignore list
-        if (wrappedIgnoreList.indexOf("," + String(strHMScode) + ",") >= 0)
-        {
-            LogSerial.print(F("[MQTT] Ignored HMS Code: "));
-            LogSerial.println(strHMScode);
-            continue;
-        }
-
-        String severity = ParseHMSSeverity(hms["code"]);
-        if (severity != "")
+        unsigned long now = millis();
+        connectTiming.awaitingFirstReport = false;
+        connectTiming.firstReportMs = now - connectTiming.subscribedMs;
+        connectTiming.totalMs = now - connectTiming.attemptStartMs;
+        if (printerConfig.debugging || printerConfig.debugOnChange)
         {
-            printerVariables.hmsstate = true;
-            printerVariables.parsedHMSlevel = severity;
-            printerVariables.parsedHMScode = code;
+            LogSerial.printf("[MQTT] Connect timing: dns %lums, tls %lums, mqtt %lums, first report %lums (total %lums)\n",
+                             connectTiming.dnsMs, connectTiming.tlsMs, connectTiming.mqttMs,
+                             connectTiming.firstReportMs, connectTiming.totalMs);
         }
     }
 
-    if (oldHMSlevel == printerVariables.parsedHMSlevel)
-        return false;
-
-    // Apply stage override based on HMS code, or reset if no HMS error
-    if (printerVariables.parsedHMSlevel.length() > 0)
+    // Captured before parsing, so reports the parser rejects are kept as well
+    if (reportCaptureActive() && rawStream.current_length() > 0)
     {
-        applyHMSOverride(printerVariables.parsedHMScode);
-    }
-    else
-    {
-        printerVariables.overridestage = 999;
-    }
-
-    // Debug logging
-    if (printerConfig.debugging || printerConfig.debugOnChange)
-    {
-        LogSerial.print(F("[MQTT] update - parsedHMSlevel now: "));
-        if (printerVariables.parsedHMSlevel.length() > 0)
-        {
-            LogSerial.print(printerVariables.parsedHMSlevel);
-            LogSerial.print(F("      Error Code: HMS_"));
-            char strHMScode[24];
-            formatHMSCodeShort(printerVariables.parsedHMScode, strHMScode, sizeof(strHMScode));
-            LogSerial.print(strHMScode);
-            if (printerVariables.overridestage != printerVariables.stage)
-            {
-                LogSerial.println(F(" **"));
-            }
-            else
-            {
-                LogSerial.println();
-            }
-        }
+        if (rawStream.overflowed())
+            captureStats.skipped++;
         else
-        {
-            LogSerial.println(F("NULL"));
-        }
+            captureReport((const uint8_t *)rawStream.get_buffer(), rawStream.current_length(), stream.first_byte_us());
     }
 
-    changed = true;
-    return true;
-}
-
-// Apply changes after parsing (reset timers, update LEDs)
-void applyMqttChanges()
-{
-    printerConfig.inactivityStartms = millis();
-    printerConfig.isIdleOFFActive = false;
-
-    if (printerConfig.debugging)
+    if (stream.endMessage())
     {
-        LogSerial.println(F("Change from mqtt"));
+        traceReportParsed(stream.first_byte_us());
+        if (rawStream.current_length() > 0 && !rawStream.overflowed())
+            relayReport((const uint8_t *)rawStream.get_buffer(), rawStream.current_length());
+        ParseCallback(stream.report());
+        traceReportDone();
     }
-
-    printerConfig.maintMode_update = true;
-    printerConfig.discoMode_update = true;
-    printerConfig.replicate_update = true;
-    printerConfig.testcolor_update = true;
-
-    updateleds();
-}
-
-// ============================================================================
-// Main MQTT Parse Callback - Dispatcher
-// ============================================================================
-void ParseCallback(char *topic, byte *payload, unsigned int length)
-{
-    JsonDocument messageobject;
-    JsonDocument filter;
-
-    // Set up filter for relevant fields
-    setupMqttFilter(filter);
-
-    auto deserializeError = deserializeJson(messageobject, payload, length,
-                                            DeserializationOption::Filter(filter));
-    if (deserializeError)
+    else
     {
         LogSerial.println(F("Deserialize error while parsing mqtt"));
-        return;
-    }
-
-    // Early exit for noise commands
-    if (shouldSkipCommand(messageobject))
-        return;
-
-    // Early exit for empty messages
-    if (messageobject.size() == 0)
-        return;
-
-    // Debug: show filtered message
-    if (printerConfig.mqttdebug)
-    {
-        LogSerial.print(F("(Filtered) MQTT payload, ["));
-        LogSerial.print(stream.current_length());
-        LogSerial.print(F("], "));
-        serializeJson(messageobject, LogSerial);
-        LogSerial.println();
-    }
-
-    // Skip processing in special modes (but allow debug output above)
-    if (printerConfig.mqttdebug && isInSpecialMode())
-    {
-        LogSerial.print(F("[MQTT] Message Ignored while in "));
-        if (printerConfig.maintMode) LogSerial.print(F("Maintenance"));
-        if (printerConfig.testcolorEnabled) LogSerial.print(F("Test Color"));
-        if (printerConfig.discoMode) LogSerial.print(F("RGB Cycle"));
-        if (printerConfig.debugwifi) LogSerial.print(F("Wifi Debug"));
-        LogSerial.println(F(" mode"));
-        return;
     }
 
-    bool changed = false;
-
-    // Parse each section of the message
-    parseDoorStatus(messageobject, changed);
-    parseStage(messageobject, changed);
-    parsePrintProgress(messageobject, changed);
-    parseGcodeState(messageobject, changed);
-    parsePauseCommand(messageobject, changed);
-    parseLightsReport(messageobject, changed);
-    parseSystemCommand(messageobject, changed);
-    parseHMS(messageobject, changed);
-
-    // Apply changes if any parser detected a change
-    if (changed)
-    {
-        applyMqttChanges();
-    }
-}
-
-void mqttCallback(char *topic, byte *payload, unsigned int length)
-{
-    ParseCallback(topic, (byte *)stream.get_buffer(), stream.current_length());
-    stream.flush();
+    stream.reset();
+    stream.setTap(rawReportTap());
 }
 
 void controlChamberLight(bool on)
@@ -703,33 +448,10 @@ void controlChamberLight(bool on)
     if (!printerConfig.controlChamberLight)
         return;
     printerVariables.printerLedState = on; // <-- Set state flag to avoid replicate overwrite
-    if (!mqttClient.connected())
-    {
-        LogSerial.println(F("[MQTT] Skipped chamber_light control – MQTT not connected"));
-        return;
-    }
-
-    JsonDocument doc;
-    JsonObject system = doc["system"].to<JsonObject>();
-    system["command"] = "ledctrl";
-    system["sequence_id"] = "blflc_auto";
-    system["led_node"] = "chamber_light";
-    system["led_mode"] = on ? "on" : "off";
-    system["led_on_time"] = 500;
-    system["led_off_time"] = 500;
-    system["loop_times"] = 0;
-    system["interval_time"] = 1000;
-
-    String payload;
-    serializeJson(doc, payload);
-
-    String topic = String("device/") + printerConfig.serialNumber + "/request";
-    mqttClient.publish(topic.c_str(), payload.c_str());
-
-    LogSerial.print(F("[MQTT] Chamber Light "));
-    LogSerial.print(on ? F("ON") : F("OFF"));
-    LogSerial.print(F(" sent to topic: "));
-    LogSerial.println(topic);
+    // Until the printer confirms, the next report must be applied even if it
+    // is identical, or a dropped command leaves the wrong light state
+    stream.forgetReport();
+    queueLedCommand(LED_NODE_CHAMBER_LIGHT, on);
 }
 
 void setupMqtt()
@@ -740,14 +462,18 @@ void setupMqtt()
 
     device_topic = String("device/") + printerConfig.serialNumber;
     report_topic = device_topic + String("/report");
+    setCommandTopic(printerConfig.serialNumber);
 
     wifiSecureClient.setInsecure();
-    wifiSecureClient.setTimeout(15);
+    wifiSecureClient.setTimeout(MQTT_TLS_TIMEOUT_S);
     mqttClient.setSocketTimeout(17);
+    mqttClient.setKeepAlive(MQTT_KEEPALIVE_S);
     mqttClient.setBufferSize(1024);
     mqttClient.setServer(printerConfig.printerIP, 8883);
+    stream.setTap(rawReportTap());
     mqttClient.setStream(stream);
     mqttClient.setCallback(mqttCallback);
+    setupPrinterSessions();
 
     LogSerial.println(F("Finished setting up MQTT"));
 
@@ -804,6 +530,7 @@ void mqttloop()
             LogSerial.println(F("[MQTT] dropped during mqttloop"));
             ParseMQTTState(mqttClient.state());
         }
+        noteMqttDisconnect();
         // delay(500);
         connectMqtt();
         delay(32);
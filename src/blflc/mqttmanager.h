@@ -4,8 +4,9 @@
 #define TASK_RAM 20480 // 20kB for MQTT Task Stack Size
 
 // Timing constants
-constexpr unsigned long MQTT_RETRY_INTERVAL_MS = 3000;
-constexpr unsigned long MQTT_STATUS_DEBOUNCE_MS = 3000;
+constexpr uint16_t MQTT_TLS_TIMEOUT_S = 15;
+constexpr uint16_t MQTT_KEEPALIVE_S = 5;      // Short, the liveness probe covers quiet printers
+constexpr unsigned long MQTT_KEEPALIVE_WAKE_MS = MQTT_KEEPALIVE_S * 1000UL / 2; // Longest sleep while connected
 
 #include <Arduino.h>
 #include <WiFi.h>
@@ -14,10 +15,14 @@ constexpr unsigned long MQTT_STATUS_DEBOUNCE_MS = 3000;
 #include <ArduinoJson.h>
 
 #include "autogrowbufferstream.h"
+#include "socketwait.h"
+#include "reconnect.h"
+#include "reportparser.h"
+#include "printerstate.h"
 #include "types.h"
 
 // MQTT client instances
-extern WiFiClientSecure wifiSecureClient;
+extern PrinterTlsClient wifiSecureClient;
 extern PubSubClient mqttClient;
 
 // MQTT topics
@@ -25,12 +30,37 @@ extern String device_topic;
 extern String report_topic;
 extern String clientId;
 
-// Stream buffer
-extern AutoGrowBufferStream stream;
-
-// MQTT timing
-extern unsigned long mqttattempt;
-extern unsigned long lastMQTTupdate;
+// Raw copy of the report for mqttdebug (the parsing stream is in printerstate.h)
+extern AutoGrowBufferStream rawStream;
+
+// Phase in which the last connect attempt failed
+enum ConnectPhase : uint8_t {
+    CONNECT_PHASE_NONE = 0,
+    CONNECT_PHASE_DNS,
+    CONNECT_PHASE_TLS,      // TCP connect + TLS handshake
+    CONNECT_PHASE_MQTT      // CONNECT / CONNACK
+};
+
+// Duration of each phase of the last successful connect, reported via /api/metrics
+struct MqttConnectTiming {
+    unsigned long dnsMs = 0;            // Name lookup (0 for an IP address)
+    unsigned long tlsMs = 0;            // TCP connect + TLS handshake
+    unsigned long maxTlsMs = 0;
+    uint32_t tlsHeap = 0;               // Heap held by the TLS session after the handshake
+    unsigned long mqttMs = 0;           // CONNECT to CONNACK
+    unsigned long firstReportMs = 0;    // SUBSCRIBE to the first report (SUBACK is not exposed by PubSubClient)
+    unsigned long totalMs = 0;          // Start of the attempt to the first report
+    uint8_t failedPhase = CONNECT_PHASE_NONE;
+
+    unsigned long attemptStartMs = 0;
+    unsigned long subscribedMs = 0;
+    bool awaitingFirstReport = false;
+};
+
+extern MqttConnectTiming connectTiming;
+
+// Reconnect state machine of the main printer link
+extern ConnectionTracker mqttConnection;
 
 // Task management
 extern TaskHandle_t mqttTaskHandle;
@@ -39,33 +69,15 @@ extern volatile bool mqttConnectInProgress;
 
 // MQTT connection functions
 void connectMqtt();
+bool hasPrinterInfo();
 void mqttTask(void *parameter);
 
-// MQTT filter setup
-void setupMqttFilter(JsonDocument& filter);
-
-// Command filtering
-bool shouldSkipCommand(JsonDocument& msg);
-bool isInSpecialMode();
-
-// Door event handlers
-void handleDoorOpened();
-void handleDoorClosed();
-
-// Parser functions
-bool parseDoorStatus(JsonDocument& msg, bool& changed);
-bool parseStage(JsonDocument& msg, bool& changed);
-bool parsePrintProgress(JsonDocument& msg, bool& changed);
-bool parseGcodeState(JsonDocument& msg, bool& changed);
-bool parsePauseCommand(JsonDocument& msg, bool& changed);
-bool parseLightsReport(JsonDocument& msg, bool& changed);
-bool parseSystemCommand(JsonDocument& msg, bool& changed);
-void applyHMSOverride(uint64_t code);
-bool parseHMS(JsonDocument& msg, bool& changed);
-void applyMqttChanges();
+// Full status request
+void requestPushAll();
+bool publishPushAll(PubSubClient &client, const String &deviceTopic);
 
 // Main callback functions
-void ParseCallback(char *topic, byte *payload, unsigned int length);
+void ParseCallback(const ReportDelta& report);
 void mqttCallback(char *topic, byte *payload, unsigned int length);
 
 // Chamber light control
@@ -1,5 +1,7 @@
 #include "mqttparsingutility.h"
 #include "logserial.h"
+#include "types.h"
+#include <algorithm>
 
 // Format a 64-bit HMS code as "HMS_XXXX_XXXX_XXXX_XXXX" string
 // Buffer must be at least 24 bytes
@@ -20,17 +22,103 @@ void formatHMSCodeShort(uint64_t code, char* buffer, size_t bufferSize) {
     snprintf(buffer, bufferSize, "%04X_%04X_%04X_%04X", chunk1, chunk2, chunk3, chunk4);
 }
 
-String ParseHMSSeverity(int code) { // Provided by WolfWithSword
-    int parsedcode (code>>16);
+// Two banks so the MQTT task never reads a list that is being rebuilt
+static uint64_t hmsIgnoreCodes[2][MAX_HMS_IGNORE_CODES];
+static uint8_t hmsIgnoreCount[2] = {0, 0};
+static volatile uint8_t hmsIgnoreBank = 0;
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Parse a code such as "HMS_0300_0100_0001_0007" or "0300-0100-XXXX-XXXX".
+// 'X' digits are wildcards and clear the matching nibble of mask.
+bool parseHMSCodeString(const char* entry, size_t len, uint64_t& code, uint64_t& mask) {
+    while (len > 0 && (*entry == ' ' || *entry == '\t')) {
+        entry++;
+        len--;
+    }
+    if (len >= 3 && strncasecmp(entry, "HMS", 3) == 0) {
+        entry += 3;
+        len -= 3;
+    }
+
+    code = 0;
+    mask = 0;
+    uint8_t digits = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = entry[i];
+        if (c == '_' || c == '-' || c == ' ' || c == '\t') continue;
+        bool wildcard = (c == 'X' || c == 'x');
+        int value = wildcard ? 0 : hexValue(c);
+        if (value < 0 || ++digits > 16) return false;
+        code = (code << 4) | value;
+        mask = (mask << 4) | (wildcard ? 0x0 : 0xF);
+    }
+    return digits == 16;
+}
+
+void compileHMSIgnoreList(const String& list) {
+    uint8_t bank = hmsIgnoreBank ^ 1;
+    uint64_t* codes = hmsIgnoreCodes[bank];
+    uint8_t count = 0;
+
+    const char* text = list.c_str();
+    size_t start = 0;
+    size_t length = list.length();
+    for (size_t i = 0; i <= length; i++) {
+        if (i < length && text[i] != ',' && text[i] != '\n' && text[i] != '\r' && text[i] != ';') continue;
+
+        uint64_t code, mask;
+        if (i > start && parseHMSCodeString(text + start, i - start, code, mask) && mask == ~0ULL) {
+            if (count < MAX_HMS_IGNORE_CODES) {
+                codes[count++] = code;
+            } else {
+                LogSerial.println(F("[HMS] Ignore list full, remaining codes skipped"));
+                break;
+            }
+        }
+        start = i + 1;
+    }
+
+    std::sort(codes, codes + count);
+    count = std::unique(codes, codes + count) - codes;
+    hmsIgnoreCount[bank] = count;
+    hmsIgnoreBank = bank;
+}
+
+bool isHMSCodeIgnored(uint64_t code) {
+    uint8_t bank = hmsIgnoreBank;
+    const uint64_t* codes = hmsIgnoreCodes[bank];
+    return std::binary_search(codes, codes + hmsIgnoreCount[bank], code);
+}
+
+uint8_t ParseHMSSeverity(uint32_t code) { // Provided by WolfWithSword
+    uint32_t parsedcode = code >> 16;
     switch (parsedcode){
-        case 1:
-            return F("Fatal");
-        case 2:
-            return F("Serious");
-        case 3:
-            return F("Common");
-        case 4:
-            return F("Info");
+        case HMS_FATAL:
+        case HMS_SERIOUS:
+        case HMS_COMMON:
+        case HMS_INFO:
+            return parsedcode;
+        default:;
+    }
+    return HMS_NONE;
+}
+
+const char* hmsSeverityName(uint8_t severity) {
+    switch (severity){
+        case HMS_FATAL:
+            return "Fatal";
+        case HMS_SERIOUS:
+            return "Serious";
+        case HMS_COMMON:
+            return "Common";
+        case HMS_INFO:
+            return "Info";
         default:;
     }
     return "";
@@ -10,8 +10,25 @@ void formatHMSCode(uint64_t code, char* buffer, size_t bufferSize);
 // Format without "HMS_" prefix (for logging)
 void formatHMSCodeShort(uint64_t code, char* buffer, size_t bufferSize);
 
-// Parse HMS severity level from code
-String ParseHMSSeverity(int code);
+// Maximum number of codes kept from the HMS ignore list
+constexpr uint8_t MAX_HMS_IGNORE_CODES = 64;
+
+// Compile the ignore list (HMS_XXXX_XXXX_XXXX_XXXX codes separated by commas
+// or new lines) into a sorted set. Call whenever hmsIgnoreList changes.
+void compileHMSIgnoreList(const String& list);
+
+// True if the raw 64-bit HMS code is in the compiled ignore list
+bool isHMSCodeIgnored(uint64_t code);
+
+// Parse an HMS code string (with optional HMS prefix, '_' or '-' separators and
+// 'X' wildcard digits). Returns false unless there are exactly 16 digits.
+bool parseHMSCodeString(const char* text, size_t len, uint64_t& code, uint64_t& mask);
+
+// Parse HMS severity level (HMSSeverity) from the low 32 bits of the code
+uint8_t ParseHMSSeverity(uint32_t code);
+
+// Display name of an HMSSeverity ("" for HMS_NONE)
+const char* hmsSeverityName(uint8_t severity);
 
 // Parse and log MQTT connection state
 void ParseMQTTState(int code);
@@ -87,9 +87,54 @@ void applyProgressPattern(CRGB* leds, uint16_t count, CRGB color, CRGB bgColor,
     }
 }
 
+// Color of a heater from blue (ambient) to red (at target)
+static CRGB heaterColor(int16_t temp, int16_t target) {
+    uint8_t heat = 0;
+    if (target > HEATMAP_AMBIENT) {
+        int32_t span = target - HEATMAP_AMBIENT;
+        heat = (uint8_t)constrain((int32_t)(temp - HEATMAP_AMBIENT) * 255 / span, (int32_t)0, (int32_t)255);
+    }
+    // Hue 160 (blue) -> 0 (red)
+    return CHSV(160 - scale8(160, heat), 255, 255);
+}
+
+// Apply heat map pattern - nozzle on the first half, bed on the second half
+void applyHeatmapPattern(CRGB* leds, uint16_t count, const PrinterTelemetry& telemetry) {
+    uint16_t nozzleCount = count > 1 ? count / 2 : count;
+    fill_solid(leds, nozzleCount, heaterColor(telemetry.nozzleTemp, telemetry.nozzleTarget));
+    if (nozzleCount < count) {
+        fill_solid(leds + nozzleCount, count - nozzleCount, heaterColor(telemetry.bedTemp, telemetry.bedTarget));
+    }
+}
+
+// Apply layer pulse pattern - dimmed color that flashes on every layer change
+void applyLayerPulsePattern(CRGB* leds, uint16_t count, CRGB color, const PrinterTelemetry& telemetry, PatternState& state) {
+    unsigned long now = millis();
+
+    if (telemetry.layer != state.layer) {
+        // No flash for the first layer seen or a new print starting at layer 0
+        if (state.layer != 0 && telemetry.layer != 0) {
+            state.pulseStart = now;
+        }
+        state.layer = telemetry.layer;
+    }
+
+    uint8_t brightness = LAYER_PULSE_BASE;
+    unsigned long elapsed = now - state.pulseStart;
+    if (state.pulseStart != 0 && elapsed < LAYER_PULSE_MS) {
+        uint8_t fade = (uint8_t)(elapsed * 255 / LAYER_PULSE_MS);
+        brightness = 255 - scale8(255 - LAYER_PULSE_BASE, fade);
+    }
+
+    CRGB adjustedColor = color;
+    adjustedColor.nscale8(brightness);
+    fill_solid(leds, count, adjustedColor);
+}
+
 // Main pattern dispatcher
 void applyPattern(CRGB* leds, uint16_t count, uint8_t pattern, CRGB color,
-                  PatternState& state, CRGB bgColor, uint8_t progress) {
+                  PatternState& state, CRGB bgColor, uint8_t progress,
+                  const PrinterTelemetry* telemetry) {
     switch (pattern) {
         case PATTERN_SOLID:
             applySolidPattern(leds, count, color);
@@ -106,6 +151,20 @@ void applyPattern(CRGB* leds, uint16_t count, uint8_t pattern, CRGB color,
         case PATTERN_PROGRESS:
             applyProgressPattern(leds, count, color, bgColor, progress);
             break;
+        case PATTERN_HEATMAP:
+            if (telemetry) {
+                applyHeatmapPattern(leds, count, *telemetry);
+            } else {
+                applySolidPattern(leds, count, color);
+            }
+            break;
+        case PATTERN_LAYER_PULSE:
+            if (telemetry) {
+                applyLayerPulsePattern(leds, count, color, *telemetry, state);
+            } else {
+                applySolidPattern(leds, count, color);
+            }
+            break;
         default:
             applySolidPattern(leds, count, color);
             break;
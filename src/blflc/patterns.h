@@ -10,6 +10,9 @@ constexpr uint16_t BREATHING_MIN_BRIGHTNESS = 30;
 constexpr uint16_t CHASE_SPEED_MS = 50;
 constexpr uint8_t CHASE_TAIL_LENGTH = 5;
 constexpr uint16_t RAINBOW_SPEED_MS = 20;
+constexpr int16_t HEATMAP_AMBIENT = 250;        // 25 °C (0.1 °C), shown as the coldest color
+constexpr uint16_t LAYER_PULSE_MS = 600;        // Flash decay after a layer change
+constexpr uint8_t LAYER_PULSE_BASE = 80;        // Brightness between flashes
 
 // Pattern state tracking
 struct PatternState {
@@ -18,6 +21,8 @@ struct PatternState {
     uint8_t brightness = 255;
     bool increasing = true;
     uint8_t hue = 0;
+    uint16_t layer = 0;             // Last layer seen by the layer pulse
+    unsigned long pulseStart = 0;
 };
 
 // Global pattern state
@@ -43,8 +48,12 @@ void applyBreathingPattern(CRGB* leds, uint16_t count, CRGB color, PatternState&
 void applyChasePattern(CRGB* leds, uint16_t count, CRGB color, PatternState& state);
 void applyRainbowPattern(CRGB* leds, uint16_t count, PatternState& state);
 void applyProgressPattern(CRGB* leds, uint16_t count, CRGB color, CRGB bgColor, uint8_t progress);
+void applyHeatmapPattern(CRGB* leds, uint16_t count, const PrinterTelemetry& telemetry);
+void applyLayerPulsePattern(CRGB* leds, uint16_t count, CRGB color, const PrinterTelemetry& telemetry, PatternState& state);
+// Telemetry patterns fall back to solid without telemetry (additional printers)
 void applyPattern(CRGB* leds, uint16_t count, uint8_t pattern, CRGB color,
-                  PatternState& state, CRGB bgColor = CRGB::Black, uint8_t progress = 0);
+                  PatternState& state, CRGB bgColor = CRGB::Black, uint8_t progress = 0,
+                  const PrinterTelemetry* telemetry = nullptr);
 
 // Test sequence functions
 bool runTestSequence(CRGB* leds, uint16_t count, PatternState& pState);
@@ -0,0 +1,372 @@
+#include "printersession.h"
+#include <PubSubClient.h>
+#include <atomic>
+#include "reportparser.h"
+#include "socketwait.h"
+#include "patterns.h"
+#include "logserial.h"
+#include "mqttmanager.h"
+#include "mqttparsingutility.h"
+#include "hmscatalogue.h"
+#include "reconnect.h"
+#include "liveness.h"
+
+struct PrinterSession {
+    const ExtraPrinter *config = nullptr;
+    PrinterTlsClient *tls = nullptr;
+    PubSubClient *mqtt = nullptr;
+    ReportStream stream;
+    String deviceTopic;
+    String clientId;
+
+    ConnectionTracker connection;
+    LivenessTracker liveness;
+
+    // Connect attempt on the connect task: tls / mqtt belong to that task
+    // until connectDone is set
+    std::atomic<bool> connectDone{false};
+    ConnectFailure connectResult = FAILURE_NONE;
+    uint32_t connectHeapBefore = 0;
+
+    // Reduced printer state
+    char gcodeState[24] = "";
+    int stage = -1;
+    uint8_t progress = 0;
+    uint8_t hmsLevel = HMS_NONE;
+    unsigned long lastActivityMs = 0; // Last gcode_state change (finish / inactivity timers)
+
+    // LED segment
+    PatternState pattern;
+
+    // Statistics reported via /api/metrics
+    uint32_t heapCost = 0;            // Free heap used by the session once connected
+};
+
+static PrinterSession sessions[MAX_EXTRA_PRINTERS];
+static uint8_t sessionCount = 0;
+
+static TaskHandle_t connectTaskHandle = NULL;
+static PrinterSession *volatile connectRequest = nullptr;   // Handed to the connect task
+static PrinterSession *connectInFlight = nullptr;           // MQTT task: attempt not picked up yet
+
+static void applySessionReport(PrinterSession &session, const ReportDelta &report)
+{
+    if (report.has(FIELD_GCODE_STATE) && strcmp(session.gcodeState, report.gcodeState) != 0)
+    {
+        strlcpy(session.gcodeState, report.gcodeState, sizeof(session.gcodeState));
+        session.lastActivityMs = millis();
+        if (printerConfig.debugOnChange)
+        {
+            LogSerial.printf("[Printer %s] gcode_state: %s\n", session.config->serialNumber, session.gcodeState);
+        }
+    }
+    if (report.has(FIELD_STAGE))
+        session.stage = report.stage;
+    if (report.has(FIELD_PROGRESS))
+        session.progress = constrain(report.progress, 0, 100);
+
+    if (report.has(FIELD_HMS))
+    {
+        // Same rules as the main printer: ignore list, then catalogue severity
+        uint8_t level = HMS_NONE;
+        for (uint8_t i = 0; i < report.hmsCount; i++)
+        {
+            uint64_t code = ((uint64_t)report.hms[i].attr << 32) + report.hms[i].code;
+            if (isHMSCodeIgnored(code))
+                continue;
+            const HMSCatalogueEntry *entry = findHMSCatalogueEntry(code);
+            uint8_t severity = (entry && entry->severity != HMS_NONE) ? entry->severity : ParseHMSSeverity(report.hms[i].code);
+            if (severity != HMS_NONE && (level == HMS_NONE || severity < level))
+                level = severity;
+        }
+        session.hmsLevel = level;
+    }
+}
+
+// Runs on the connect task: everything here may block for seconds
+static ConnectFailure connectSession(PrinterSession &session)
+{
+    const ExtraPrinter &config = *session.config;
+    session.connectHeapBefore = ESP.getFreeHeap();
+
+    LogSerial.printf("[Printer %s] Connecting to %s\n", config.serialNumber, config.printerIP);
+    unsigned long startMs = millis();
+    session.tls->stop();
+    if (!session.tls->connect(config.printerIP, 8883))
+    {
+        char error[64];
+        int code = session.tls->lastError(error, sizeof(error));
+        return classifyTlsError(code, millis() - startMs, PRINTER_SESSION_TLS_TIMEOUT_S * 1000UL);
+    }
+    if (!session.mqtt->connect(session.clientId.c_str(), "bblp", config.accessCode))
+        return classifyMqttState(session.mqtt->state());
+
+    session.stream.reset();
+    session.mqtt->subscribe((session.deviceTopic + "/report").c_str());
+    publishPushAll(*session.mqtt, session.deviceTopic);
+    return FAILURE_NONE;
+}
+
+static void connectTask(void *parameter)
+{
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        PrinterSession *session = connectRequest;
+        if (session == nullptr)
+            continue;
+        connectRequest = nullptr;
+
+        session->connectResult = connectSession(*session);
+        session->connectDone.store(true, std::memory_order_release);
+        wakeMqttTask();
+    }
+}
+
+// MQTT task: apply the result of a finished connect attempt
+static void finishConnect(PrinterSession &session)
+{
+    const ExtraPrinter &config = *session.config;
+    ConnectFailure failure = session.connectResult;
+    session.connectDone.store(false, std::memory_order_relaxed);
+    connectInFlight = nullptr;
+
+    if (failure != FAILURE_NONE)
+    {
+        session.connection.failed(failure);
+        if (failure == FAILURE_NETWORK || failure == FAILURE_TIMEOUT)
+            session.liveness.connectFailed();
+        LogSerial.printf("[Printer %s] Connect failed (%s), next attempt in %lu s\n", config.serialNumber,
+                         connectFailureName(failure), session.connection.lastDelayMs / 1000);
+        return;
+    }
+
+    session.connection.connected();
+    session.liveness.connected();
+    configureTcpKeepalive(session.tls->socketFd());
+    session.lastActivityMs = millis();
+
+    uint32_t heapAfter = ESP.getFreeHeap();
+    if (session.connectHeapBefore > heapAfter)
+        session.heapCost = session.connectHeapBefore - heapAfter;
+    LogSerial.printf("[Printer %s] Connected, session uses %u bytes of heap\n", config.serialNumber, session.heapCost);
+}
+
+void setupPrinterSessions()
+{
+    for (const ExtraPrinter &config : printerConfig.extraPrinters)
+    {
+        if (config.ledCount == 0 || strlen(config.printerIP) == 0 ||
+            strlen(config.accessCode) == 0 || strlen(config.serialNumber) == 0)
+            continue;
+
+        PrinterSession &session = sessions[sessionCount++];
+        session.config = &config;
+        session.deviceTopic = String("device/") + config.serialNumber;
+        session.clientId = String("BLFLC-") + String(random(0xffff), HEX);
+
+        session.tls = new PrinterTlsClient();
+        session.tls->setInsecure();
+        // Shorter than the main printer: a dead printer must not stall the MQTT task
+        session.tls->setTimeout(PRINTER_SESSION_TLS_TIMEOUT_S);
+
+        session.mqtt = new PubSubClient(*session.tls);
+        session.mqtt->setSocketTimeout(PRINTER_SESSION_SOCKET_TIMEOUT_S);
+        session.mqtt->setBufferSize(PRINTER_SESSION_BUFFER);
+        session.mqtt->setServer(config.printerIP, 8883);
+        session.mqtt->setStream(session.stream);
+
+        PrinterSession *target = &session;
+        session.mqtt->setCallback([target](char *topic, byte *payload, unsigned int length)
+                                  {
+            target->liveness.reportReceived();
+            if (target->stream.endMessage())
+                applySessionReport(*target, target->stream.report());
+            target->stream.reset(); });
+
+
+        LogSerial.printf("[Printer %s] Added on LEDs %u-%u\n", config.serialNumber,
+                         config.ledStart, config.ledStart + config.ledCount - 1);
+    }
+
+    if (sessionCount > 0 && connectTaskHandle == NULL)
+    {
+        BaseType_t result;
+
+#if CONFIG_FREERTOS_UNICORE
+        result = xTaskCreate(
+            connectTask,
+            "printerConnect",
+            PRINTER_CONNECT_TASK_RAM,
+            NULL,
+            1,
+            &connectTaskHandle);
+#else
+        result = xTaskCreatePinnedToCore(
+            connectTask,
+            "printerConnect",
+            PRINTER_CONNECT_TASK_RAM,
+            NULL,
+            1,
+            &connectTaskHandle,
+            1 // Core 1 (App Core)
+        );
+#endif
+
+        if (result != pdPASS)
+        {
+            connectTaskHandle = NULL;
+            LogSerial.println(F("[Printer] Failed to create connect task, additional printers stay offline"));
+        }
+    }
+}
+
+void printerSessionsLoop()
+{
+    for (uint8_t i = 0; i < sessionCount; i++)
+    {
+        PrinterSession &session = sessions[i];
+
+        if (session.connection.state == CONNECTION_CONNECTED)
+        {
+            // PubSubClient handles one packet per loop(): drain what has arrived
+            bool connected;
+            do
+            {
+                if (session.tls->available())
+                    session.liveness.received();
+                connected = session.mqtt->loop();
+            } while (connected && session.tls->available());
+            if (connected)
+            {
+                if (session.liveness.poll() == LIVENESS_EVENT_PROBE)
+                    sendMqttPing(*session.tls);
+                continue;
+            }
+
+            LogSerial.printf("[Printer %s] Disconnected (state %d)\n", session.config->serialNumber, session.mqtt->state());
+            session.connection.disconnected(classifyMqttState(session.mqtt->state()));
+            session.liveness.disconnected();
+        }
+        else if (session.connection.state == CONNECTION_CONNECTING)
+        {
+            if (session.connectDone.load(std::memory_order_acquire))
+                finishConnect(session);
+        }
+        else if (connectInFlight == nullptr && connectTaskHandle != NULL && session.connection.beginAttempt())
+        {
+            // One handshake at a time: the others wait for their turn
+            connectInFlight = &session;
+            connectRequest = &session;
+            xTaskNotifyGive(connectTaskHandle);
+        }
+    }
+}
+
+void addPrinterSessionSockets(SocketWaitSet &waitSet)
+{
+    for (uint8_t i = 0; i < sessionCount; i++)
+    {
+        if (sessions[i].connection.state == CONNECTION_CONNECTED)
+            waitSet.add(sessions[i].tls->socketFd());
+    }
+}
+
+unsigned long msUntilPrinterSessionWork()
+{
+    unsigned long next = ULONG_MAX;
+    for (uint8_t i = 0; i < sessionCount; i++)
+    {
+        // While an attempt is in flight the connect task wakes the MQTT task when it is done
+        if (connectInFlight == nullptr && connectTaskHandle != NULL)
+            next = min(next, sessions[i].connection.msUntilAttempt());
+        if (sessions[i].connection.state == CONNECTION_CONNECTED)
+            next = min(next, sessions[i].liveness.msUntilCheck());
+    }
+    return next;
+}
+
+uint8_t printerSessionCount()
+{
+    return sessionCount;
+}
+
+static void renderSegment(PrinterSession &session, CRGB *segment, uint16_t count)
+{
+    const char *state = session.gcodeState;
+    unsigned long sinceActivity = millis() - session.lastActivityMs;
+
+    if (session.connection.state != CONNECTION_CONNECTED || session.liveness.isDark())
+    {
+        fill_solid(segment, count, CRGB::Black);
+    }
+    else if (printerConfig.errordetection && session.hmsLevel == HMS_FATAL)
+    {
+        applyPattern(segment, count, printerConfig.hmsFatalPattern, colorToCRGB(printerConfig.hmsFatalRGB), session.pattern);
+    }
+    else if (printerConfig.errordetection && (session.hmsLevel == HMS_SERIOUS || strcmp(state, "FAILED") == 0))
+    {
+        applyPattern(segment, count, printerConfig.hmsSeriousPattern, colorToCRGB(printerConfig.hmsSeriousRGB), session.pattern);
+    }
+    else if (strcmp(state, "PAUSE") == 0)
+    {
+        applyPattern(segment, count, printerConfig.pausePattern, colorToCRGB(printerConfig.pauseRGB), session.pattern);
+    }
+    else if (strcmp(state, "RUNNING") == 0 || strcmp(state, "PREPARE") == 0)
+    {
+        if (printerConfig.progressBarEnabled && session.stage == 0)
+            applyProgressPattern(segment, count, colorToCRGB(printerConfig.progressBarColor),
+                                 colorToCRGB(printerConfig.progressBarBackground), session.progress);
+        else
+            applyPattern(segment, count, printerConfig.runningPattern, colorToCRGB(printerConfig.runningColor),
+                         session.pattern, CRGB::Black, session.progress);
+    }
+    else if (strcmp(state, "FINISH") == 0 && printerConfig.finishIndication &&
+             sinceActivity < (unsigned long)printerConfig.finishTimeOut)
+    {
+        applyPattern(segment, count, printerConfig.finishPattern, colorToCRGB(printerConfig.finishColor), session.pattern);
+    }
+    else if (printerConfig.inactivityEnabled && sinceActivity >= (unsigned long)printerConfig.inactivityTimeOut)
+    {
+        fill_solid(segment, count, CRGB::Black);
+    }
+    else
+    {
+        applyPattern(segment, count, printerConfig.runningPattern, colorToCRGB(printerConfig.runningColor), session.pattern);
+    }
+}
+
+void renderPrinterSegments(CRGB *leds, uint16_t count)
+{
+    if (isInSpecialMode())
+        return;
+
+    for (uint8_t i = 0; i < sessionCount; i++)
+    {
+        const ExtraPrinter &config = *sessions[i].config;
+        if (config.ledStart >= count)
+            continue;
+        uint16_t segmentCount = min((uint16_t)config.ledCount, (uint16_t)(count - config.ledStart));
+        renderSegment(sessions[i], leds + config.ledStart, segmentCount);
+    }
+}
+
+void printerSessionStats(JsonArray &list)
+{
+    for (uint8_t i = 0; i < sessionCount; i++)
+    {
+        const PrinterSession &session = sessions[i];
+        JsonObject item = list.add<JsonObject>();
+        item["serial"] = session.config->serialNumber;
+        item["online"] = session.connection.state == CONNECTION_CONNECTED && !session.liveness.isDark();
+        item["gcodeState"] = session.gcodeState;
+        item["stage"] = session.stage;
+        item["progress"] = session.progress;
+        item["hmsLevel"] = hmsSeverityName(session.hmsLevel);
+        serializeConnectionTracker(session.connection, item["connection"].to<JsonObject>());
+        serializeLiveness(session.liveness, item["liveness"].to<JsonObject>());
+        item["messages"] = session.stream.message_count();
+        item["parseErrors"] = session.stream.error_count();
+        item["heapCost"] = session.heapCost;
+    }
+}
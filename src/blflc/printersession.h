@@ -0,0 +1,47 @@
+#ifndef _PRINTERSESSION
+#define _PRINTERSESSION
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <FastLED.h>
+#include "types.h"
+
+class SocketWaitSet;
+
+// Additional printers (printerConfig.extraPrinters), each with its own MQTT
+// session and LED segment. The main printer keeps the full LED logic and the
+// LEDs outside these segments; additional printers get a reduced state
+// (gcode_state, stage, progress, HMS severity) mapped to the configured colors.
+//
+// All sessions are served by the MQTT task. Connecting (TLS handshake and
+// MQTT CONNECT, up to PRINTER_SESSION_TLS_TIMEOUT_S + PRINTER_SESSION_SOCKET_TIMEOUT_S
+// against a dead printer) runs on a separate connect task, one printer at a
+// time, so the main printer's reports and liveness probes are not held up.
+
+constexpr uint16_t PRINTER_SESSION_BUFFER = 512;  // PubSubClient buffer (payload is streamed)
+constexpr uint16_t PRINTER_SESSION_TLS_TIMEOUT_S = 5;
+constexpr uint16_t PRINTER_SESSION_SOCKET_TIMEOUT_S = 7;
+constexpr uint32_t PRINTER_CONNECT_TASK_RAM = 8192;
+
+// Create the sessions of all configured additional printers (call once)
+void setupPrinterSessions();
+
+// Connect / service all sessions (MQTT task)
+void printerSessionsLoop();
+
+// Add the sockets of the connected sessions to the MQTT task wait set
+void addPrinterSessionSockets(SocketWaitSet &waitSet);
+
+// Milliseconds until the next reconnect attempt / liveness check is due (ULONG_MAX if none)
+unsigned long msUntilPrinterSessionWork();
+
+// Number of configured additional printers
+uint8_t printerSessionCount();
+
+// Paint the additional printer segments over the main printer LEDs
+void renderPrinterSegments(CRGB *leds, uint16_t count);
+
+// Per-printer details for /api/metrics
+void printerSessionStats(JsonArray &list);
+
+#endif
@@ -0,0 +1,634 @@
+#include "printerstate.h"
+#include "leds.h"
+#include "logserial.h"
+#include "mqttparsingutility.h"
+#include "statefilter.h"
+#include "hmscatalogue.h"
+#include "statecache.h"
+
+unsigned long lastMQTTupdate = 0;
+
+
+// Check if command should be skipped (noise filtering)
+bool shouldSkipCommand(const ReportDelta& report)
+{
+    if (!report.has(FIELD_COMMAND))
+        return false;
+
+    const char* cmd = report.command;
+    return (strcmp(cmd, "gcode_line") == 0 ||
+            strcmp(cmd, "project_prepare") == 0 ||
+            strcmp(cmd, "project_file") == 0 ||
+            strcmp(cmd, "clean_print_error") == 0 ||
+            strcmp(cmd, "resume") == 0 ||
+            strcmp(cmd, "get_accessories") == 0 ||
+            strcmp(cmd, "prepare") == 0 ||
+            strcmp(cmd, "extrusion_cali_get") == 0);
+}
+
+// Check if in special mode (maintenance, test, disco, wifi debug)
+bool isInSpecialMode()
+{
+    return printerConfig.maintMode || printerConfig.testcolorEnabled ||
+           printerConfig.discoMode || printerConfig.debugwifi;
+}
+
+// Handle door opened event
+void handleDoorOpened()
+{
+    printerVariables.lastdoorOpenms = millis();
+
+    // If light is off, turn it on and lock it
+    if (printerConfig.controlChamberLight && !printerVariables.printerLedState)
+    {
+        printerVariables.chamberLightLocked = true;
+        printerVariables.printerLedState = true;
+        printerConfig.replicate_update = false;
+        controlChamberLight(true);
+        printerVariables.stage = 255;
+        stream.forgetReport();
+        LogSerial.println(F("[MQTT] Door opened – Light forced ON"));
+    }
+
+    // Restart inactivity timer
+    printerConfig.inactivityStartms = millis();
+    printerConfig.isIdleOFFActive = false;
+}
+
+// Handle door closed event
+void handleDoorClosed()
+{
+    printerVariables.lastdoorClosems = millis();
+
+    // Release chamber light lock
+    if (printerConfig.controlChamberLight)
+    {
+        printerVariables.chamberLightLocked = false;
+    }
+
+    // Turn off LED bar immediately if inactivity disabled
+    if (!printerConfig.inactivityEnabled)
+    {
+        printerVariables.printerLedState = false;
+        printerConfig.replicate_update = false;
+        printerVariables.stage = 999;
+        stream.forgetReport();
+        setLedsOff();
+        controlChamberLight(false);
+        LogSerial.println(F("[MQTT] Door closed – LED bar OFF (inactivity disabled)"));
+    }
+
+    // Reset inactivity timer
+    printerConfig.inactivityStartms = millis();
+    printerConfig.isIdleOFFActive = false;
+
+    // Double-close detection for toggle
+    if ((millis() - printerVariables.lastdoorOpenms) < DOOR_DOUBLE_TAP_MS)
+    {
+        printerVariables.doorSwitchTriggered = true;
+    }
+}
+
+// Parse door status from home_flag
+bool parseDoorStatus(const ReportDelta& report, bool& changed)
+{
+    if (!report.has(FIELD_HOME_FLAG))
+        return false;
+
+    bool doorState = bitRead(report.homeFlag, 23);  // Bit 23 = door open
+
+    if (printerVariables.doorOpen == doorState)
+        return false;
+
+    printerVariables.doorOpen = doorState;
+
+    if (printerConfig.debugOnChange)
+    {
+        LogSerial.print(F("[MQTT] Door "));
+        LogSerial.println(doorState ? F("Opened") : F("Closed"));
+    }
+
+    if (doorState)
+    {
+        handleDoorOpened();
+    }
+    else
+    {
+        handleDoorClosed();
+    }
+
+    changed = true;
+    if (!isStateBootstrapping())
+    {
+        updateleds();
+    }
+    return true;
+}
+
+// Parse printer stage (stg_cur)
+bool parseStage(const ReportDelta& report, bool& changed)
+{
+    if (!report.has(FIELD_STAGE))
+        return false;
+
+    int newStage = report.stage;
+    if (!filterStage(printerVariables.stage, newStage))
+        return false;
+
+    printerVariables.stage = newStage;
+
+    if (printerConfig.debugOnChange || printerConfig.debugging)
+    {
+        LogSerial.print(F("[MQTT] update - stg_cur now: "));
+        LogSerial.println(printerVariables.stage);
+    }
+
+    changed = true;
+    return true;
+}
+
+// Parse print progress percentage (mc_percent)
+bool parsePrintProgress(const ReportDelta& report, bool& changed)
+{
+    if (!report.has(FIELD_PROGRESS))
+        return false;
+
+    uint8_t newProgress = constrain(report.progress, 0, 100);  // Clamp to valid range
+
+    if (printerVariables.printProgress == newProgress)
+        return false;
+
+    uint8_t oldProgress = printerVariables.printProgress;
+    printerVariables.printProgress = newProgress;
+
+    // Infer RUNNING state from active print progress (for P1 printers that don't send gcode_state)
+    if (newProgress > 0 && newProgress < 100 && printerVariables.gcodeState != "RUNNING")
+    {
+        printerVariables.gcodeState = "RUNNING";
+        printerVariables.overridestage = 999;  // Reset HMS override
+        printerConfig.inactivityStartms = millis();
+        if (printerConfig.debugOnChange || printerConfig.debugging)
+        {
+            LogSerial.println(F("[MQTT] Inferred RUNNING state from print progress"));
+        }
+    }
+
+    // Infer FINISH state when progress reaches 100% (for P1 printers)
+    if (newProgress == 100 && oldProgress < 100 && printerVariables.gcodeState == "RUNNING")
+    {
+        printerVariables.gcodeState = "FINISH";
+        printerVariables.finished = true;
+        printerVariables.waitingForDoor = true;
+        printerConfig.finishStartms = millis();
+        printerConfig.finish_check = true;
+        if (printerConfig.debugOnChange || printerConfig.debugging)
+        {
+            LogSerial.println(F("[MQTT] Inferred FINISH state from 100% progress"));
+        }
+    }
+
+    if (printerConfig.debugOnChange || printerConfig.debugging)
+    {
+        LogSerial.print(F("[MQTT] update - print progress: "));
+        LogSerial.print(printerVariables.printProgress);
+        LogSerial.println(F("%"));
+    }
+
+    changed = true;
+    return true;
+}
+
+// Work done for every reported gcode_state, changed or not
+void refreshActiveGcodeState(const char* mqttgcodeState)
+{
+    bool isRunning = strcmp(mqttgcodeState, "RUNNING") == 0;
+
+    // Keep inactivity timer running during active states
+    if (isRunning || strcmp(mqttgcodeState, "PAUSE") == 0)
+    {
+        printerConfig.inactivityStartms = millis();
+    }
+
+    // Turn on chamber light at print start
+    if (isRunning && printerConfig.controlChamberLight &&
+        !printerVariables.printerLedState)
+    {
+        controlChamberLight(true);
+        LogSerial.println(F("[MQTT] Print started – Chamber Light ON requested"));
+    }
+}
+
+// Parse gcode state
+bool parseGcodeState(const ReportDelta& report, bool& changed)
+{
+    if (!report.has(FIELD_GCODE_STATE))
+        return false;
+
+    if ((millis() - lastMQTTupdate) <= MQTT_STATUS_DEBOUNCE_MS)
+        return false;
+
+    const char* mqttgcodeState = report.gcodeState;
+    bool isRunning = strcmp(mqttgcodeState, "RUNNING") == 0;
+
+    refreshActiveGcodeState(mqttgcodeState);
+
+    // Handle state change
+    if (printerVariables.gcodeState == mqttgcodeState)
+        return false;
+
+    if (isRunning)
+    {
+        printerVariables.overridestage = 999;  // Reset HMS override
+    }
+
+    if (strcmp(mqttgcodeState, "FINISH") == 0)
+    {
+        printerVariables.finished = true;
+        printerVariables.waitingForDoor = true;
+        printerConfig.finishStartms = millis();
+        printerConfig.finish_check = true;
+    }
+
+    printerVariables.gcodeState = mqttgcodeState;
+
+    if (printerConfig.debugOnChange || printerConfig.debugging)
+    {
+        LogSerial.print(F("[MQTT] update - gcode_state now: "));
+        LogSerial.println(printerVariables.gcodeState);
+    }
+
+    changed = true;
+    return true;
+}
+
+// Parse manual pause command
+bool parsePauseCommand(const ReportDelta& report, bool& changed)
+{
+    if (!report.has(FIELD_COMMAND))
+        return false;
+
+    if (strcmp(report.command, "pause") != 0)
+        return false;
+
+    lastMQTTupdate = millis();
+    LogSerial.println(F("[MQTT] update - manual PAUSE"));
+    printerVariables.gcodeState = "PAUSE";
+    changed = true;
+    return true;
+}
+
+// Parse lights report (chamber light status)
+bool parseLightsReport(const ReportDelta& report, bool& changed)
+{
+    if (!report.has(FIELD_CHAMBER_LIGHT))
+        return false;
+
+    if ((millis() - lastMQTTupdate) <= MQTT_STATUS_DEBOUNCE_MS)
+        return false;
+
+    bool newState = report.chamberLightOn;
+    if (!filterLightState(printerVariables.printerLedState, newState))
+        return false;
+
+    setPrinterLightState(newState);
+    changed = true;
+    return true;
+}
+
+// Apply a chamber light state reported by the printer
+void setPrinterLightState(bool on)
+{
+    printerVariables.printerLedState = on;
+    printerConfig.replicate_update = true;
+
+    if (printerConfig.debugOnChange || printerConfig.debugging)
+    {
+        LogSerial.print(F("[MQTT] chamber_light now: "));
+        LogSerial.println(printerVariables.printerLedState);
+    }
+
+    if (printerVariables.waitingForDoor && printerConfig.finish_check)
+    {
+        printerVariables.finished = true;
+    }
+}
+
+// Parse system LED control commands
+bool parseSystemCommand(const ReportDelta& report, bool& changed)
+{
+    if (!report.has(FIELD_SYSTEM_COMMAND))
+        return false;
+
+    if (strcmp(report.systemCommand, "ledctrl") != 0)
+        return false;
+
+    bool newState = report.has(FIELD_LED_MODE) && report.ledModeOn;
+    if (printerVariables.printerLedState == newState)
+        return false;
+
+    printerVariables.printerLedState = newState;
+    printerConfig.replicate_update = true;
+    lastMQTTupdate = millis();
+
+    if (printerConfig.debugOnChange || printerConfig.debugging)
+    {
+        LogSerial.print(F("[MQTT] led_mode now: "));
+        LogSerial.println(printerVariables.printerLedState);
+    }
+
+    if (printerVariables.waitingForDoor && printerConfig.finish_check)
+    {
+        printerVariables.finished = true;
+    }
+
+    changed = true;
+    return true;
+}
+
+// Apply the HMS catalogue entry (stage override / dedicated color) of a code
+void applyHMSOverride(uint64_t code)
+{
+    const HMSCatalogueEntry* entry = findHMSCatalogueEntry(code);
+
+    printerVariables.overridestage = (entry && entry->stage != HMS_NO_STAGE) ? entry->stage : 999;
+    printerVariables.hmsColorOverride = entry && entry->hasColor;
+    if (printerVariables.hmsColorOverride)
+    {
+        printerVariables.hmsColor = entry->color;
+        printerVariables.hmsPattern = entry->pattern;
+    }
+}
+
+// Parse HMS (Health Management System) errors
+bool parseHMS(const ReportDelta& report, bool& changed)
+{
+    if (!report.has(FIELD_HMS))
+        return false;
+
+    uint8_t oldHMSlevel = printerVariables.parsedHMSlevel;
+    uint64_t oldHMScode = printerVariables.parsedHMScode;
+
+    printerVariables.hmsstate = false;
+    printerVariables.parsedHMSlevel = HMS_NONE;
+
+    for (uint8_t i = 0; i < report.hmsCount; i++)
+    {
+        const HMSEntry& hms = report.hms[i];
+        uint64_t code = ((uint64_t)hms.attr << 32) + hms.code;
+
+        // Check ignore list (compiled when the config is loaded or saved)
+        if (isHMSCodeIgnored(code))
+        {
+            if (printerConfig.debugging)
+            {
+                char strHMScode[32];
+                formatHMSCode(code, strHMScode, sizeof(strHMScode));
+                LogSerial.print(F("[MQTT] Ignored HMS Code: "));
+                LogSerial.println(strHMScode);
+            }
+            continue;
+        }
+
+        // The catalogue can override the severity encoded in the code
+        const HMSCatalogueEntry* entry = findHMSCatalogueEntry(code);
+        uint8_t severity = (entry && entry->severity != HMS_NONE) ? entry->severity : ParseHMSSeverity(hms.code);
+        if (severity != HMS_NONE)
+        {
+            printerVariables.hmsstate = true;
+            printerVariables.parsedHMSlevel = severity;
+            printerVariables.parsedHMScode = code;
+        }
+    }
+
+    if (oldHMSlevel == printerVariables.parsedHMSlevel &&
+        (oldHMSlevel == HMS_NONE || oldHMScode == printerVariables.parsedHMScode))
+        return false;
+
+    // Apply stage override based on HMS code, or reset if no HMS error
+    if (printerVariables.parsedHMSlevel != HMS_NONE)
+    {
+        applyHMSOverride(printerVariables.parsedHMScode);
+    }
+    else
+    {
+        printerVariables.overridestage = 999;
+        printerVariables.hmsColorOverride = false;
+    }
+
+    // Debug logging
+    if (printerConfig.debugging || printerConfig.debugOnChange)
+    {
+        LogSerial.print(F("[MQTT] update - parsedHMSlevel now: "));
+        if (printerVariables.parsedHMSlevel != HMS_NONE)
+        {
+            LogSerial.print(hmsSeverityName(printerVariables.parsedHMSlevel));
+            LogSerial.print(F("      Error Code: HMS_"));
+            char strHMScode[24];
+            formatHMSCodeShort(printerVariables.parsedHMScode, strHMScode, sizeof(strHMScode));
+            LogSerial.print(strHMScode);
+            if (printerVariables.overridestage != printerVariables.stage)
+            {
+                LogSerial.println(F(" **"));
+            }
+            else
+            {
+                LogSerial.println();
+            }
+        }
+        else
+        {
+            LogSerial.println(F("NULL"));
+        }
+    }
+
+    changed = true;
+    return true;
+}
+
+// Apply changes after parsing (reset timers, update LEDs)
+void applyMqttChanges()
+{
+    // Keep the LEDs as they are until the state is complete after a (re)connect
+    if (isStateBootstrapping())
+        return;
+
+    printerConfig.inactivityStartms = millis();
+    printerConfig.isIdleOFFActive = false;
+
+    if (printerConfig.debugging)
+    {
+        LogSerial.println(F("Change from mqtt"));
+    }
+
+    printerConfig.maintMode_update = true;
+    printerConfig.discoMode_update = true;
+    printerConfig.replicate_update = true;
+    printerConfig.testcolor_update = true;
+
+    updateleds();
+}
+
+// Apply stage / light transitions that the state filter held back and that
+// have not reverted within the hold time
+void applyHeldTransitions()
+{
+    bool changed = false;
+
+    int heldStage;
+    if (takeSettledStage(heldStage))
+    {
+        printerVariables.stage = heldStage;
+        if (printerConfig.debugOnChange || printerConfig.debugging)
+        {
+            LogSerial.print(F("[MQTT] update - stg_cur settled: "));
+            LogSerial.println(printerVariables.stage);
+        }
+        changed = true;
+    }
+
+    bool heldLightState;
+    if (takeSettledLightState(heldLightState))
+    {
+        setPrinterLightState(heldLightState);
+        changed = true;
+    }
+
+    if (changed)
+    {
+        applyMqttChanges();
+    }
+}
+
+// Bring printerVariables in line with the merged state. Reports that were not
+// applied while bootstrapping (noise commands, special modes, the pause
+// debounce) still count towards it.
+static void applyCachedState()
+{
+    const ReportDelta &state = stateCache.state;
+    bool changed = false;
+
+    parseDoorStatus(state, changed);
+    parseStage(state, changed);
+    parsePrintProgress(state, changed);
+    parseGcodeState(state, changed);
+    parseLightsReport(state, changed);
+    parseHMS(state, changed);
+}
+
+// Resolve the LEDs once the state cache is complete (or the bootstrap timed out)
+void completeStateBootstrap()
+{
+    if (!isStateBootstrapDue())
+        return;
+
+    // Still bootstrapping here, so the state filter passes the cached values through
+    applyCachedState();
+    finishStateBootstrap();
+
+    if (printerConfig.debugOnChange || printerConfig.debugging)
+    {
+        LogSerial.printf("[MQTT] Printer state %s after %lu ms\n",
+                         isStateComplete() ? "complete" : "incomplete (timeout)",
+                         stateCache.lastBootstrapMs);
+    }
+    applyMqttChanges();
+}
+
+// Filament colors of all AMS trays seen since boot (reports only carry the AMS that changed)
+static AmsTray amsTrays[REPORT_MAX_TRAYS];
+static uint8_t amsTrayCount = 0;
+
+// Track tray colors and the active tray, for the AMS color mirroring
+bool parseAms(const ReportDelta& report, bool& changed)
+{
+    if (!report.has(FIELD_AMS_TRAYS) && !report.has(FIELD_TRAY_NOW))
+        return false;
+
+    for (uint8_t i = 0; i < report.trayCount; i++)
+    {
+        const AmsTray &tray = report.trays[i];
+        uint8_t slot = 0;
+        while (slot < amsTrayCount && amsTrays[slot].id != tray.id)
+            slot++;
+        if (slot == amsTrayCount)
+        {
+            if (amsTrayCount == REPORT_MAX_TRAYS)
+                continue;
+            amsTrayCount++;
+        }
+        amsTrays[slot] = tray;
+    }
+    if (report.has(FIELD_TRAY_NOW))
+        printerVariables.amsTrayNow = report.trayNow;
+
+    // RRGGBBAA; an empty tray reports a transparent / zero color
+    uint32_t color = 0;
+    for (uint8_t slot = 0; slot < amsTrayCount; slot++)
+    {
+        if (amsTrays[slot].id == printerVariables.amsTrayNow)
+            color = amsTrays[slot].color;
+    }
+    bool valid = printerVariables.amsTrayNow != TRAY_NONE && (color & 0xFF) != 0;
+    uint8_t r = color >> 24, g = color >> 16, b = color >> 8;
+
+    if (valid == printerVariables.amsColorValid &&
+        (!valid || (r == printerVariables.amsColor.r && g == printerVariables.amsColor.g && b == printerVariables.amsColor.b)))
+    {
+        return false;
+    }
+
+    printerVariables.amsColorValid = valid;
+    printerVariables.amsColor.r = r;
+    printerVariables.amsColor.g = g;
+    printerVariables.amsColor.b = b;
+    snprintf(printerVariables.amsColor.RGBhex, sizeof(printerVariables.amsColor.RGBhex), "#%02X%02X%02X", r, g, b);
+
+    if (printerConfig.debugOnChange || printerConfig.debugging)
+    {
+        LogSerial.printf("[MQTT] AMS tray %u active, color %s\n", printerVariables.amsTrayNow,
+                         valid ? printerVariables.amsColor.RGBhex : "none");
+    }
+
+    // Only the printing color depends on it
+    if (printerConfig.amsColorMirror)
+        changed = true;
+    return true;
+}
+
+// Store the telemetry of a report. Telemetry never triggers an LED resolve,
+// the telemetry patterns read it when rendering the next frame.
+void applyTelemetry(const ReportDelta& report)
+{
+    if (report.has(FIELD_NOZZLE_TEMP))
+        printerTelemetry.nozzleTemp = report.nozzleTemp;
+    if (report.has(FIELD_NOZZLE_TARGET))
+        printerTelemetry.nozzleTarget = report.nozzleTarget;
+    if (report.has(FIELD_BED_TEMP))
+        printerTelemetry.bedTemp = report.bedTemp;
+    if (report.has(FIELD_BED_TARGET))
+        printerTelemetry.bedTarget = report.bedTarget;
+    if (report.has(FIELD_LAYER))
+        printerTelemetry.layer = report.layer;
+    if (report.has(FIELD_TOTAL_LAYERS))
+        printerTelemetry.totalLayers = report.totalLayers;
+    if (report.has(FIELD_REMAINING_TIME))
+        printerTelemetry.remainingMin = report.remainingMin;
+}
+
+// Run a report through every parser; true if the LED state needs a resolve
+bool parseReportFields(const ReportDelta& report)
+{
+    bool changed = false;
+
+    // Parse each section of the message
+    parseDoorStatus(report, changed);
+    parseStage(report, changed);
+    parsePrintProgress(report, changed);
+    parseGcodeState(report, changed);
+    parsePauseCommand(report, changed);
+    parseLightsReport(report, changed);
+    parseSystemCommand(report, changed);
+    parseHMS(report, changed);
+    parseAms(report, changed);
+    return changed;
+}
@@ -0,0 +1,46 @@
+#ifndef _PRINTERSTATE
+#define _PRINTERSTATE
+
+#include <Arduino.h>
+#include "reportparser.h"
+#include "types.h"
+
+// gcode_state and light reports right after a manual pause are not applied
+constexpr unsigned long MQTT_STATUS_DEBOUNCE_MS = 3000;
+
+// Report stream (parses while receiving) of the printer connection
+extern ReportStream stream;
+
+// Last manual pause / LED command seen in a report
+extern unsigned long lastMQTTupdate;
+
+// Command filtering
+bool shouldSkipCommand(const ReportDelta& report);
+bool isInSpecialMode();
+
+// Door event handlers
+void handleDoorOpened();
+void handleDoorClosed();
+
+// Parser functions: apply one part of a report to printerVariables
+bool parseDoorStatus(const ReportDelta& report, bool& changed);
+bool parseStage(const ReportDelta& report, bool& changed);
+bool parsePrintProgress(const ReportDelta& report, bool& changed);
+void refreshActiveGcodeState(const char* mqttgcodeState);
+bool parseGcodeState(const ReportDelta& report, bool& changed);
+bool parsePauseCommand(const ReportDelta& report, bool& changed);
+bool parseLightsReport(const ReportDelta& report, bool& changed);
+void setPrinterLightState(bool on);
+bool parseSystemCommand(const ReportDelta& report, bool& changed);
+void applyHMSOverride(uint64_t code);
+bool parseHMS(const ReportDelta& report, bool& changed);
+bool parseAms(const ReportDelta& report, bool& changed);
+bool parseReportFields(const ReportDelta& report);
+void applyTelemetry(const ReportDelta& report);
+
+// LED resolve after parsing, held transitions and the reconnect bootstrap
+void applyMqttChanges();
+void applyHeldTransitions();
+void completeStateBootstrap();
+
+#endif
@@ -0,0 +1,117 @@
+#include "reconnect.h"
+
+static const char *const failureNames[FAILURE_COUNT] = {"", "network", "tls", "timeout", "auth", "refused"};
+
+static void schedule(ConnectionTracker &tracker, unsigned long delayMs)
+{
+    // Equal jitter: half the delay fixed, half random, so several
+    // controllers that lost the same printer do not retry in lockstep
+    unsigned long half = delayMs / 2;
+    tracker.lastDelayMs = half + (half > 0 ? (unsigned long)random(half + 1) : 0);
+    tracker.nextAttemptMs = millis() + tracker.lastDelayMs;
+    tracker.state = CONNECTION_WAITING;
+}
+
+bool ConnectionTracker::beginAttempt()
+{
+    if (state != CONNECTION_WAITING || (long)(millis() - nextAttemptMs) < 0)
+        return false;
+
+    state = CONNECTION_CONNECTING;
+    attempts++;
+    return true;
+}
+
+void ConnectionTracker::connected()
+{
+    state = CONNECTION_CONNECTED;
+    consecutiveFailures = 0;
+    lastFailure = FAILURE_NONE;
+    connects++;
+}
+
+void ConnectionTracker::failed(ConnectFailure reason)
+{
+    lastFailure = reason;
+    failures[reason]++;
+    if (consecutiveFailures < 255)
+        consecutiveFailures++;
+
+    unsigned long delayMs;
+    if (reason == FAILURE_AUTH)
+    {
+        delayMs = RECONNECT_AUTH_MS;
+    }
+    else
+    {
+        uint8_t shift = min(consecutiveFailures, (uint8_t)16);
+        delayMs = min(RECONNECT_BASE_MS << shift, RECONNECT_MAX_MS);
+    }
+    schedule(*this, delayMs);
+}
+
+void ConnectionTracker::disconnected(ConnectFailure reason)
+{
+    lastFailure = reason;
+    failures[reason]++;
+    disconnects++;
+    schedule(*this, RECONNECT_BASE_MS);
+}
+
+unsigned long ConnectionTracker::msUntilAttempt() const
+{
+    if (state != CONNECTION_WAITING)
+        return ULONG_MAX;
+    long remaining = (long)(nextAttemptMs - millis());
+    return remaining > 0 ? (unsigned long)remaining : 0;
+}
+
+ConnectFailure classifyMqttState(int state)
+{
+    switch (state)
+    {
+    case -4: // MQTT_CONNECTION_TIMEOUT
+        return FAILURE_TIMEOUT;
+    case 1:  // MQTT_CONNECT_BAD_PROTOCOL
+    case 2:  // MQTT_CONNECT_BAD_CLIENT_ID
+    case 3:  // MQTT_CONNECT_UNAVAILABLE
+        return FAILURE_REFUSED;
+    case 4:  // MQTT_CONNECT_BAD_CREDENTIALS
+    case 5:  // MQTT_CONNECT_UNAUTHORIZED
+        return FAILURE_AUTH;
+    default: // Connection lost / failed / disconnected
+        return FAILURE_NETWORK;
+    }
+}
+
+ConnectFailure classifyTlsError(int error, unsigned long elapsedMs, unsigned long timeoutMs)
+{
+    // ssl_client gives up with -1 both for a failed TCP connect and for a
+    // handshake that ran out of time; the elapsed time tells them apart
+    if (elapsedMs + 500 >= timeoutMs)
+        return FAILURE_TIMEOUT;
+    if (error == -1 || error == 0)
+        return FAILURE_NETWORK;
+    return FAILURE_TLS;
+}
+
+const char *connectFailureName(uint8_t reason)
+{
+    return reason < FAILURE_COUNT ? failureNames[reason] : "";
+}
+
+void serializeConnectionTracker(const ConnectionTracker &tracker, JsonObject out)
+{
+    static const char *const stateNames[] = {"waiting", "connecting", "connected"};
+    out["state"] = stateNames[tracker.state];
+    out["attempts"] = tracker.attempts;
+    out["connects"] = tracker.connects;
+    out["disconnects"] = tracker.disconnects;
+    out["consecutiveFailures"] = tracker.consecutiveFailures;
+    out["lastFailure"] = connectFailureName(tracker.lastFailure);
+    out["nextAttemptInMs"] = tracker.state == CONNECTION_WAITING ? tracker.msUntilAttempt() : 0;
+
+    JsonObject failures = out["failures"].to<JsonObject>();
+    for (uint8_t i = FAILURE_NETWORK; i < FAILURE_COUNT; i++)
+        failures[failureNames[i]] = tracker.failures[i];
+}
@@ -0,0 +1,65 @@
+#ifndef _RECONNECT
+#define _RECONNECT
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Reconnect delays: capped exponential backoff with jitter. Rejected
+// credentials wait much longer, they will not fix themselves.
+constexpr unsigned long RECONNECT_BASE_MS = 1000;
+constexpr unsigned long RECONNECT_MAX_MS = 60000;
+constexpr unsigned long RECONNECT_AUTH_MS = 300000;
+
+// Why a connect attempt (or an established connection) failed
+enum ConnectFailure : uint8_t {
+    FAILURE_NONE = 0,
+    FAILURE_NETWORK,    // No route, address lookup or TCP connect failed, connection lost
+    FAILURE_TLS,        // TLS handshake rejected
+    FAILURE_TIMEOUT,    // TCP / TLS / CONNACK did not complete in time
+    FAILURE_AUTH,       // Access code rejected (CONNACK 4 / 5)
+    FAILURE_REFUSED,    // Other CONNACK refusal (protocol, client id, unavailable)
+    FAILURE_COUNT
+};
+
+enum ConnectionState : uint8_t {
+    CONNECTION_WAITING = 0, // Backing off until nextAttemptMs
+    CONNECTION_CONNECTING,
+    CONNECTION_CONNECTED
+};
+
+// Connection state machine of one printer link
+struct ConnectionTracker {
+    ConnectionState state = CONNECTION_WAITING;
+    uint8_t consecutiveFailures = 0;
+    unsigned long nextAttemptMs = 0;
+    unsigned long lastDelayMs = 0;
+    uint8_t lastFailure = FAILURE_NONE;
+
+    // Statistics reported via /api/metrics
+    uint32_t attempts = 0;
+    uint32_t connects = 0;
+    uint32_t disconnects = 0;
+    uint32_t failures[FAILURE_COUNT] = {};
+
+    // True if a connect attempt may start now (moves to CONNECTION_CONNECTING)
+    bool beginAttempt();
+    void connected();
+    // A connect attempt failed: schedule the next one
+    void failed(ConnectFailure reason);
+    // An established connection dropped: reconnect after the base delay
+    void disconnected(ConnectFailure reason);
+    // Milliseconds until the next attempt is due (ULONG_MAX if connected / connecting)
+    unsigned long msUntilAttempt() const;
+};
+
+// Classify PubSubClient::state() after a failed connect / a dropped connection
+ConnectFailure classifyMqttState(int state);
+
+// Classify a failed WiFiClientSecure::connect() (lastError(), elapsed vs. timeout)
+ConnectFailure classifyTlsError(int error, unsigned long elapsedMs, unsigned long timeoutMs);
+
+const char *connectFailureName(uint8_t reason);
+
+void serializeConnectionTracker(const ConnectionTracker &tracker, JsonObject out);
+
+#endif
@@ -0,0 +1,250 @@
+#include "reportcapture.h"
+#include "logserial.h"
+#include "web-server.h"
+
+CaptureStats captureStats;
+
+struct CaptureRecordHeader {
+    uint32_t firstByteUs;
+    uint32_t length;
+};
+
+static const uint8_t fileHeader[8] = {'B', 'L', 'F', 'C', 'A', 'P', CAPTURE_FORMAT_VERSION, 0};
+
+static uint8_t *ring = nullptr;
+static size_t ringTail = 0;     // Oldest record
+static size_t ringUsed = 0;
+static bool capturing = false;
+static uint8_t downloads = 0;   // Recording pauses while the ring is being read
+static bool clearPending = false;   // Cleared during a download: empty the ring when it ends
+static SemaphoreHandle_t captureLock = nullptr;
+
+// MQTT task (record) and async_tcp task (control, download) share the ring
+class CaptureLockGuard
+{
+public:
+    CaptureLockGuard() { xSemaphoreTake(captureLock, portMAX_DELAY); }
+    ~CaptureLockGuard() { xSemaphoreGive(captureLock); }
+};
+
+static void ringWrite(size_t offset, const void *data, size_t len)
+{
+    offset %= CAPTURE_RING_BYTES;
+    size_t first = min(len, CAPTURE_RING_BYTES - offset);
+    memcpy(ring + offset, data, first);
+    memcpy(ring, (const uint8_t *)data + first, len - first);
+}
+
+static void ringRead(size_t offset, void *data, size_t len)
+{
+    offset %= CAPTURE_RING_BYTES;
+    size_t first = min(len, CAPTURE_RING_BYTES - offset);
+    memcpy(data, ring + offset, first);
+    memcpy((uint8_t *)data + first, ring, len - first);
+}
+
+// Drop the captured reports, and the ring itself unless a capture runs (lock held)
+static void emptyRing()
+{
+    clearPending = false;
+    ringTail = 0;
+    ringUsed = 0;
+    if (capturing)
+    {
+        captureStats = CaptureStats();
+        return;
+    }
+    free(ring);
+    ring = nullptr;
+}
+
+bool startReportCapture()
+{
+    if (captureLock == nullptr)
+        return false;
+
+    CaptureLockGuard lock;
+    if (ring == nullptr)
+    {
+        ring = (uint8_t *)malloc(CAPTURE_RING_BYTES);
+        if (ring == nullptr)
+            return false;
+        ringTail = 0;
+        ringUsed = 0;
+        captureStats = CaptureStats();
+    }
+    capturing = true;
+    return true;
+}
+
+void stopReportCapture()
+{
+    if (captureLock == nullptr)
+        return;
+    CaptureLockGuard lock;
+    capturing = false;
+}
+
+void clearReportCapture()
+{
+    if (captureLock == nullptr)
+        return;
+    CaptureLockGuard lock;
+    capturing = false;
+    // A running download keeps the ring until it is done
+    if (downloads > 0)
+    {
+        clearPending = true;
+        return;
+    }
+    emptyRing();
+}
+
+bool reportCaptureActive()
+{
+    return capturing;
+}
+
+void captureReport(const uint8_t *data, size_t len, uint32_t firstByteUs)
+{
+    if (!capturing)
+        return;
+
+    CaptureLockGuard lock;
+    size_t needed = sizeof(CaptureRecordHeader) + len;
+    if (!capturing || downloads > 0 || needed > CAPTURE_RING_BYTES)
+    {
+        captureStats.skipped++;
+        return;
+    }
+
+    while (ringUsed + needed > CAPTURE_RING_BYTES)
+    {
+        CaptureRecordHeader oldest;
+        ringRead(ringTail, &oldest, sizeof(oldest));
+        size_t recordSize = sizeof(oldest) + oldest.length;
+        ringTail = (ringTail + recordSize) % CAPTURE_RING_BYTES;
+        ringUsed -= recordSize;
+        captureStats.evicted++;
+    }
+
+    CaptureRecordHeader header = {firstByteUs, (uint32_t)len};
+    size_t head = ringTail + ringUsed;
+    ringWrite(head, &header, sizeof(header));
+    ringWrite(head + sizeof(header), data, len);
+    ringUsed += needed;
+    captureStats.captured++;
+}
+
+// File header, then the ring from the oldest record on
+static size_t fillDownload(uint8_t *buffer, size_t maxLen, size_t index)
+{
+    CaptureLockGuard lock;
+    size_t total = sizeof(fileHeader) + ringUsed;
+    if (index >= total || ring == nullptr)
+        return 0;
+
+    size_t written = 0;
+    if (index < sizeof(fileHeader))
+    {
+        written = min(maxLen, sizeof(fileHeader) - index);
+        memcpy(buffer, fileHeader + index, written);
+        index += written;
+    }
+    size_t len = min(maxLen - written, total - index);
+    ringRead(ringTail + index - sizeof(fileHeader), buffer + written, len);
+    return written + len;
+}
+
+static void handleCaptureControl(AsyncWebServerRequest *request)
+{
+    if (!isAuthorized(request))
+    {
+        return request->requestAuthentication();
+    }
+
+    String action = request->hasParam("action", true) ? request->getParam("action", true)->value()
+                    : request->hasParam("action") ? request->getParam("action")->value()
+                                                  : "";
+    if (action == "start")
+    {
+        if (!startReportCapture())
+        {
+            request->send(503, "text/plain", "Not enough memory for the capture buffer");
+            return;
+        }
+        LogSerial.println(F("[Capture] Started"));
+    }
+    else if (action == "stop")
+    {
+        stopReportCapture();
+        LogSerial.println(F("[Capture] Stopped"));
+    }
+    else if (action == "clear")
+    {
+        clearReportCapture();
+        LogSerial.println(F("[Capture] Cleared"));
+    }
+    else
+    {
+        request->send(400, "text/plain", "action must be start, stop or clear");
+        return;
+    }
+
+    JsonDocument doc;
+    serializeReportCapture(doc.to<JsonObject>());
+    String json;
+    serializeJson(doc, json);
+    request->send(200, "application/json", json);
+}
+
+static void handleCaptureDownload(AsyncWebServerRequest *request)
+{
+    if (!isAuthorized(request))
+    {
+        return request->requestAuthentication();
+    }
+    size_t total = 0;
+    if (captureLock != nullptr)
+    {
+        CaptureLockGuard lock;
+        // A cleared ring only lives on for the downloads already running
+        if (ring != nullptr && !clearPending)
+        {
+            downloads++;
+            total = sizeof(fileHeader) + ringUsed;
+        }
+    }
+    if (total == 0)
+    {
+        request->send(404, "text/plain", "No capture");
+        return;
+    }
+    request->onDisconnect([]()
+                          {
+        CaptureLockGuard lock;
+        downloads--;
+        if (downloads == 0 && clearPending)
+            emptyRing(); });
+
+    AsyncWebServerResponse *response = request->beginResponse("application/octet-stream", total, fillDownload);
+    response->addHeader("Content-Disposition", "attachment; filename=\"capture.bin\"");
+    request->send(response);
+}
+
+void setupReportCapture(AsyncWebServer &server)
+{
+    captureLock = xSemaphoreCreateMutex();
+    server.on("/api/capture", HTTP_POST, handleCaptureControl);
+    server.on("/capture.bin", HTTP_GET, handleCaptureDownload);
+}
+
+void serializeReportCapture(JsonObject out)
+{
+    out["active"] = capturing;
+    out["bufferSize"] = ring != nullptr ? CAPTURE_RING_BYTES : 0;
+    out["bytesUsed"] = ringUsed;
+    out["captured"] = captureStats.captured;
+    out["evicted"] = captureStats.evicted;
+    out["skipped"] = captureStats.skipped;
+}
@@ -0,0 +1,43 @@
+#ifndef _REPORTCAPTURE
+#define _REPORTCAPTURE
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+
+// Binary capture of raw printer reports for offline replay. While a capture
+// runs every report is copied as-is into a fixed RAM ring (no formatting, no
+// logging); when the ring is full the oldest reports are dropped.
+//
+// GET /capture.bin downloads the ring, oldest report first:
+//   file header:   "BLFCAP" 0x01 0x00
+//   per report:    uint32 first byte time (us, wraps), uint32 length, raw bytes
+// (little endian). `bblp_load.py --replay capture.bin` plays it back.
+constexpr size_t CAPTURE_RING_BYTES = 32768;
+constexpr uint8_t CAPTURE_FORMAT_VERSION = 1;
+
+struct CaptureStats {
+    uint32_t captured = 0;      // Reports written to the ring
+    uint32_t evicted = 0;       // Oldest reports dropped to make room
+    uint32_t skipped = 0;       // Larger than the ring, truncated, or arrived during a download
+};
+
+extern CaptureStats captureStats;
+
+// Allocate the ring (if needed) and start recording; false if out of memory
+bool startReportCapture();
+// Stop recording, the captured reports stay downloadable
+void stopReportCapture();
+// Stop and free the ring
+void clearReportCapture();
+bool reportCaptureActive();
+
+// MQTT task: a complete raw report (firstByteUs from ReportStream)
+void captureReport(const uint8_t *data, size_t len, uint32_t firstByteUs);
+
+// POST /api/capture?action=start|stop|clear and GET /capture.bin
+void setupReportCapture(AsyncWebServer &server);
+
+void serializeReportCapture(JsonObject out);
+
+#endif
@@ -0,0 +1,809 @@
+#include "reportparser.h"
+
+// Container node ids (what a JSON object/array represents)
+enum ReportNode : uint8_t {
+    NODE_OTHER = 0,
+    NODE_ROOT,
+    NODE_PRINT,
+    NODE_SYSTEM,
+    NODE_HMS_LIST,
+    NODE_HMS_ITEM,
+    NODE_LIGHTS_LIST,
+    NODE_LIGHT_ITEM,
+    NODE_AMS,           // print.ams
+    NODE_AMS_LIST,      // print.ams.ams
+    NODE_AMS_UNIT,
+    NODE_TRAY_LIST,     // print.ams.ams[].tray
+    NODE_TRAY_ITEM,
+    NODE_VT_TRAY        // print.vt_tray (external spool)
+};
+
+// Keys the parser cares about
+enum ReportKey : uint8_t {
+    KEY_NONE = 0,
+    KEY_PRINT,
+    KEY_SYSTEM,
+    KEY_COMMAND,
+    KEY_GCODE_STATE,
+    KEY_HMS,
+    KEY_HOME_FLAG,
+    KEY_LIGHTS_REPORT,
+    KEY_STG_CUR,
+    KEY_MC_PERCENT,
+    KEY_LED_MODE,
+    KEY_ATTR,
+    KEY_CODE,
+    KEY_NODE,
+    KEY_MODE,
+    KEY_AMS,
+    KEY_TRAY_NOW,
+    KEY_TRAY,
+    KEY_TRAY_COLOR,
+    KEY_VT_TRAY,
+    KEY_ID,
+    // Telemetry keys (print node), keep last
+    KEY_NOZZLE_TEMPER,
+    KEY_NOZZLE_TARGET_TEMPER,
+    KEY_BED_TEMPER,
+    KEY_BED_TARGET_TEMPER,
+    KEY_LAYER_NUM,
+    KEY_TOTAL_LAYER_NUM,
+    KEY_MC_REMAINING_TIME
+};
+
+struct KeyName {
+    uint8_t node;
+    uint8_t key;
+    const char *name;
+};
+
+static const KeyName keyNames[] = {
+    {NODE_ROOT, KEY_PRINT, "print"},
+    {NODE_ROOT, KEY_SYSTEM, "system"},
+    {NODE_PRINT, KEY_COMMAND, "command"},
+    {NODE_PRINT, KEY_GCODE_STATE, "gcode_state"},
+    {NODE_PRINT, KEY_HMS, "hms"},
+    {NODE_PRINT, KEY_HOME_FLAG, "home_flag"},
+    {NODE_PRINT, KEY_LIGHTS_REPORT, "lights_report"},
+    {NODE_PRINT, KEY_STG_CUR, "stg_cur"},
+    {NODE_PRINT, KEY_MC_PERCENT, "mc_percent"},
+    {NODE_PRINT, KEY_NOZZLE_TEMPER, "nozzle_temper"},
+    {NODE_PRINT, KEY_NOZZLE_TARGET_TEMPER, "nozzle_target_temper"},
+    {NODE_PRINT, KEY_BED_TEMPER, "bed_temper"},
+    {NODE_PRINT, KEY_BED_TARGET_TEMPER, "bed_target_temper"},
+    {NODE_PRINT, KEY_LAYER_NUM, "layer_num"},
+    {NODE_PRINT, KEY_TOTAL_LAYER_NUM, "total_layer_num"},
+    {NODE_PRINT, KEY_MC_REMAINING_TIME, "mc_remaining_time"},
+    {NODE_PRINT, KEY_AMS, "ams"},
+    {NODE_PRINT, KEY_VT_TRAY, "vt_tray"},
+    {NODE_SYSTEM, KEY_COMMAND, "command"},
+    {NODE_SYSTEM, KEY_LED_MODE, "led_mode"},
+    {NODE_HMS_ITEM, KEY_ATTR, "attr"},
+    {NODE_HMS_ITEM, KEY_CODE, "code"},
+    {NODE_LIGHT_ITEM, KEY_NODE, "node"},
+    {NODE_LIGHT_ITEM, KEY_MODE, "mode"},
+    {NODE_AMS, KEY_AMS, "ams"},
+    {NODE_AMS, KEY_TRAY_NOW, "tray_now"},
+    {NODE_AMS_UNIT, KEY_ID, "id"},
+    {NODE_AMS_UNIT, KEY_TRAY, "tray"},
+    {NODE_TRAY_ITEM, KEY_ID, "id"},
+    {NODE_TRAY_ITEM, KEY_TRAY_COLOR, "tray_color"},
+    {NODE_VT_TRAY, KEY_ID, "id"},
+    {NODE_VT_TRAY, KEY_TRAY_COLOR, "tray_color"},
+};
+
+static const uint8_t ARRAY_FLAG = 0x80;
+static const uint32_t FNV_OFFSET = 2166136261u;
+static const uint32_t FNV_PRIME = 16777619u;
+// endNumber() scales telemetry values by 10 for the first decimal
+static const int64_t NUMBER_LIMIT = INT64_MAX / 10 - 1;
+static const float TELEMETRY_LIMIT = 1e9f;      // Tenths, fits the 32-bit long of lroundf()
+
+static inline bool isTelemetryKey(uint8_t key)
+{
+    return key >= KEY_NOZZLE_TEMPER;
+}
+
+static inline bool isWhitespace(uint8_t c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline bool isNumberChar(uint8_t c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static void copyString(char *dest, const char *src)
+{
+    strncpy(dest, src, REPORT_MAX_STRING - 1);
+    dest[REPORT_MAX_STRING - 1] = '\0';
+}
+
+ReportParser::ReportParser()
+{
+    reset();
+}
+
+void ReportParser::reset()
+{
+    _state = ST_START;
+    _length = 0;
+    _fingerprint = FNV_OFFSET;
+    _delta = ReportDelta();
+    _depth = 0;
+    _key = KEY_NONE;
+    _bufLen = 0;
+    _inKey = false;
+}
+
+void ReportParser::feed(uint8_t c)
+{
+    _length++;
+    if (_state == ST_ERROR)
+        return;
+
+    // A number or literal ends at the first character that is not part of it,
+    // that character is then handled by the next state
+    while (!step(c))
+    {
+        if (_state == ST_ERROR)
+            return;
+    }
+}
+
+// Returns false if the character must be processed again in the new state
+bool ReportParser::step(uint8_t c)
+{
+    switch (_state)
+    {
+    case ST_START:
+        if (isWhitespace(c))
+            return true;
+        if (c != '{')
+            break;
+        push(false, NODE_ROOT);
+        _state = ST_OBJECT_FIRST;
+        return true;
+
+    case ST_OBJECT_FIRST:
+    case ST_OBJECT_NEXT:
+        if (isWhitespace(c))
+            return true;
+        if (c == '"')
+        {
+            _inKey = true;
+            _bufLen = 0;
+            _state = ST_STRING;
+            return true;
+        }
+        if (c == '}' && _state == ST_OBJECT_FIRST)
+        {
+            pop(false);
+            return true;
+        }
+        break;
+
+    case ST_COLON:
+        if (isWhitespace(c))
+            return true;
+        if (c != ':')
+            break;
+        _state = ST_VALUE;
+        return true;
+
+    case ST_VALUE:
+        if (isWhitespace(c))
+            return true;
+        if (beginValue(c))
+            return true;
+        break;
+
+    case ST_ARRAY_FIRST:
+        if (isWhitespace(c))
+            return true;
+        if (c == ']')
+        {
+            pop(true);
+            return true;
+        }
+        if (beginValue(c))
+            return true;
+        break;
+
+    case ST_AFTER_VALUE:
+        if (isWhitespace(c))
+            return true;
+        if (c == ',')
+        {
+            _state = topIsArray() ? ST_VALUE : ST_OBJECT_NEXT;
+            return true;
+        }
+        if ((c == '}' && !topIsArray()) || (c == ']' && topIsArray()))
+        {
+            pop(topIsArray());
+            return true;
+        }
+        break;
+
+    case ST_STRING:
+        if (c == '"')
+        {
+            endString();
+            return true;
+        }
+        if (c == '\\')
+        {
+            _state = ST_ESCAPE;
+            return true;
+        }
+        if (_bufLen < REPORT_MAX_STRING - 1)
+            _buf[_bufLen++] = c;
+        return true;
+
+    case ST_ESCAPE:
+        if (c == 'u')
+        {
+            // Non-ASCII characters are not needed for any recognised value
+            _unicodeLeft = 4;
+            _state = ST_UNICODE;
+            c = '?';
+        }
+        else
+        {
+            _state = ST_STRING;
+            if (c == 'n')
+                c = '\n';
+            else if (c == 't')
+                c = '\t';
+            else if (c == 'r')
+                c = '\r';
+        }
+        if (_bufLen < REPORT_MAX_STRING - 1)
+            _buf[_bufLen++] = c;
+        return true;
+
+    case ST_UNICODE:
+        if (--_unicodeLeft == 0)
+            _state = ST_STRING;
+        return true;
+
+    case ST_NUMBER:
+        if (!isNumberChar(c))
+        {
+            endNumber();
+            _state = ST_AFTER_VALUE;
+            return false;
+        }
+        if (c >= '0' && c <= '9')
+        {
+            if (!_numberFraction && _number < NUMBER_LIMIT / 10)
+                _number = _number * 10 + (c - '0');
+            else if (_tenthsPending)
+                _numberTenths = c - '0';
+            _tenthsPending = false;
+        }
+        else if (c == '-' && _number == 0 && !_numberFraction)
+        {
+            _numberNegative = true;
+        }
+        else
+        {
+            // Fractions and exponents are ignored except for the first decimal,
+            // which the telemetry fields keep as fixed point
+            _tenthsPending = c == '.' && !_numberFraction;
+            _numberFraction = true;
+        }
+        return true;
+
+    case ST_LITERAL:
+        if (c >= 'a' && c <= 'z')
+            return true;
+        _state = ST_AFTER_VALUE;
+        return false;
+
+    case ST_DONE:
+        if (isWhitespace(c) || c == '\0')
+            return true;
+        break;
+
+    default:
+        break;
+    }
+
+    _state = ST_ERROR;
+    return true;
+}
+
+bool ReportParser::beginValue(uint8_t c)
+{
+    if (c == '{')
+        return push(false, childNode());
+    if (c == '[')
+        return push(true, childNode());
+    if (c == '"')
+    {
+        _inKey = false;
+        _bufLen = 0;
+        _state = ST_STRING;
+        return true;
+    }
+    if (c == '-' || (c >= '0' && c <= '9'))
+    {
+        _number = 0;
+        _numberNegative = false;
+        _numberFraction = false;
+        _tenthsPending = false;
+        _numberTenths = 0;
+        _bufLen = 0;
+        _state = ST_NUMBER;
+        step(c);
+        return true;
+    }
+    if (c == 't' || c == 'f' || c == 'n')
+    {
+        _state = ST_LITERAL;
+        return true;
+    }
+    return false;
+}
+
+bool ReportParser::push(bool isArray, uint8_t node)
+{
+    if (_depth >= REPORT_MAX_DEPTH)
+        return false;
+
+    // Recognised containers are part of the fingerprint, so the same key and
+    // value under another parent (vt_tray / AMS tray, another AMS unit) or an
+    // empty hms list change it
+    if (node != NODE_OTHER)
+        mix(node, KEY_NONE, nullptr, 0);
+
+    if (node == NODE_HMS_LIST)
+    {
+        _delta.hmsCount = 0;
+        _delta.set(FIELD_HMS);
+    }
+    else if (node == NODE_HMS_ITEM)
+    {
+        _hmsItem.attr = 0;
+        _hmsItem.code = 0;
+    }
+    else if (node == NODE_LIGHT_ITEM)
+    {
+        _lightIsChamber = false;
+        _lightOn = false;
+    }
+    else if (node == NODE_AMS_LIST)
+    {
+        _amsIndex = 0;
+    }
+    else if (node == NODE_AMS_UNIT)
+    {
+        _amsId = -1;
+    }
+    else if (node == NODE_TRAY_ITEM || node == NODE_VT_TRAY)
+    {
+        _trayId = -1;
+        _trayColor = 0;
+        _trayHasColor = false;
+    }
+
+    _stack[_depth++] = node | (isArray ? ARRAY_FLAG : 0);
+    _key = KEY_NONE;
+    _state = isArray ? ST_ARRAY_FIRST : ST_OBJECT_FIRST;
+    return true;
+}
+
+bool ReportParser::pop(bool isArray)
+{
+    uint8_t node = topNode();
+
+    if (node == NODE_HMS_ITEM)
+    {
+        if (_delta.hmsCount < REPORT_MAX_HMS)
+            _delta.hms[_delta.hmsCount++] = _hmsItem;
+    }
+    else if (node == NODE_LIGHT_ITEM && _lightIsChamber)
+    {
+        _delta.chamberLightOn = _lightOn;
+        _delta.set(FIELD_CHAMBER_LIGHT);
+    }
+    else if (node == NODE_AMS_UNIT)
+    {
+        _amsIndex++;
+    }
+    else if (node == NODE_TRAY_ITEM && _trayId >= 0)
+    {
+        // AMS HT units (id 128+) have a single tray numbered like the unit
+        int16_t unit = _amsId >= 0 ? _amsId : _amsIndex;
+        addTray(unit >= 128 ? unit : unit * 4 + _trayId);
+    }
+    else if (node == NODE_VT_TRAY)
+    {
+        addTray(_trayId >= 0 ? _trayId : TRAY_EXTERNAL);
+    }
+
+    _depth--;
+    _key = KEY_NONE;
+    _state = (_depth == 0) ? ST_DONE : ST_AFTER_VALUE;
+    return true;
+}
+
+uint8_t ReportParser::topNode() const
+{
+    return _depth ? (_stack[_depth - 1] & ~ARRAY_FLAG) : NODE_OTHER;
+}
+
+bool ReportParser::topIsArray() const
+{
+    return _depth && (_stack[_depth - 1] & ARRAY_FLAG);
+}
+
+// Node id for a container that starts at the current position
+uint8_t ReportParser::childNode() const
+{
+    uint8_t parent = topNode();
+
+    if (topIsArray())
+    {
+        if (parent == NODE_HMS_LIST)
+            return NODE_HMS_ITEM;
+        if (parent == NODE_LIGHTS_LIST)
+            return NODE_LIGHT_ITEM;
+        if (parent == NODE_AMS_LIST)
+            return NODE_AMS_UNIT;
+        if (parent == NODE_TRAY_LIST)
+            return NODE_TRAY_ITEM;
+        return NODE_OTHER;
+    }
+
+    if (parent == NODE_ROOT)
+    {
+        if (_key == KEY_PRINT)
+            return NODE_PRINT;
+        if (_key == KEY_SYSTEM)
+            return NODE_SYSTEM;
+    }
+    else if (parent == NODE_PRINT)
+    {
+        if (_key == KEY_HMS)
+            return NODE_HMS_LIST;
+        if (_key == KEY_LIGHTS_REPORT)
+            return NODE_LIGHTS_LIST;
+        if (_key == KEY_AMS)
+            return NODE_AMS;
+        if (_key == KEY_VT_TRAY)
+            return NODE_VT_TRAY;
+    }
+    else if (parent == NODE_AMS && _key == KEY_AMS)
+    {
+        return NODE_AMS_LIST;
+    }
+    else if (parent == NODE_AMS_UNIT && _key == KEY_TRAY)
+    {
+        return NODE_TRAY_LIST;
+    }
+    return NODE_OTHER;
+}
+
+void ReportParser::resolveKey()
+{
+    uint8_t node = topNode();
+    _key = KEY_NONE;
+    if (node == NODE_OTHER)
+        return;
+
+    for (const KeyName &entry : keyNames)
+    {
+        if (entry.node == node && strcmp(entry.name, _buf) == 0)
+        {
+            _key = entry.key;
+            return;
+        }
+    }
+}
+
+void ReportParser::endString()
+{
+    _buf[_bufLen] = '\0';
+
+    if (_inKey)
+    {
+        resolveKey();
+        _state = ST_COLON;
+        return;
+    }
+
+    _state = ST_AFTER_VALUE;
+    if (_key == KEY_NONE)
+        return;
+
+    if (isTelemetryKey(_key))
+    {
+        // Numbers sent as strings; nan is not a value, inf and huge ones are clamped
+        float tenths = strtof(_buf, nullptr) * 10;
+        if (isnan(tenths))
+            return;
+        setTelemetry(lroundf(constrain(tenths, -TELEMETRY_LIMIT, TELEMETRY_LIMIT)));
+        return;
+    }
+
+    mix(topNode(), _key, _buf, _bufLen);
+    switch (topNode())
+    {
+    case NODE_PRINT:
+        if (_key == KEY_COMMAND)
+        {
+            copyString(_delta.command, _buf);
+            _delta.set(FIELD_COMMAND);
+        }
+        else if (_key == KEY_GCODE_STATE)
+        {
+            copyString(_delta.gcodeState, _buf);
+            _delta.set(FIELD_GCODE_STATE);
+        }
+        else
+        {
+            // Numbers sent as strings
+            setInteger(strtoll(_buf, nullptr, 10));
+        }
+        break;
+    case NODE_SYSTEM:
+        if (_key == KEY_COMMAND)
+        {
+            copyString(_delta.systemCommand, _buf);
+            _delta.set(FIELD_SYSTEM_COMMAND);
+        }
+        else if (_key == KEY_LED_MODE)
+        {
+            _delta.ledModeOn = strcmp(_buf, "on") == 0;
+            _delta.set(FIELD_LED_MODE);
+        }
+        break;
+    case NODE_HMS_ITEM:
+        setInteger(strtoll(_buf, nullptr, 10));
+        break;
+    case NODE_LIGHT_ITEM:
+        if (_key == KEY_NODE)
+            _lightIsChamber = strcmp(_buf, "chamber_light") == 0;
+        else if (_key == KEY_MODE)
+            _lightOn = strcmp(_buf, "on") == 0;
+        break;
+    case NODE_TRAY_ITEM:
+    case NODE_VT_TRAY:
+        if (_key == KEY_TRAY_COLOR)
+        {
+            _trayColor = strtoul(_buf, nullptr, 16);
+            _trayHasColor = true;
+        }
+        else
+        {
+            setInteger(strtoll(_buf, nullptr, 10));
+        }
+        break;
+    case NODE_AMS:
+    case NODE_AMS_UNIT:
+        // Numbers sent as strings
+        setInteger(strtoll(_buf, nullptr, 10));
+        break;
+    default:
+        break;
+    }
+}
+
+void ReportParser::endNumber()
+{
+    int64_t value = _numberNegative ? -_number : _number;
+    if (isTelemetryKey(_key))
+    {
+        int64_t tenths = _number * 10 + _numberTenths;
+        setTelemetry(_numberNegative ? -tenths : tenths);
+        return;
+    }
+
+    if (_key != KEY_NONE)
+        mix(topNode(), _key, &value, sizeof(value));
+    setInteger(value);
+}
+
+void ReportParser::mix(uint8_t node, uint8_t key, const void* data, size_t len)
+{
+    uint32_t hash = (_fingerprint ^ node) * FNV_PRIME;
+    hash = (hash ^ key) * FNV_PRIME;
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    _fingerprint = hash;
+}
+
+void ReportParser::setInteger(int64_t value)
+{
+    uint8_t node = topNode();
+
+    if (node == NODE_PRINT)
+    {
+        switch (_key)
+        {
+        case KEY_HOME_FLAG:
+            _delta.homeFlag = (uint32_t)value;
+            _delta.set(FIELD_HOME_FLAG);
+            break;
+        case KEY_STG_CUR:
+            _delta.stage = (int32_t)constrain(value, (int64_t)INT32_MIN, (int64_t)INT32_MAX);
+            _delta.set(FIELD_STAGE);
+            break;
+        case KEY_MC_PERCENT:
+            _delta.progress = (int32_t)constrain(value, (int64_t)INT32_MIN, (int64_t)INT32_MAX);
+            _delta.set(FIELD_PROGRESS);
+            break;
+        default:
+            break;
+        }
+    }
+    else if (node == NODE_HMS_ITEM)
+    {
+        if (_key == KEY_ATTR)
+            _hmsItem.attr = (uint32_t)value;
+        else if (_key == KEY_CODE)
+            _hmsItem.code = (uint32_t)value;
+    }
+    else if (node == NODE_AMS && _key == KEY_TRAY_NOW)
+    {
+        _delta.trayNow = (uint8_t)constrain(value, (int64_t)0, (int64_t)TRAY_NONE);
+        _delta.set(FIELD_TRAY_NOW);
+    }
+    else if (node == NODE_AMS_UNIT && _key == KEY_ID)
+    {
+        _amsId = (int16_t)constrain(value, (int64_t)0, (int64_t)255);
+    }
+    else if ((node == NODE_TRAY_ITEM || node == NODE_VT_TRAY) && _key == KEY_ID)
+    {
+        _trayId = (int16_t)constrain(value, (int64_t)0, (int64_t)255);
+    }
+}
+
+// Keep the color of a tray entry (entries without tray_color are left out)
+void ReportParser::addTray(int16_t id)
+{
+    if (!_trayHasColor || id < 0 || id > 255 || _delta.trayCount >= REPORT_MAX_TRAYS)
+        return;
+
+    _delta.trays[_delta.trayCount].id = (uint8_t)id;
+    _delta.trays[_delta.trayCount].color = _trayColor;
+    _delta.trayCount++;
+    _delta.set(FIELD_AMS_TRAYS);
+}
+
+void ReportParser::setTelemetry(int64_t tenths)
+{
+    int16_t temperature = (int16_t)constrain(tenths, (int64_t)INT16_MIN, (int64_t)INT16_MAX);
+    uint16_t count = (uint16_t)constrain(tenths / 10, (int64_t)0, (int64_t)UINT16_MAX);
+
+    switch (_key)
+    {
+    case KEY_NOZZLE_TEMPER:
+        _delta.nozzleTemp = temperature;
+        _delta.set(FIELD_NOZZLE_TEMP);
+        break;
+    case KEY_NOZZLE_TARGET_TEMPER:
+        _delta.nozzleTarget = temperature;
+        _delta.set(FIELD_NOZZLE_TARGET);
+        break;
+    case KEY_BED_TEMPER:
+        _delta.bedTemp = temperature;
+        _delta.set(FIELD_BED_TEMP);
+        break;
+    case KEY_BED_TARGET_TEMPER:
+        _delta.bedTarget = temperature;
+        _delta.set(FIELD_BED_TARGET);
+        break;
+    case KEY_LAYER_NUM:
+        _delta.layer = count;
+        _delta.set(FIELD_LAYER);
+        break;
+    case KEY_TOTAL_LAYER_NUM:
+        _delta.totalLayers = count;
+        _delta.set(FIELD_TOTAL_LAYERS);
+        break;
+    case KEY_MC_REMAINING_TIME:
+        _delta.remainingMin = count;
+        _delta.set(FIELD_REMAINING_TIME);
+        break;
+    default:
+        break;
+    }
+}
+
+ReportStream::ReportStream()
+    : _tap(nullptr), _firstByteUs(0), _messageCount(0), _errorCount(0), _maxMessageSize(0), _duplicateCount(0),
+      _largeMessageCount(0), _minFreeHeap(UINT32_MAX), _lastFingerprint(0), _hasFingerprint(false),
+      _forgotten(false)
+{
+}
+
+size_t ReportStream::write(uint8_t byte)
+{
+    if (_parser.length() == 0)
+    {
+        _firstByteUs = micros();
+        _forgotten = false;
+    }
+    _parser.feed(byte);
+    if (_parser.length() % REPORT_HEAP_SAMPLE_BYTES == 0)
+    {
+        // Large (AMS) reports are parsed as they stream in, only the TLS
+        // and PubSubClient buffers are held while they arrive
+        uint32_t freeHeap = ESP.getFreeHeap();
+        if (freeHeap < _minFreeHeap)
+            _minFreeHeap = freeHeap;
+    }
+    if (_tap)
+        _tap->write(byte);
+    return 1;
+}
+
+int ReportStream::read()
+{
+    return 0;
+}
+
+int ReportStream::available()
+{
+    return 1;
+}
+
+void ReportStream::flush()
+{
+}
+
+int ReportStream::peek()
+{
+    return 0;
+}
+
+bool ReportStream::endMessage()
+{
+    _messageCount++;
+    if (_parser.length() > _maxMessageSize)
+        _maxMessageSize = _parser.length();
+    if (_parser.length() >= REPORT_HEAP_SAMPLE_BYTES)
+        _largeMessageCount++;
+
+    if (!_parser.complete())
+    {
+        _errorCount++;
+        return false;
+    }
+    return true;
+}
+
+bool ReportStream::isDuplicate()
+{
+    if (!_hasFingerprint || _parser.fingerprint() != _lastFingerprint)
+        return false;
+
+    _duplicateCount++;
+    return true;
+}
+
+void ReportStream::acceptReport()
+{
+    if (_forgotten)
+        return;
+    _lastFingerprint = _parser.fingerprint();
+    _hasFingerprint = true;
+}
+
+void ReportStream::forgetReport()
+{
+    _hasFingerprint = false;
+    _forgotten = true;
+}
+
+void ReportStream::reset()
+{
+    _parser.reset();
+    if (_tap)
+        _tap->flush();
+}
@@ -0,0 +1,235 @@
+#ifndef _REPORTPARSER
+#define _REPORTPARSER
+
+#include <Arduino.h>
+#include <Stream.h>
+
+constexpr uint8_t REPORT_MAX_HMS = 16;     // HMS entries kept per report
+constexpr uint8_t REPORT_MAX_DEPTH = 32;   // JSON nesting supported
+constexpr uint8_t REPORT_MAX_STRING = 24;  // Longest string value / key kept
+constexpr uint8_t REPORT_MAX_TRAYS = 20;   // AMS trays with a color kept per report (4 AMS x 4 + AMS HT + external)
+constexpr uint8_t TRAY_NONE = 255;         // tray_now: no filament loaded
+constexpr uint8_t TRAY_EXTERNAL = 254;     // tray_now: external spool (vt_tray)
+constexpr uint16_t REPORT_HEAP_SAMPLE_BYTES = 512;  // Free heap is sampled every this many report bytes
+
+// Fields extracted from a printer report, used as bits in ReportDelta::present
+enum ReportField : uint8_t {
+    FIELD_COMMAND = 0,      // print.command
+    FIELD_GCODE_STATE,      // print.gcode_state
+    FIELD_HMS,              // print.hms[].attr / .code
+    FIELD_HOME_FLAG,        // print.home_flag
+    FIELD_CHAMBER_LIGHT,    // print.lights_report[] entry with node "chamber_light"
+    FIELD_STAGE,            // print.stg_cur
+    FIELD_PROGRESS,         // print.mc_percent
+    FIELD_SYSTEM_COMMAND,   // system.command
+    FIELD_LED_MODE,         // system.led_mode
+    FIELD_NOZZLE_TEMP,      // print.nozzle_temper
+    FIELD_NOZZLE_TARGET,    // print.nozzle_target_temper
+    FIELD_BED_TEMP,         // print.bed_temper
+    FIELD_BED_TARGET,       // print.bed_target_temper
+    FIELD_LAYER,            // print.layer_num
+    FIELD_TOTAL_LAYERS,     // print.total_layer_num
+    FIELD_REMAINING_TIME,   // print.mc_remaining_time
+    FIELD_AMS_TRAYS,        // print.ams.ams[].tray[].tray_color, print.vt_tray.tray_color
+    FIELD_TRAY_NOW,         // print.ams.tray_now
+    FIELD_COUNT             // At most 32 (ReportDelta::present)
+};
+
+// Telemetry fields: not part of the report fingerprint and never resolved
+// into LED state, only read by the patterns that display them
+constexpr uint32_t TELEMETRY_FIELDS = (1u << FIELD_NOZZLE_TEMP) | (1u << FIELD_NOZZLE_TARGET) |
+                                      (1u << FIELD_BED_TEMP) | (1u << FIELD_BED_TARGET) |
+                                      (1u << FIELD_LAYER) | (1u << FIELD_TOTAL_LAYERS) |
+                                      (1u << FIELD_REMAINING_TIME);
+
+struct HMSEntry {
+    uint32_t attr;
+    uint32_t code;
+};
+
+// Filament color of one AMS tray
+struct AmsTray {
+    uint8_t id;         // Global tray number as used by tray_now (ams id * 4 + tray id)
+    uint32_t color;     // tray_color, RRGGBBAA
+};
+
+// Typed values found in a single report. Only fields flagged in `present`
+// were part of the report.
+struct ReportDelta {
+    uint32_t present = 0;
+    char command[REPORT_MAX_STRING] = "";
+    char gcodeState[REPORT_MAX_STRING] = "";
+    char systemCommand[REPORT_MAX_STRING] = "";
+    uint32_t homeFlag = 0;
+    int32_t stage = 0;
+    int32_t progress = 0;
+    bool chamberLightOn = false;
+    bool ledModeOn = false;
+    uint8_t hmsCount = 0;
+    HMSEntry hms[REPORT_MAX_HMS];
+
+    // Telemetry (temperatures in 0.1 °C)
+    int16_t nozzleTemp = 0;
+    int16_t nozzleTarget = 0;
+    int16_t bedTemp = 0;
+    int16_t bedTarget = 0;
+    uint16_t layer = 0;
+    uint16_t totalLayers = 0;
+    uint16_t remainingMin = 0;
+
+    // AMS
+    uint8_t trayNow = TRAY_NONE;
+    uint8_t trayCount = 0;
+    AmsTray trays[REPORT_MAX_TRAYS];
+
+    bool has(ReportField field) const { return present & (1u << field); }
+    void set(ReportField field) { present |= (1u << field); }
+};
+
+// Single pass JSON tokenizer that is fed one byte at a time and only keeps
+// the values of the key paths listed in ReportField. No document is built
+// and the message itself is never buffered.
+class ReportParser
+{
+public:
+    ReportParser();
+
+    void reset();
+    void feed(uint8_t c);
+
+    // True once a complete top-level object has been parsed
+    bool complete() const { return _state == ST_DONE; }
+    bool failed() const { return _state == ST_ERROR; }
+    uint32_t length() const { return _length; }
+    const ReportDelta& delta() const { return _delta; }
+    // FNV-1a hash over the recognised containers, keys and values, in message order
+    uint32_t fingerprint() const { return _fingerprint; }
+
+private:
+    enum State : uint8_t {
+        ST_START,
+        ST_OBJECT_FIRST,
+        ST_OBJECT_NEXT,
+        ST_COLON,
+        ST_VALUE,
+        ST_ARRAY_FIRST,
+        ST_AFTER_VALUE,
+        ST_STRING,
+        ST_ESCAPE,
+        ST_UNICODE,
+        ST_NUMBER,
+        ST_LITERAL,
+        ST_DONE,
+        ST_ERROR
+    };
+
+    State _state;
+    uint32_t _length;
+    uint32_t _fingerprint;
+    ReportDelta _delta;
+
+    // Container stack: node id per level, top bit set for arrays
+    uint8_t _stack[REPORT_MAX_DEPTH];
+    uint8_t _depth;
+    uint8_t _key;           // Key of the member being parsed in the innermost object
+
+    // Current string / number
+    char _buf[REPORT_MAX_STRING];
+    uint8_t _bufLen;
+    bool _inKey;
+    uint8_t _unicodeLeft;
+    int64_t _number;
+    bool _numberNegative;
+    bool _numberFraction;
+    bool _tenthsPending;    // '.' seen, next digit is the first decimal
+    uint8_t _numberTenths;
+
+    // Per-item scratch for hms[] and lights_report[] entries
+    HMSEntry _hmsItem;
+    bool _lightIsChamber;
+    bool _lightOn;
+
+    // Per-item scratch for ams[] units and tray[] / vt_tray entries
+    uint8_t _amsIndex;      // Position in ams[], used if the unit has no id before its trays
+    int16_t _amsId;
+    int16_t _trayId;
+    uint32_t _trayColor;
+    bool _trayHasColor;
+
+    bool step(uint8_t c);
+    bool beginValue(uint8_t c);
+    bool push(bool isArray, uint8_t node);
+    bool pop(bool isArray);
+    uint8_t topNode() const;
+    bool topIsArray() const;
+    uint8_t childNode() const;
+    void resolveKey();
+    void endString();
+    void endNumber();
+    void setInteger(int64_t value);
+    void setTelemetry(int64_t tenths);
+    void addTray(int16_t id);
+    void mix(uint8_t node, uint8_t key, const void* data, size_t len);
+};
+
+// Stream handed to PubSubClient: report bytes go straight into the parser and
+// optionally to a tap stream (used to keep the raw report for debugging).
+class ReportStream : public Stream
+{
+private:
+    ReportParser _parser;
+    Stream* _tap;
+    uint32_t _firstByteUs;  // micros() when the first byte of the current report arrived
+
+    // Statistics
+    uint32_t _messageCount;
+    uint32_t _errorCount;
+    uint32_t _maxMessageSize;
+    uint32_t _duplicateCount;
+    uint32_t _largeMessageCount;    // Reports of REPORT_HEAP_SAMPLE_BYTES or more
+    uint32_t _minFreeHeap;          // Lowest free heap sampled while receiving them
+
+    // Fingerprint of the last report that was fully processed
+    uint32_t _lastFingerprint;
+    bool _hasFingerprint;
+    bool _forgotten;    // forgetReport() since the current report started
+
+public:
+    ReportStream();
+
+    virtual size_t write(uint8_t byte);
+    virtual int read();
+    virtual int available();
+    virtual void flush();
+    int peek();
+
+    // Close the current report; returns true if it parsed completely
+    bool endMessage();
+    // Prepare for the next report (also drops a partially received one)
+    void reset();
+
+    // True (and counted) if the report carries the same values as the last accepted one
+    bool isDuplicate();
+    // Remember the current report as processed / make sure the next one is
+    // processed. A report is not remembered if it was forgotten while being
+    // processed: local state set ahead of the printer must be re-read from
+    // the next report, even if that one is identical.
+    void acceptReport();
+    void forgetReport();
+
+    void setTap(Stream* tap) { _tap = tap; }
+    const ReportDelta& report() const { return _parser.delta(); }
+    uint32_t current_length() const { return _parser.length(); }
+    uint32_t first_byte_us() const { return _firstByteUs; }
+
+    uint32_t message_count() const { return _messageCount; }
+    uint32_t error_count() const { return _errorCount; }
+    uint32_t max_message_size() const { return _maxMessageSize; }
+    uint32_t duplicate_count() const { return _duplicateCount; }
+    uint32_t large_message_count() const { return _largeMessageCount; }
+    uint32_t min_free_heap() const { return _minFreeHeap; }
+
+    using Print::write;
+};
+
+#endif
@@ -0,0 +1,710 @@
+#include "reportrelay.h"
+#include <AsyncTCP.h>
+#include <memory>
+#include <vector>
+#include "types.h"
+#include "logserial.h"
+#include "mqttmanager.h"
+#include "statecache.h"
+
+// One report, shared by every subscriber until the last one is done with it
+typedef std::shared_ptr<std::vector<uint8_t>> RelayFrame;
+
+// Report frames plus room for control packets (CONNACK, SUBACK, PINGRESP)
+constexpr uint8_t RELAY_QUEUE_SLOTS = RELAY_QUEUE_DEPTH + 2;
+
+struct MqttSubscriber {
+    AsyncClient *client = nullptr;
+    bool connected = false;       // CONNECT accepted
+    bool subscribed = false;      // Has a filter matching the report topic
+    RelayFrame queue[RELAY_QUEUE_SLOTS];
+    RelayFrame body[RELAY_QUEUE_SLOTS]; // Report payload after a PUBLISH header
+    bool isReport[RELAY_QUEUE_SLOTS];
+    uint8_t head = 0;
+    uint8_t count = 0;
+    uint8_t reports = 0;          // Report frames in the queue
+    size_t added = 0;             // Bytes from the head frame handed to the TCP stack
+    size_t acked = 0;             // ... and acknowledged by the peer
+    uint8_t rx[RELAY_RX_BUFFER];
+    uint16_t rxLen = 0;
+    uint32_t sent = 0;
+    uint32_t dropped = 0;
+};
+
+struct WsSubscriber {
+    uint32_t id = 0;              // 0 = free slot
+    AsyncWebSocketClient *client = nullptr;
+    uint32_t sent = 0;
+    uint32_t dropped = 0;
+};
+
+AsyncWebSocket wsReport("/ws/report");
+RelayStats relayStats;
+
+static AsyncServer *mqttServer = nullptr;
+static MqttSubscriber mqttSubscribers[RELAY_MAX_MQTT_CLIENTS];
+static WsSubscriber wsSubscribers[RELAY_MAX_WS_CLIENTS];
+static SemaphoreHandle_t relayLock = nullptr;
+
+// MQTT task (publish) and async_tcp task (socket events) share the subscriber
+// table. Recursive, as closing a client can run its disconnect handler inline.
+class RelayLockGuard
+{
+public:
+    RelayLockGuard() { xSemaphoreTakeRecursive(relayLock, portMAX_DELAY); }
+    ~RelayLockGuard() { xSemaphoreGiveRecursive(relayLock); }
+};
+
+// ============================================================================
+// State snapshot (sent to new subscribers)
+// ============================================================================
+
+static void buildStateSnapshot(String &out)
+{
+    const ReportDelta &state = stateCache.state;
+    JsonDocument doc;
+    JsonObject print = doc["print"].to<JsonObject>();
+    print["command"] = "push_status";
+
+    if (state.has(FIELD_GCODE_STATE))
+        print["gcode_state"] = state.gcodeState;
+    if (state.has(FIELD_STAGE))
+        print["stg_cur"] = state.stage;
+    if (state.has(FIELD_PROGRESS))
+        print["mc_percent"] = state.progress;
+    if (state.has(FIELD_HOME_FLAG))
+        print["home_flag"] = state.homeFlag;
+    if (state.has(FIELD_HMS))
+    {
+        JsonArray hms = print["hms"].to<JsonArray>();
+        for (uint8_t i = 0; i < state.hmsCount; i++)
+        {
+            JsonObject entry = hms.add<JsonObject>();
+            entry["attr"] = state.hms[i].attr;
+            entry["code"] = state.hms[i].code;
+        }
+    }
+    if (state.has(FIELD_CHAMBER_LIGHT))
+    {
+        JsonObject light = print["lights_report"].to<JsonArray>().add<JsonObject>();
+        light["node"] = "chamber_light";
+        light["mode"] = state.chamberLightOn ? "on" : "off";
+    }
+
+    serializeJson(doc, out);
+}
+
+// ============================================================================
+// MQTT subset endpoint
+// ============================================================================
+
+static size_t encodeRemainingLength(uint8_t *out, uint32_t length)
+{
+    size_t n = 0;
+    do
+    {
+        uint8_t digit = length % 128;
+        length /= 128;
+        out[n++] = digit | (length > 0 ? 0x80 : 0);
+    } while (length > 0 && n < 4);
+    return n;
+}
+
+// PUBLISH packet up to the payload, which is queued as a frame of its own so
+// the websocket path and every MQTT subscriber share one copy of the report
+static RelayFrame buildPublishHeader(size_t payloadLen)
+{
+    uint16_t topicLen = report_topic.length();
+    uint8_t header[5];
+    header[0] = 0x30; // PUBLISH, QoS 0
+    size_t headerLen = 1 + encodeRemainingLength(header + 1, 2 + topicLen + payloadLen);
+
+    RelayFrame frame = std::make_shared<std::vector<uint8_t>>();
+    frame->reserve(headerLen + 2 + topicLen);
+    frame->insert(frame->end(), header, header + headerLen);
+    frame->push_back(topicLen >> 8);
+    frame->push_back(topicLen & 0xFF);
+    frame->insert(frame->end(), report_topic.c_str(), report_topic.c_str() + topicLen);
+    return frame;
+}
+
+static RelayFrame buildControl(std::initializer_list<uint8_t> bytes)
+{
+    return std::make_shared<std::vector<uint8_t>>(bytes);
+}
+
+static void releaseQueue(MqttSubscriber &sub)
+{
+    for (uint8_t i = 0; i < RELAY_QUEUE_SLOTS; i++)
+    {
+        sub.queue[i].reset();
+        sub.body[i].reset();
+    }
+    sub.head = sub.count = sub.reports = 0;
+    sub.added = sub.acked = 0;
+}
+
+static size_t entrySize(const MqttSubscriber &sub, uint8_t slot)
+{
+    return sub.queue[slot]->size() + (sub.body[slot] ? sub.body[slot]->size() : 0);
+}
+
+// Hand queued bytes to the TCP stack. lwIP gets its own copy: after a close,
+// graceful or by the peer, the pcb lives on and may still retransmit after
+// onDisconnect released the queue. The frame itself stays shared by all
+// subscribers and queued until the peer acknowledged it, which bounds the
+// reports in flight.
+static void pump(MqttSubscriber &sub)
+{
+    AsyncClient *client = sub.client;
+    if (!client || !client->connected())
+        return;
+
+    size_t offset = sub.added;
+    bool queued = false;
+    bool blocked = false;
+    for (uint8_t i = 0; i < sub.count && !blocked; i++)
+    {
+        uint8_t slot = (sub.head + i) % RELAY_QUEUE_SLOTS;
+        const std::vector<uint8_t> *parts[] = {sub.queue[slot].get(), sub.body[slot].get()};
+        for (const std::vector<uint8_t> *frame : parts)
+        {
+            if (!frame)
+                continue;
+            if (offset >= frame->size())
+            {
+                offset -= frame->size();
+                continue;
+            }
+
+            size_t space = client->space();
+            size_t chunk = min(space, frame->size() - offset);
+            size_t written =
+                space ? client->add((const char *)frame->data() + offset, chunk, ASYNC_WRITE_FLAG_COPY) : 0;
+            sub.added += written;
+            queued = queued || written > 0;
+            if (written < frame->size() - offset)
+            {
+                blocked = true;
+                break;
+            }
+            offset = 0;
+        }
+    }
+
+    if (queued)
+        client->send();
+}
+
+static bool enqueue(MqttSubscriber &sub, const RelayFrame &frame, bool isReport,
+                    const RelayFrame &body = RelayFrame())
+{
+    if (isReport && sub.reports >= RELAY_QUEUE_DEPTH)
+    {
+        sub.dropped++;
+        relayStats.mqttDropped++;
+        return false;
+    }
+    if (sub.count >= RELAY_QUEUE_SLOTS)
+    {
+        // Control packets piling up: the subscriber does not read at all
+        sub.client->close(true);
+        return false;
+    }
+
+    uint8_t slot = (sub.head + sub.count) % RELAY_QUEUE_SLOTS;
+    sub.queue[slot] = frame;
+    sub.body[slot] = body;
+    sub.isReport[slot] = isReport;
+    sub.count++;
+    if (isReport)
+        sub.reports++;
+    pump(sub);
+    return true;
+}
+
+static void onMqttAck(void *arg, AsyncClient *client, size_t len, uint32_t time)
+{
+    MqttSubscriber &sub = *(MqttSubscriber *)arg;
+    RelayLockGuard lock;
+
+    sub.acked += len;
+    while (sub.count > 0 && sub.acked >= entrySize(sub, sub.head))
+    {
+        size_t size = entrySize(sub, sub.head);
+        if (sub.isReport[sub.head])
+        {
+            sub.reports--;
+            sub.sent++;
+            relayStats.mqttSent++;
+        }
+        sub.acked -= size;
+        sub.added -= size;
+        sub.queue[sub.head].reset();
+        sub.body[sub.head].reset();
+        sub.head = (sub.head + 1) % RELAY_QUEUE_SLOTS;
+        sub.count--;
+    }
+    pump(sub);
+}
+
+// MQTT topic filter match with + and # wildcards
+static bool topicMatches(const char *filter, size_t filterLen, const char *topic)
+{
+    size_t f = 0;
+    while (f < filterLen)
+    {
+        if (filter[f] == '#')
+            return true;
+        if (filter[f] == '+')
+        {
+            while (*topic && *topic != '/')
+                topic++;
+            f++;
+            continue;
+        }
+        if (*topic != filter[f])
+            return false;
+        topic++;
+        f++;
+    }
+    return *topic == '\0';
+}
+
+static bool readString(const uint8_t *&pos, const uint8_t *end, const uint8_t *&text, uint16_t &len)
+{
+    if (end - pos < 2)
+        return false;
+    len = (pos[0] << 8) | pos[1];
+    pos += 2;
+    if (end - pos < len)
+        return false;
+    text = pos;
+    pos += len;
+    return true;
+}
+
+static bool matchesCredential(const uint8_t *text, uint16_t len, const char *expected)
+{
+    return len == strlen(expected) && memcmp(text, expected, len) == 0;
+}
+
+static void handleConnect(MqttSubscriber &sub, const uint8_t *pos, const uint8_t *end)
+{
+    const uint8_t *text;
+    uint16_t len;
+    uint8_t returnCode = 0;
+
+    // Protocol name, level, flags, keepalive
+    if (!readString(pos, end, text, len) || end - pos < 4)
+    {
+        sub.client->close(true);
+        return;
+    }
+    uint8_t level = pos[0];
+    uint8_t flags = pos[1];
+    uint16_t keepAlive = (pos[2] << 8) | pos[3];
+    pos += 4;
+
+    if (level != 3 && level != 4)
+        returnCode = 1; // Unacceptable protocol version
+
+    // Client id, will topic / message, user name, password
+    const uint8_t *user = nullptr, *pass = nullptr;
+    uint16_t userLen = 0, passLen = 0;
+    bool ok = readString(pos, end, text, len);
+    if (ok && (flags & 0x04))
+        ok = readString(pos, end, text, len) && readString(pos, end, text, len);
+    if (ok && (flags & 0x80))
+        ok = readString(pos, end, user, userLen);
+    if (ok && (flags & 0x40))
+        ok = readString(pos, end, pass, passLen);
+    if (!ok)
+    {
+        sub.client->close(true);
+        return;
+    }
+
+    // Same credentials as the web interface, if set
+    if (returnCode == 0 && strlen(securityVariables.HTTPUser) > 0 && strlen(securityVariables.HTTPPass) > 0 &&
+        !(user && pass && matchesCredential(user, userLen, securityVariables.HTTPUser) &&
+          matchesCredential(pass, passLen, securityVariables.HTTPPass)))
+    {
+        returnCode = 4; // Bad user name or password
+    }
+
+    enqueue(sub, buildControl({0x20, 0x02, 0x00, returnCode}), false);
+    if (returnCode != 0)
+    {
+        relayStats.mqttRejected++;
+        return;
+    }
+
+    sub.connected = true;
+    if (keepAlive > 0)
+        sub.client->setRxTimeout(keepAlive + keepAlive / 2);
+}
+
+static void handleSubscribe(MqttSubscriber &sub, const uint8_t *pos, const uint8_t *end)
+{
+    if (end - pos < 2)
+        return;
+    uint8_t packetId[2] = {pos[0], pos[1]};
+    pos += 2;
+
+    RelayFrame suback = std::make_shared<std::vector<uint8_t>>();
+    suback->push_back(0x90);
+    suback->push_back(0); // Remaining length, set below
+    suback->push_back(packetId[0]);
+    suback->push_back(packetId[1]);
+
+    bool wasSubscribed = sub.subscribed;
+    const uint8_t *filter;
+    uint16_t filterLen;
+    while (pos < end && suback->size() < 64 && readString(pos, end, filter, filterLen) && pos < end)
+    {
+        pos++; // Requested QoS, always granted QoS 0
+        suback->push_back(0x00);
+        if (topicMatches((const char *)filter, filterLen, report_topic.c_str()))
+            sub.subscribed = true;
+    }
+    (*suback)[1] = suback->size() - 2;
+    enqueue(sub, suback, false);
+
+    if (sub.subscribed && !wasSubscribed)
+    {
+        String snapshot;
+        buildStateSnapshot(snapshot);
+        const uint8_t *data = (const uint8_t *)snapshot.c_str();
+        enqueue(sub, buildPublishHeader(snapshot.length()), true,
+                std::make_shared<std::vector<uint8_t>>(data, data + snapshot.length()));
+    }
+}
+
+static void handlePacket(MqttSubscriber &sub, uint8_t type, const uint8_t *pos, const uint8_t *end)
+{
+    if (!sub.connected && type != 0x10)
+    {
+        sub.client->close(true);
+        return;
+    }
+
+    switch (type)
+    {
+    case 0x10: // CONNECT
+        handleConnect(sub, pos, end);
+        break;
+    case 0x30: // PUBLISH: the relay is read-only, acknowledge QoS 1 and drop it
+        break;
+    case 0x80: // SUBSCRIBE
+        handleSubscribe(sub, pos, end);
+        break;
+    case 0xA0: // UNSUBSCRIBE
+        sub.subscribed = false;
+        if (end - pos >= 2)
+            enqueue(sub, buildControl({0xB0, 0x02, pos[0], pos[1]}), false);
+        break;
+    case 0xC0: // PINGREQ
+        enqueue(sub, buildControl({0xD0, 0x00}), false);
+        break;
+    case 0xE0: // DISCONNECT
+        sub.client->close(true);
+        break;
+    default:
+        break;
+    }
+}
+
+static void onMqttData(void *arg, AsyncClient *client, void *data, size_t len)
+{
+    MqttSubscriber &sub = *(MqttSubscriber *)arg;
+    RelayLockGuard lock;
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    while (len > 0 && sub.client)
+    {
+        size_t chunk = min(len, (size_t)(RELAY_RX_BUFFER - sub.rxLen));
+        memcpy(sub.rx + sub.rxLen, bytes, chunk);
+        sub.rxLen += chunk;
+        bytes += chunk;
+        len -= chunk;
+
+        // Process every complete packet in the buffer
+        while (sub.rxLen >= 2)
+        {
+            uint32_t remaining = 0;
+            uint8_t lengthBytes = 0;
+            bool complete = false;
+            while (lengthBytes < 4 && 1 + lengthBytes < sub.rxLen)
+            {
+                uint8_t digit = sub.rx[1 + lengthBytes];
+                remaining |= (uint32_t)(digit & 0x7F) << (7 * lengthBytes);
+                lengthBytes++;
+                if (!(digit & 0x80))
+                {
+                    complete = true;
+                    break;
+                }
+            }
+            if (!complete)
+                break;
+
+            size_t total = 1 + lengthBytes + remaining;
+            if (total > RELAY_RX_BUFFER)
+            {
+                // Larger than anything a subscriber needs to send
+                client->close(true);
+                return;
+            }
+            if (sub.rxLen < total)
+                break;
+
+            uint8_t type = sub.rx[0] & 0xF0;
+            const uint8_t *body = sub.rx + 1 + lengthBytes;
+            if (type == 0x30 && (sub.rx[0] & 0x06) == 0x02 && remaining >= 2)
+            {
+                // PUBLISH QoS 1: packet id follows the topic
+                uint16_t topicLen = (body[0] << 8) | body[1];
+                if (2u + topicLen + 2u <= remaining)
+                    enqueue(sub, buildControl({0x40, 0x02, body[2 + topicLen], body[3 + topicLen]}), false);
+            }
+            handlePacket(sub, type, body, body + remaining);
+            if (!sub.client)
+                return;
+
+            memmove(sub.rx, sub.rx + total, sub.rxLen - total);
+            sub.rxLen -= total;
+        }
+
+        if (sub.rxLen == RELAY_RX_BUFFER)
+        {
+            client->close(true);
+            return;
+        }
+    }
+}
+
+static void onMqttDisconnect(void *arg, AsyncClient *client)
+{
+    MqttSubscriber &sub = *(MqttSubscriber *)arg;
+    {
+        RelayLockGuard lock;
+        releaseQueue(sub);
+        sub.client = nullptr;
+        sub.connected = false;
+        sub.subscribed = false;
+        sub.rxLen = 0;
+    }
+    LogSerial.println(F("[Relay] MQTT subscriber disconnected"));
+    delete client;
+}
+
+static void onMqttClient(void *arg, AsyncClient *client)
+{
+    RelayLockGuard lock;
+
+    MqttSubscriber *slot = nullptr;
+    for (MqttSubscriber &sub : mqttSubscribers)
+    {
+        if (!sub.client)
+        {
+            slot = &sub;
+            break;
+        }
+    }
+
+    if (!slot)
+    {
+        relayStats.mqttRejected++;
+        client->onDisconnect([](void *, AsyncClient *c) { delete c; });
+        client->close(true);
+        return;
+    }
+
+    *slot = MqttSubscriber();
+    slot->client = client;
+    client->setNoDelay(true);
+    client->setRxTimeout(30); // Until CONNECT sets the keepalive
+    client->onData(onMqttData, slot);
+    client->onAck(onMqttAck, slot);
+    client->onDisconnect(onMqttDisconnect, slot);
+    client->onTimeout([](void *, AsyncClient *c, uint32_t) { c->close(true); }, slot);
+    client->onError([](void *, AsyncClient *c, int8_t) { c->close(true); }, slot);
+
+    LogSerial.print(F("[Relay] MQTT subscriber connected from "));
+    LogSerial.println(client->remoteIP().toString());
+}
+
+void setRelayMqttEnabled(bool enabled)
+{
+    if (enabled && !mqttServer)
+    {
+        mqttServer = new AsyncServer(RELAY_MQTT_PORT);
+        mqttServer->onClient(onMqttClient, nullptr);
+        mqttServer->begin();
+        LogSerial.printf("[Relay] MQTT relay listening on port %u\n", RELAY_MQTT_PORT);
+    }
+    else if (!enabled && mqttServer)
+    {
+        mqttServer->end();
+        delete mqttServer;
+        mqttServer = nullptr;
+
+        RelayLockGuard lock;
+        for (MqttSubscriber &sub : mqttSubscribers)
+        {
+            if (sub.client)
+                sub.client->close(true);
+        }
+        LogSerial.println(F("[Relay] MQTT relay stopped"));
+    }
+}
+
+// ============================================================================
+// Websocket channel
+// ============================================================================
+
+static WsSubscriber *findWsSubscriber(uint32_t id)
+{
+    for (WsSubscriber &sub : wsSubscribers)
+    {
+        if (sub.id == id)
+            return &sub;
+    }
+    return nullptr;
+}
+
+static void onWsReportEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
+                            void *arg, uint8_t *data, size_t len)
+{
+    RelayLockGuard lock;
+    if (type == WS_EVT_CONNECT)
+    {
+        WsSubscriber *sub = findWsSubscriber(0);
+        if (!sub)
+        {
+            relayStats.wsDropped++;
+            client->close();
+            return;
+        }
+        *sub = WsSubscriber();
+        sub->id = client->id();
+        sub->client = client;
+        // A subscriber that cannot keep up misses reports instead of being
+        // disconnected
+        client->setCloseClientOnQueueFull(false);
+
+        String snapshot;
+        buildStateSnapshot(snapshot);
+        client->text(snapshot);
+    }
+    else if (type == WS_EVT_DISCONNECT || type == WS_EVT_ERROR)
+    {
+        // The library deletes the client once this returns, the lock keeps
+        // relayReport() from sending to it meanwhile
+        WsSubscriber *sub = findWsSubscriber(client->id());
+        if (sub)
+        {
+            sub->id = 0;
+            sub->client = nullptr;
+        }
+        wsReport.cleanupClients();
+    }
+}
+
+// ============================================================================
+// Fan-out
+// ============================================================================
+
+bool reportRelayActive()
+{
+    if (wsReport.count() > 0)
+        return true;
+
+    for (const MqttSubscriber &sub : mqttSubscribers)
+    {
+        if (sub.subscribed)
+            return true;
+    }
+    return false;
+}
+
+void relayReport(const uint8_t *data, size_t len)
+{
+    relayStats.reports++;
+
+    // One copy of the report, sent as is to websocket subscribers and after a
+    // PUBLISH header to MQTT subscribers. This runs on the MQTT task; the
+    // async_tcp task clears a websocket subscriber under the same lock before
+    // the library deletes its client.
+    AsyncWebSocketSharedBuffer payload;
+    RelayLockGuard lock;
+    for (WsSubscriber &sub : wsSubscribers)
+    {
+        if (!sub.client)
+            continue;
+        if (!payload)
+            payload = std::make_shared<std::vector<uint8_t>>(data, data + len);
+        if (sub.client->text(payload))
+        {
+            sub.sent++;
+            relayStats.wsSent++;
+        }
+        else
+        {
+            sub.dropped++;
+            relayStats.wsDropped++;
+        }
+    }
+
+    RelayFrame header;
+    for (MqttSubscriber &sub : mqttSubscribers)
+    {
+        if (!sub.client || !sub.subscribed)
+            continue;
+        if (!payload)
+            payload = std::make_shared<std::vector<uint8_t>>(data, data + len);
+        if (!header)
+            header = buildPublishHeader(len);
+        enqueue(sub, header, true, payload);
+    }
+}
+
+void relaySubscriberStats(JsonArray &list)
+{
+    RelayLockGuard lock;
+    for (const WsSubscriber &sub : wsSubscribers)
+    {
+        if (!sub.id)
+            continue;
+        JsonObject item = list.add<JsonObject>();
+        item["type"] = "ws";
+        item["id"] = sub.id;
+        item["sent"] = sub.sent;
+        item["dropped"] = sub.dropped;
+    }
+
+    for (const MqttSubscriber &sub : mqttSubscribers)
+    {
+        if (!sub.client)
+            continue;
+        JsonObject item = list.add<JsonObject>();
+        item["type"] = "mqtt";
+        item["ip"] = sub.client->remoteIP().toString();
+        item["subscribed"] = sub.subscribed;
+        item["queued"] = sub.reports;
+        item["sent"] = sub.sent;
+        item["dropped"] = sub.dropped;
+    }
+}
+
+void setupReportRelay(AsyncWebServer &server)
+{
+    if (!relayLock)
+        relayLock = xSemaphoreCreateRecursiveMutex();
+
+    wsReport.onEvent(onWsReportEvent);
+    server.addHandler(&wsReport);
+
+    setRelayMqttEnabled(printerConfig.reportRelayMqtt);
+}
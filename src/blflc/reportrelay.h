@@ -0,0 +1,47 @@
+#ifndef _REPORTRELAY
+#define _REPORTRELAY
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+
+// Local fan-out of the printer report stream, so other consumers do not need
+// their own TLS session on the printer.
+//  - Websocket /ws/report: cached state on connect, then every raw report
+//  - Optional plain MQTT (3.1.1 subset, QoS 0, read-only) on RELAY_MQTT_PORT:
+//    SUBSCRIBE to device/<serial>/report (or a matching wildcard)
+constexpr uint16_t RELAY_MQTT_PORT = 1883;
+constexpr uint8_t RELAY_MAX_MQTT_CLIENTS = 4;
+constexpr uint8_t RELAY_MAX_WS_CLIENTS = 4;
+constexpr uint8_t RELAY_QUEUE_DEPTH = 4;     // Reports queued per subscriber before dropping
+constexpr uint16_t RELAY_RX_BUFFER = 256;    // Largest MQTT packet accepted from a subscriber
+
+// Counters reported via /api/metrics
+struct RelayStats {
+    uint32_t reports = 0;       // Reports fanned out
+    uint32_t wsSent = 0;        // Reports queued to websocket subscribers
+    uint32_t wsDropped = 0;     // Reports a websocket subscriber missed (queue full) or refused connections
+    uint32_t mqttSent = 0;
+    uint32_t mqttDropped = 0;   // MQTT subscriber had RELAY_QUEUE_DEPTH reports in flight
+    uint32_t mqttRejected = 0;  // Connections refused (no slot, credentials, protocol)
+};
+
+extern RelayStats relayStats;
+extern AsyncWebSocket wsReport;
+
+// Register /ws/report on the web server and start the MQTT endpoint if enabled
+void setupReportRelay(AsyncWebServer &server);
+
+// Start / stop the plain MQTT endpoint
+void setRelayMqttEnabled(bool enabled);
+
+// True if anyone is listening (the raw report only needs to be kept then)
+bool reportRelayActive();
+
+// Hand a complete raw report to all subscribers
+void relayReport(const uint8_t *data, size_t len);
+
+// Per-subscriber details for /api/metrics
+void relaySubscriberStats(JsonArray &list);
+
+#endif
@@ -0,0 +1,105 @@
+#include "socketwait.h"
+#include "logserial.h"
+
+SocketWaitStats socketWaitStats;
+
+static int wakeFd = -1;
+static struct sockaddr_in wakeAddr;
+
+bool setupSocketWait()
+{
+    if (wakeFd >= 0)
+        return true;
+
+    // UDP socket on the loopback interface, bound to an ephemeral port
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0)
+    {
+        LogSerial.println(F("[MQTT Task] Could not create wake socket, falling back to timed waits"));
+        return false;
+    }
+
+    memset(&wakeAddr, 0, sizeof(wakeAddr));
+    wakeAddr.sin_family = AF_INET;
+    wakeAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    wakeAddr.sin_port = 0;
+    socklen_t len = sizeof(wakeAddr);
+    if (bind(fd, (struct sockaddr *)&wakeAddr, sizeof(wakeAddr)) < 0 ||
+        getsockname(fd, (struct sockaddr *)&wakeAddr, &len) < 0)
+    {
+        close(fd);
+        LogSerial.println(F("[MQTT Task] Could not bind wake socket, falling back to timed waits"));
+        return false;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    wakeFd = fd;
+    return true;
+}
+
+void wakeMqttTask()
+{
+    if (wakeFd < 0)
+        return;
+
+    uint8_t token = 1;
+    sendto(wakeFd, &token, 1, 0, (struct sockaddr *)&wakeAddr, sizeof(wakeAddr));
+}
+
+SocketWaitSet::SocketWaitSet() : _maxFd(-1)
+{
+    FD_ZERO(&_fds);
+    add(wakeFd);
+}
+
+void SocketWaitSet::add(int fd)
+{
+    if (fd < 0)
+        return;
+    FD_SET(fd, &_fds);
+    if (fd > _maxFd)
+        _maxFd = fd;
+}
+
+bool SocketWaitSet::wait(unsigned long timeoutMs)
+{
+    socketWaitStats.waits++;
+
+    if (_maxFd < 0)
+    {
+        vTaskDelay(pdMS_TO_TICKS(timeoutMs));
+        socketWaitStats.timerWakeups++;
+        return false;
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+
+    int ready = select(_maxFd + 1, &_fds, nullptr, nullptr, &timeout);
+    if (ready < 0)
+    {
+        // A socket closed under us: give the caller a chance to notice
+        vTaskDelay(pdMS_TO_TICKS(10));
+        return true;
+    }
+    if (ready == 0)
+    {
+        socketWaitStats.timerWakeups++;
+        return false;
+    }
+
+    if (wakeFd >= 0 && FD_ISSET(wakeFd, &_fds))
+    {
+        uint8_t tokens[16];
+        while (recv(wakeFd, tokens, sizeof(tokens), 0) > 0)
+        {
+        }
+        socketWaitStats.loopbackWakeups++;
+        if (ready == 1)
+            return false;
+    }
+
+    socketWaitStats.socketWakeups++;
+    return true;
+}
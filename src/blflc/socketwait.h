@@ -0,0 +1,49 @@
+#ifndef _SOCKETWAIT
+#define _SOCKETWAIT
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <lwip/sockets.h>
+
+// Lets the MQTT task sleep until a printer socket is readable, a deadline
+// expires or another task wakes it, instead of polling every few ms.
+
+// WiFiClientSecure with access to its socket (for select())
+class PrinterTlsClient : public WiFiClientSecure
+{
+public:
+    int socketFd() const { return (sslclient && sslclient->socket >= 0) ? sslclient->socket : -1; }
+};
+
+// Wakeup counters reported via /api/metrics
+struct SocketWaitStats {
+    uint32_t waits = 0;
+    uint32_t socketWakeups = 0;     // A printer socket became readable
+    uint32_t timerWakeups = 0;      // Deadline (keepalive, held transition, reconnect) expired
+    uint32_t loopbackWakeups = 0;   // Woken by wakeMqttTask()
+    unsigned long maxDispatchUs = 0;   // Slowest wakeup to end of report processing
+};
+
+extern SocketWaitStats socketWaitStats;
+
+// File descriptors to wait on, plus the loopback wake socket
+class SocketWaitSet
+{
+private:
+    fd_set _fds;
+    int _maxFd;
+
+public:
+    SocketWaitSet();
+    void add(int fd);
+    // Sleep until a socket is readable or timeoutMs expired. Returns true if a socket is readable.
+    bool wait(unsigned long timeoutMs);
+};
+
+// Create the loopback wake socket (call from the MQTT task before waiting)
+bool setupSocketWait();
+
+// Make the MQTT task run its loop now (safe from any task)
+void wakeMqttTask();
+
+#endif
@@ -0,0 +1,94 @@
+#include "statecache.h"
+
+PrinterStateCache stateCache;
+
+void beginStateBootstrap()
+{
+    for (uint8_t i = 0; i < FIELD_COUNT; i++)
+        stateCache.seenMs[i] = 0;
+    stateCache.state.present = 0;
+    stateCache.connectedMs = millis();
+    stateCache.bootstrapping = true;
+}
+
+void mergeStateReport(const ReportDelta &report)
+{
+    uint32_t fields = report.present & STATE_FIELDS;
+    if (fields == 0)
+        return;
+
+    ReportDelta &state = stateCache.state;
+    if (report.has(FIELD_GCODE_STATE))
+        memcpy(state.gcodeState, report.gcodeState, sizeof(state.gcodeState));
+    if (report.has(FIELD_HMS))
+    {
+        state.hmsCount = report.hmsCount;
+        memcpy(state.hms, report.hms, report.hmsCount * sizeof(HMSEntry));
+    }
+    if (report.has(FIELD_HOME_FLAG))
+        state.homeFlag = report.homeFlag;
+    if (report.has(FIELD_CHAMBER_LIGHT))
+        state.chamberLightOn = report.chamberLightOn;
+    if (report.has(FIELD_STAGE))
+        state.stage = report.stage;
+    if (report.has(FIELD_PROGRESS))
+        state.progress = report.progress;
+
+    state.present |= fields;
+
+    // millis() can be 0 right after boot, 0 means "not seen"
+    unsigned long now = millis() | 1;
+    for (uint8_t i = 0; i < FIELD_COUNT; i++)
+    {
+        if (fields & (1u << i))
+            stateCache.seenMs[i] = now;
+    }
+}
+
+bool isStateBootstrapping()
+{
+    return stateCache.bootstrapping;
+}
+
+bool isStateComplete()
+{
+    return (stateCache.state.present & REQUIRED_STATE_FIELDS) == REQUIRED_STATE_FIELDS;
+}
+
+bool isStateBootstrapDue()
+{
+    return stateCache.bootstrapping &&
+           (isStateComplete() || millis() - stateCache.connectedMs >= STATE_BOOTSTRAP_TIMEOUT_MS);
+}
+
+bool finishStateBootstrap()
+{
+    if (!isStateBootstrapDue())
+        return false;
+
+    unsigned long elapsed = millis() - stateCache.connectedMs;
+    bool complete = isStateComplete();
+    stateCache.bootstrapping = false;
+    stateCache.bootstraps++;
+    if (!complete)
+        stateCache.bootstrapTimeouts++;
+    stateCache.lastBootstrapMs = elapsed;
+    if (elapsed > stateCache.maxBootstrapMs)
+        stateCache.maxBootstrapMs = elapsed;
+    return true;
+}
+
+unsigned long msUntilBootstrapTimeout()
+{
+    if (!stateCache.bootstrapping)
+        return ULONG_MAX;
+    unsigned long elapsed = millis() - stateCache.connectedMs;
+    return elapsed >= STATE_BOOTSTRAP_TIMEOUT_MS ? 0 : STATE_BOOTSTRAP_TIMEOUT_MS - elapsed;
+}
+
+long stateFieldAgeMs(ReportField field)
+{
+    if (stateCache.seenMs[field] == 0)
+        return -1;
+    return (long)(millis() - stateCache.seenMs[field]);
+}
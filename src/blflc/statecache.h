@@ -0,0 +1,56 @@
+#ifndef _STATECACHE
+#define _STATECACHE
+
+#include <Arduino.h>
+#include "reportparser.h"
+
+// Longest time the LEDs wait for a complete state after a (re)connect
+constexpr unsigned long STATE_BOOTSTRAP_TIMEOUT_MS = 5000;
+
+// Report fields that describe printer state (the others are one-off commands)
+constexpr uint32_t STATE_FIELDS = (1u << FIELD_GCODE_STATE) | (1u << FIELD_HMS) | (1u << FIELD_HOME_FLAG) |
+                                  (1u << FIELD_CHAMBER_LIGHT) | (1u << FIELD_STAGE) | (1u << FIELD_PROGRESS);
+
+// Fields that must be known before the LEDs are resolved after a (re)connect.
+// Not every model reports a chamber light or progress, so those are optional.
+constexpr uint32_t REQUIRED_STATE_FIELDS = (1u << FIELD_GCODE_STATE) | (1u << FIELD_HMS) |
+                                           (1u << FIELD_HOME_FLAG) | (1u << FIELD_STAGE);
+
+// Printer state merged from the partial reports received since the last connect
+struct PrinterStateCache {
+    ReportDelta state;                  // Last reported value of every state field
+    unsigned long seenMs[FIELD_COUNT];  // When each field was last reported (0 = not since connect)
+    unsigned long connectedMs = 0;
+    bool bootstrapping = false;         // Waiting for the pushall answer
+
+    // Statistics reported via /api/metrics
+    uint32_t bootstraps = 0;
+    uint32_t bootstrapTimeouts = 0;
+    unsigned long lastBootstrapMs = 0;  // Connect to LED resolve on complete state
+    unsigned long maxBootstrapMs = 0;
+};
+
+extern PrinterStateCache stateCache;
+
+// Forget field freshness and start waiting for a complete state (call on connect)
+void beginStateBootstrap();
+
+// Merge the state fields of a report into the cache
+void mergeStateReport(const ReportDelta &report);
+
+bool isStateBootstrapping();
+bool isStateComplete();
+
+// True while bootstrapping once the state is complete or the timeout expired
+bool isStateBootstrapDue();
+
+// Ends the bootstrap once it is due. Returns true only on the call that ended it.
+bool finishStateBootstrap();
+
+// Milliseconds until the bootstrap times out (ULONG_MAX if not bootstrapping)
+unsigned long msUntilBootstrapTimeout();
+
+// Milliseconds since a field was last reported, or -1 if not since connect
+long stateFieldAgeMs(ReportField field);
+
+#endif
@@ -0,0 +1,123 @@
+#include "statefilter.h"
+#include "types.h"
+#include "statecache.h"
+
+StateFilterStats stateFilterStats;
+
+static PendingTransition pendingStage;
+static PendingTransition pendingLight;
+
+bool isErrorStage(int stage)
+{
+    switch (stage)
+    {
+    case 6:  // Filament runout
+    case 16: // Paused by user
+    case 17: // Front cover removed
+    case 20: // Nozzle temp fail
+    case 21: // Bed temp fail
+    case 30: // Paused by gcode
+    case 34: // First layer error
+    case 35: // Nozzle clog
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Shared hold logic for a single printer field
+static bool filterTransition(PendingTransition& pending, int current, int reported, bool urgent)
+{
+    unsigned long holdMs = printerConfig.stateDebounceMs;
+
+    // Reported value matches what is applied: any held transition was a blip
+    if (reported == current)
+    {
+        if (pending.active)
+        {
+            pending.active = false;
+            stateFilterStats.droppedTransitions++;
+        }
+        return false;
+    }
+
+    if (holdMs == 0 || urgent)
+    {
+        if (urgent && holdMs > 0)
+            stateFilterStats.bypassedTransitions++;
+        pending.active = false;
+        return true;
+    }
+
+    if (!pending.active || pending.value != reported)
+    {
+        pending.active = true;
+        pending.value = reported;
+        pending.sinceMs = millis();
+        stateFilterStats.heldTransitions++;
+        return false;
+    }
+
+    if (millis() - pending.sinceMs >= holdMs)
+    {
+        pending.active = false;
+        stateFilterStats.committedTransitions++;
+        return true;
+    }
+    return false;
+}
+
+static bool takeSettled(PendingTransition& pending, int& value)
+{
+    if (!pending.active || (millis() - pending.sinceMs) < printerConfig.stateDebounceMs)
+        return false;
+
+    pending.active = false;
+    value = pending.value;
+    stateFilterStats.committedTransitions++;
+    return true;
+}
+
+// Values that complete the state after a (re)connect are applied immediately
+bool filterStage(int currentStage, int newStage)
+{
+    return filterTransition(pendingStage, currentStage, newStage, isErrorStage(newStage) || isStateBootstrapping());
+}
+
+bool filterLightState(bool currentState, bool newState)
+{
+    return filterTransition(pendingLight, currentState, newState, isStateBootstrapping());
+}
+
+bool takeSettledStage(int& stage)
+{
+    return takeSettled(pendingStage, stage);
+}
+
+bool takeSettledLightState(bool& state)
+{
+    int value;
+    if (!takeSettled(pendingLight, value))
+        return false;
+    state = value != 0;
+    return true;
+}
+
+static unsigned long msUntilSettled(const PendingTransition& pending)
+{
+    if (!pending.active)
+        return ULONG_MAX;
+    unsigned long held = millis() - pending.sinceMs;
+    return held >= printerConfig.stateDebounceMs ? 0 : printerConfig.stateDebounceMs - held;
+}
+
+unsigned long msUntilSettled()
+{
+    return min(msUntilSettled(pendingStage), msUntilSettled(pendingLight));
+}
+
+void resetStateFilter()
+{
+    pendingStage.active = false;
+    pendingLight.active = false;
+}
@@ -0,0 +1,47 @@
+#ifndef _STATEFILTER
+#define _STATEFILTER
+
+#include <Arduino.h>
+
+// Default hold time for non-error transitions (0 disables the filter)
+constexpr unsigned long DEFAULT_STATE_DEBOUNCE_MS = 1500;
+constexpr unsigned long MAX_STATE_DEBOUNCE_MS = 10000;
+
+// A transition that has been reported but not yet applied
+struct PendingTransition {
+    bool active = false;
+    int value = 0;
+    unsigned long sinceMs = 0;
+};
+
+// Counters reported via /api/metrics
+struct StateFilterStats {
+    uint32_t heldTransitions = 0;       // Transitions put on hold
+    uint32_t droppedTransitions = 0;    // Held transitions that reverted before the hold expired
+    uint32_t committedTransitions = 0;  // Held transitions applied after the hold expired
+    uint32_t bypassedTransitions = 0;   // Error-class / bootstrap transitions applied immediately
+    uint32_t resolves = 0;              // updateleds() passes
+    uint32_t redundantResolves = 0;     // updateleds() passes that did not change the LEDs
+    uint32_t ledChanges = 0;            // Actual color/pattern changes
+};
+
+extern StateFilterStats stateFilterStats;
+
+// Stages that are never delayed (errors and pauses)
+bool isErrorStage(int stage);
+
+// Returns true if the reported value should be applied now, false if it is held back
+bool filterStage(int currentStage, int newStage);
+bool filterLightState(bool currentState, bool newState);
+
+// Returns true (and the value) once a held transition has been stable for the hold time
+bool takeSettledStage(int& stage);
+bool takeSettledLightState(bool& state);
+
+// Milliseconds until the next held transition settles (ULONG_MAX if none is held)
+unsigned long msUntilSettled();
+
+// Drop any held transitions (e.g. on MQTT reconnect)
+void resetStateFilter();
+
+#endif
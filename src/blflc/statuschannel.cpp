@@ -0,0 +1,311 @@
+#include "statuschannel.h"
+#include <memory>
+#include <vector>
+#include <WiFi.h>
+#include "types.h"
+#include "leds.h"
+#include "logserial.h"
+#include "reportparser.h"
+
+#ifdef USE_ETHERNET
+#include <ETH.h>
+#endif
+
+// Fields of the status message, in the order they are written
+enum StatusField : uint16_t {
+    STATUS_IP = 1 << 0,
+    STATUS_SIGNAL = 1 << 1,         // wifi_rssi / link_speed
+    STATUS_DOOR = 1 << 2,
+    STATUS_CONNECTION = 1 << 3,
+    STATUS_CLIENTS = 1 << 4,
+    STATUS_STAGE = 1 << 5,
+    STATUS_GCODE_STATE = 1 << 6,
+    STATUS_LED_REASON = 1 << 7,
+    STATUS_PROGRESS = 1 << 8,
+    STATUS_ALL = 0x1FF
+};
+
+struct StatusFields {
+    uint32_t ip = 0;
+    int16_t signal = 0;
+    bool doorOpen = false;
+    bool online = false;
+    uint8_t clients = 0;
+    int stage = 0;
+    char gcodeState[REPORT_MAX_STRING] = "";
+    uint8_t ledReason = 0;
+    uint8_t progress = 0;
+};
+
+AsyncWebSocket ws("/ws");
+AsyncWebSocket wsMsgPack("/ws/msgpack");
+StatusStats statusStats;
+
+static StatusFields sentFields;         // What the clients have been sent
+static unsigned long lastPushMs = 0;
+static unsigned long lastPollMs = 0;
+static unsigned long lastResyncMs = 0;
+static bool polled = false;
+static bool resyncPending[2] = {false, false};     // Per format: a client missed a delta
+
+static uint8_t clientCount()
+{
+    return ws.count() + wsMsgPack.count();
+}
+
+// ============================================================================
+// Fields
+// ============================================================================
+
+static void readFields(StatusFields &fields)
+{
+    fields.doorOpen = printerVariables.doorOpen;
+    fields.online = printerVariables.online;
+    fields.clients = clientCount();
+    fields.stage = printerVariables.stage;
+    strlcpy(fields.gcodeState, printerVariables.gcodeState.c_str(), sizeof(fields.gcodeState));
+    fields.ledReason = printerVariables.ledReason;
+    fields.progress = printerVariables.printProgress;
+}
+
+static void readNetwork(StatusFields &fields)
+{
+#ifdef USE_ETHERNET
+    fields.ip = (uint32_t)ETH.localIP();
+    fields.signal = ETH.linkSpeed();
+#else
+    fields.ip = (uint32_t)WiFi.localIP();
+    fields.signal = WiFi.RSSI();
+#endif
+}
+
+// IP, RSSI and link speed have no change event, they are polled
+static void pollNetwork(StatusFields &fields, unsigned long now)
+{
+    if (polled && now - lastPollMs < STATUS_POLL_INTERVAL_MS)
+        return;
+    lastPollMs = now;
+    polled = true;
+
+    StatusFields network;
+    readNetwork(network);
+    fields.ip = network.ip;
+#ifdef USE_ETHERNET
+    fields.signal = network.signal;
+#else
+    if (abs(network.signal - sentFields.signal) >= STATUS_RSSI_DEADBAND)
+        fields.signal = network.signal;
+#endif
+}
+
+static uint16_t changedFields(const StatusFields &now, const StatusFields &sent)
+{
+    uint16_t changed = 0;
+    if (now.ip != sent.ip)
+        changed |= STATUS_IP;
+    if (now.signal != sent.signal)
+        changed |= STATUS_SIGNAL;
+    if (now.doorOpen != sent.doorOpen)
+        changed |= STATUS_DOOR;
+    if (now.online != sent.online)
+        changed |= STATUS_CONNECTION;
+    if (now.clients != sent.clients)
+        changed |= STATUS_CLIENTS;
+    if (now.stage != sent.stage)
+        changed |= STATUS_STAGE;
+    if (strcmp(now.gcodeState, sent.gcodeState) != 0)
+        changed |= STATUS_GCODE_STATE;
+    if (now.ledReason != sent.ledReason)
+        changed |= STATUS_LED_REASON;
+    if (now.progress != sent.progress)
+        changed |= STATUS_PROGRESS;
+    return changed;
+}
+
+static void addFields(JsonDocument &doc, const StatusFields &fields, uint16_t mask)
+{
+    // Constant or ever-changing: snapshot only
+    if (mask == STATUS_ALL)
+    {
+#ifdef USE_ETHERNET
+        doc["network_type"] = "ethernet";
+#else
+        doc["network_type"] = "wifi";
+#endif
+        doc["uptime"] = millis() / 1000;
+    }
+    if (mask & STATUS_IP)
+        doc["ip"] = IPAddress(fields.ip).toString();
+    if (mask & STATUS_SIGNAL)
+    {
+#ifdef USE_ETHERNET
+        doc["link_speed"] = fields.signal;
+#else
+        doc["wifi_rssi"] = fields.signal;
+#endif
+    }
+    if (mask & STATUS_DOOR)
+        doc["doorOpen"] = fields.doorOpen;
+    if (mask & STATUS_CONNECTION)
+        doc["printerConnection"] = fields.online;
+    if (mask & STATUS_CLIENTS)
+        doc["clients"] = fields.clients;
+    if (mask & STATUS_STAGE)
+        doc["stg_cur"] = fields.stage;
+    if (mask & STATUS_GCODE_STATE)
+        doc["gcodeState"] = fields.gcodeState;
+    if (mask & STATUS_LED_REASON)
+        doc["ledReason"] = ledReasonName(fields.ledReason);
+    if (mask & STATUS_PROGRESS)
+        doc["printProgress"] = fields.progress;
+}
+
+// ============================================================================
+// Sending
+// ============================================================================
+
+static AsyncWebSocketSharedBuffer encode(const JsonDocument &doc, bool msgpack)
+{
+    size_t len = msgpack ? measureMsgPack(doc) : measureJson(doc);
+    AsyncWebSocketSharedBuffer buffer = std::make_shared<std::vector<uint8_t>>(len + 1);
+    if (msgpack)
+        serializeMsgPack(doc, buffer->data(), buffer->size());
+    else
+        serializeJson(doc, (char *)buffer->data(), buffer->size());
+    buffer->resize(len);
+    return buffer;
+}
+
+// Changed fields (or everything, to resync) to every client of one format.
+// textAll() / binaryAll() walk the client list under the library's lock, the
+// async_tcp task removes clients from it.
+static void broadcast(bool msgpack, const StatusFields &fields, uint16_t changed, bool resync)
+{
+    AsyncWebSocket &socket = msgpack ? wsMsgPack : ws;
+    if (socket.count() == 0)
+    {
+        resyncPending[msgpack] = false;
+        return;
+    }
+    resync = resync && resyncPending[msgpack];
+    if (!changed && !resync)
+        return;
+
+    JsonDocument doc;
+    addFields(doc, fields, resync ? STATUS_ALL : changed);
+    AsyncWebSocketSharedBuffer frame = encode(doc, msgpack);
+    AsyncWebSocket::SendStatus status = msgpack ? socket.binaryAll(frame) : socket.textAll(frame);
+    statusStats.frames++;
+    statusStats.bytes += frame->size();
+    if (resync)
+        statusStats.snapshots++;
+
+    // Which client missed it is not known: all of them get the next snapshot
+    if (status != AsyncWebSocket::ENQUEUED)
+    {
+        statusStats.dropped++;
+        resyncPending[msgpack] = true;
+    }
+    else if (resync)
+    {
+        resyncPending[msgpack] = false;
+    }
+}
+
+void statusChannelLoop()
+{
+    if (clientCount() == 0)
+        return;
+    unsigned long now = millis();
+    if (now - lastPushMs < STATUS_MIN_INTERVAL_MS)
+        return;
+
+    StatusFields fields = sentFields;
+    readFields(fields);
+    pollNetwork(fields, now);
+    uint16_t changed = changedFields(fields, sentFields);
+
+    // A client that is still behind would get a snapshot on every push
+    bool resync = (resyncPending[0] || resyncPending[1]) && now - lastResyncMs >= STATUS_RESYNC_INTERVAL_MS;
+    if (!changed && !resync)
+        return;
+    if (resync)
+        lastResyncMs = now;
+
+    broadcast(false, fields, changed, resync);
+    broadcast(true, fields, changed, resync);
+    if (changed)
+        statusStats.deltas++;
+    sentFields = fields;
+    lastPushMs = now;
+}
+
+// ============================================================================
+// Clients
+// ============================================================================
+
+static void onStatusEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
+                          void *arg, uint8_t *data, size_t len)
+{
+    switch (type)
+    {
+    case WS_EVT_CONNECT:
+    {
+        LogSerial.printf("[WS] Client connected: %u\n", client->id());
+        if (clientCount() > STATUS_MAX_CLIENTS)
+        {
+            client->close();
+            break;
+        }
+        // A client that cannot keep up misses deltas instead of being
+        // disconnected, and is resynced
+        client->setCloseClientOnQueueFull(false);
+
+        // The snapshot goes out from here, where the client is known to exist
+        StatusFields fields;
+        readFields(fields);
+        readNetwork(fields);
+        JsonDocument snapshot;
+        addFields(snapshot, fields, STATUS_ALL);
+        bool msgpack = server == &wsMsgPack;
+        AsyncWebSocketSharedBuffer frame = encode(snapshot, msgpack);
+        if (msgpack)
+            client->binary(frame);
+        else
+            client->text(frame);
+        statusStats.snapshots++;
+        statusStats.frames++;
+        statusStats.bytes += frame->size();
+        break;
+    }
+    case WS_EVT_DISCONNECT:
+    case WS_EVT_ERROR:
+        LogSerial.printf(type == WS_EVT_ERROR ? "[WS] Error on connection %u\n" : "[WS] Client disconnected: %u\n",
+                         client->id());
+        server->cleanupClients();
+        break;
+    case WS_EVT_PONG:
+        LogSerial.printf("[WS] Pong received from %u\n", client->id());
+        break;
+    default:
+        break;
+    }
+}
+
+void setupStatusChannel(AsyncWebServer &server)
+{
+    ws.onEvent(onStatusEvent);
+    wsMsgPack.onEvent(onStatusEvent);
+    server.addHandler(&ws);
+    server.addHandler(&wsMsgPack);
+}
+
+void serializeStatusChannel(JsonObject out)
+{
+    out["clients"] = clientCount();
+    out["snapshots"] = statusStats.snapshots;
+    out["deltas"] = statusStats.deltas;
+    out["frames"] = statusStats.frames;
+    out["bytes"] = statusStats.bytes;
+    out["dropped"] = statusStats.dropped;
+}
@@ -0,0 +1,42 @@
+#ifndef _STATUSCHANNEL
+#define _STATUSCHANNEL
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+
+// Status websocket of the web pages: /ws sends JSON text frames, /ws/msgpack
+// the same messages as binary MessagePack. A client gets a full snapshot when
+// it connects, then only the fields that changed, as soon as they change (at
+// most every STATUS_MIN_INTERVAL_MS). Nothing is sent while nothing changes.
+// Every message is an object with the same keys as the snapshot. Messages are
+// broadcast once per format; if a client's queue was full, every client of
+// that format gets a snapshot again (at most every STATUS_RESYNC_INTERVAL_MS).
+constexpr uint16_t STATUS_MIN_INTERVAL_MS = 25;      // Coalesces bursts of changes (door flapping, ...)
+constexpr uint16_t STATUS_POLL_INTERVAL_MS = 1000;   // IP, RSSI and link speed have no change event
+constexpr uint8_t STATUS_RSSI_DEADBAND = 3;          // dBm, smaller RSSI changes are not sent
+constexpr uint16_t STATUS_RESYNC_INTERVAL_MS = 1000;
+constexpr uint8_t STATUS_MAX_CLIENTS = 8;
+
+// Counters reported via /api/metrics
+struct StatusStats {
+    uint32_t snapshots = 0;
+    uint32_t deltas = 0;        // Changes pushed (once per change, not per client)
+    uint32_t frames = 0;        // Messages sent (once per format, or to one client on connect)
+    uint32_t bytes = 0;
+    uint32_t dropped = 0;       // Messages a client missed because its queue was full
+};
+
+extern StatusStats statusStats;
+extern AsyncWebSocket ws;
+extern AsyncWebSocket wsMsgPack;
+
+// Register /ws and /ws/msgpack on the web server
+void setupStatusChannel(AsyncWebServer &server);
+
+// Main loop: sends pending snapshots and the fields that changed
+void statusChannelLoop();
+
+void serializeStatusChannel(JsonObject out);
+
+#endif
@@ -3,6 +3,7 @@
 
 // Global variable definitions
 PrinterVariables printerVariables;
+PrinterTelemetry printerTelemetry;
 SecurityVariables securityVariables;
 GlobalVariables globalVariables;
 PrinterConfig printerConfig;
@@ -16,6 +16,10 @@ extern "C"
     #ifndef DEFAULT_RELAY_INVERTED
     #define DEFAULT_RELAY_INVERTED false
     #endif
+    // Printers monitored in addition to the main printer (each costs one TLS session)
+    #ifndef MAX_EXTRA_PRINTERS
+    #define MAX_EXTRA_PRINTERS 3
+    #endif
 
     // LED strip types supported by FastLED
     enum LedChipType {
@@ -52,7 +56,60 @@ extern "C"
         PATTERN_BREATHING = 1,  // Brightness pulsing
         PATTERN_CHASE = 2,      // Moving light
         PATTERN_RAINBOW = 3,    // Color cycle
-        PATTERN_PROGRESS = 4    // Print progress bar
+        PATTERN_PROGRESS = 4,   // Print progress bar
+        PATTERN_HEATMAP = 5,    // Nozzle / bed temperature towards target (telemetry)
+        PATTERN_LAYER_PULSE = 6 // Flash on every new layer (telemetry)
+    };
+
+    // Reason for the current LED state (names in ledReasonNames[], leds.cpp)
+    enum LedReason : uint8_t {
+        REASON_INITIALIZING = 0,
+        REASON_MAINTENANCE,
+        REASON_WIFI_SIGNAL,
+        REASON_COLOR_TEST,
+        REASON_RGB_CYCLE,
+        REASON_PROGRESS_BAR,
+        REASON_BOOTING,
+        REASON_DOOR_TOGGLE,
+        REASON_FILAMENT_RUNOUT,
+        REASON_FRONT_COVER,
+        REASON_NOZZLE_TEMP_FAIL,
+        REASON_BED_TEMP_FAIL,
+        REASON_HMS_SERIOUS,
+        REASON_HMS_FATAL,
+        REASON_ERROR,
+        REASON_FIRST_LAYER_ERROR,
+        REASON_NOZZLE_CLOG,
+        REASON_PAUSED,
+        REASON_PRINTER_OFFLINE,
+        REASON_CHAMBER_LIGHT_OFF,
+        REASON_CLEANING_NOZZLE,
+        REASON_BED_LEVELING,
+        REASON_CALIBRATING_EXTRUSION,
+        REASON_SCANNING_BED,
+        REASON_FIRST_LAYER_SCAN,
+        REASON_CALIBRATING_LIDAR,
+        REASON_IDLE_TIMEOUT,
+        REASON_PREHEATING,
+        REASON_PRINTING,
+        REASON_PREPARING,
+        REASON_IDLE,
+        REASON_FAILED,
+        REASON_HOMING,
+        REASON_OFFLINE,
+        REASON_PRINT_FINISHED,
+        REASON_CHAMBER_LIGHT_ON,
+        REASON_HMS_CATALOGUE,
+        REASON_COUNT
+    };
+
+    // HMS severity (matches the top bits of the HMS code)
+    enum HMSSeverity : uint8_t {
+        HMS_NONE = 0,
+        HMS_FATAL = 1,
+        HMS_SERIOUS = 2,
+        HMS_COMMON = 3,
+        HMS_INFO = 4
     };
 
     typedef struct COLORStruct {
@@ -73,8 +130,17 @@ extern "C"
     } LedConfig;
 
 
+    // Additional printer shown on its own LED segment
+    typedef struct ExtraPrinterStruct {
+        char printerIP[16] = "";
+        char accessCode[9] = "";
+        char serialNumber[16] = "";
+        uint16_t ledStart = 0;          // First LED of the segment
+        uint16_t ledCount = 0;          // 0 = printer not used
+    } ExtraPrinter;
+
     typedef struct PrinterVariablesStruct{
-        String parsedHMSlevel = "";
+        uint8_t parsedHMSlevel = HMS_NONE;     // HMSSeverity of the active HMS code
         uint64_t parsedHMScode = 0;            //8 bytes per code stored
         String gcodeState = "FINISH";           //Initialised to Finish so the logic doesn't
                                                 //assume a Print has just finished and needs
@@ -84,10 +150,13 @@ extern "C"
         int overridestage = 999;
         bool printerLedState = true;
         bool hmsstate = false;
+        bool hmsColorOverride = false;         // Active HMS code has its own color in the HMS catalogue
+        COLOR hmsColor;
+        uint8_t hmsPattern = PATTERN_BREATHING;
         bool online = false;
         bool finished = false;
         bool initializedLEDs = false;
-        String ledReason = "Initializing";     // Human-readable reason for current LED state
+        uint8_t ledReason = REASON_INITIALIZING; // Reason for current LED state (see LedReason)
         //Time since
         unsigned long disconnectMQTTms = 0;
 
@@ -102,9 +171,25 @@ extern "C"
         unsigned long lastdoorOpenms = 0;       // Last time door was closed
         bool chamberLightLocked = false;  // blocks replicate while true
         bool ledWasForcedByDoor = false;
+        //AMS
+        uint8_t amsTrayNow = 255;               // Active tray (tray_now), 255 = none
+        bool amsColorValid = false;             // amsColor holds the filament color of the active tray
+        COLOR amsColor;
     } PrinterVariables;
     extern PrinterVariables printerVariables;
 
+    // Printer telemetry, only read by the telemetry patterns (fixed point, 0.1 °C)
+    typedef struct PrinterTelemetryStruct {
+        int16_t nozzleTemp = 0;
+        int16_t nozzleTarget = 0;
+        int16_t bedTemp = 0;
+        int16_t bedTarget = 0;
+        uint16_t layer = 0;
+        uint16_t totalLayers = 0;
+        uint16_t remainingMin = 0;
+    } PrinterTelemetry;
+    extern PrinterTelemetry printerTelemetry;
+
     typedef struct SecurityVariables{
                 // Security
         char HTTPUser[40] = "";             //http basic auth username
@@ -129,6 +214,7 @@ extern "C"
         char printerIP[16];             //BBLP IP Address - used for MQTT reports
         char accessCode[9];             //BBLP Access Code - used for MQTT reports
         char serialNumber[16];          //BBLP Serial Number - used for MQTT reports
+        ExtraPrinter extraPrinters[MAX_EXTRA_PRINTERS]; //Further printers, one LED segment each
 
         char BSSID[18];                 //Nominated AP to connect to (Useful if multiple accesspoints with same name)
         int brightness = 20;            //Brightness of LEDS - Default to 20% in case user use LED's that draw too much power for their PS
@@ -153,16 +239,21 @@ extern "C"
         unsigned long finishStartms = 0;    // Time the finish countdown is measured from
         int finishTimeOut = 600000;     //300000 = 5 mins
         bool controlChamberLight = false;                //control chamber light
+        bool amsColorMirror = false;                     //running color follows the active AMS tray
 
         //Inactivity Timout
         bool inactivityEnabled = true;
         bool isIdleOFFActive = false;       // Are the lights out due to inactivity Timeout?
         unsigned long inactivityStartms = 0;    // Time the inactivity countdown is measured from
         int inactivityTimeOut = 3600000;  // 1800000 = 30mins / 600000 = 10mins / 60000 = 1mins
+        //State Debounce
+        unsigned long stateDebounceMs = 1500;   // Hold time for short-lived stage / light transitions (0 = off)
         // Debugging
         bool debugging = false;          //Debugging for all interactions through functions
         bool debugOnChange = true;     //Default debugging level - to shows onChange
         bool mqttdebug = false;         //Writes each packet from BBLP to the serial log
+        // Report relay
+        bool reportRelayMqtt = false;   //Serves the printer reports to local MQTT subscribers
         //Custom Colors for events using lidar
         COLOR stage14Color;
         COLOR stage1Color;
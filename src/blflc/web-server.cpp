@@ -9,19 +9,28 @@
 #include "types.h"
 #include "logserial.h"
 #include "bblprinterdiscovery.h"
+#include "statefilter.h"
+#include "mqttmanager.h"
+#include "mqttparsingutility.h"
+#include "hmscatalogue.h"
+#include "statecache.h"
+#include "reportrelay.h"
+#include "printersession.h"
+#include "latencytrace.h"
+#include "commandqueue.h"
+#include "liveness.h"
+#include "reportcapture.h"
+#include "statuschannel.h"
+#include "ledpreview.h"
 
 #ifdef USE_ETHERNET
 #include "eth-manager.h"
 #endif
 
 AsyncWebServer webServer(80);
-AsyncWebSocket ws("/ws");
 
 #include "../www/www.h"
 
-unsigned long lastWsPush = 0;
-const unsigned long wsPushInterval = 1000; // alle 1000ms
-
 // External variables from main.cpp
 extern bool shouldRestart;
 extern unsigned long restartRequestTime;
@@ -35,6 +44,17 @@ bool isAuthorized(AsyncWebServerRequest *request)
     return request->authenticate(securityVariables.HTTPUser, securityVariables.HTTPPass);
 }
 
+// POST form field, or the fallback when it was not sent
+static String getSafeParamValue(AsyncWebServerRequest *req, const char *name, const char *fallback = "")
+{
+    return req->hasParam(name, true) ? req->getParam(name, true)->value() : fallback;
+}
+
+static int getSafeParamInt(AsyncWebServerRequest *req, const char *name, int fallback = 0)
+{
+    return req->hasParam(name, true) ? req->getParam(name, true)->value().toInt() : fallback;
+}
+
 void handleSetup(AsyncWebServerRequest *request)
 {
     if (!isAuthorized(request))
@@ -185,6 +205,8 @@ void handleGetConfig(AsyncWebServerRequest *request)
     doc["hmsIgnoreList"] = printerConfig.hmsIgnoreList;
     // control chamber light
     doc["controlChamberLight"] = printerConfig.controlChamberLight;
+    doc["amsColorMirror"] = printerConfig.amsColorMirror;
+    doc["stateDebounceMs"] = printerConfig.stateDebounceMs;
 
     // Relay settings
     doc["relayPin"] = printerConfig.relayPin;
@@ -209,6 +231,17 @@ void handlePrinterConfigJson(AsyncWebServerRequest *request)
     doc["accessCode"] = printerConfig.accessCode;
     doc["webUser"] = securityVariables.HTTPUser;
     doc["webPass"] = securityVariables.HTTPPass;
+    doc["reportRelayMqtt"] = printerConfig.reportRelayMqtt;
+    JsonArray extraPrinters = doc["extraPrinters"].to<JsonArray>();
+    for (const ExtraPrinter &extra : printerConfig.extraPrinters)
+    {
+        JsonObject item = extraPrinters.add<JsonObject>();
+        item["printerIP"] = extra.printerIP;
+        item["printerSerial"] = extra.serialNumber;
+        item["accessCode"] = extra.accessCode;
+        item["ledStart"] = extra.ledStart;
+        item["ledCount"] = extra.ledCount;
+    }
 #ifdef USE_ETHERNET
     doc["networkType"] = "ethernet";
     doc["deviceIP"] = ETH.localIP().toString();
@@ -244,16 +277,6 @@ void handleSubmitConfig(AsyncWebServerRequest *request)
         return request->requestAuthentication();
     }
 
-    auto getSafeParamValue = [](AsyncWebServerRequest *req, const char *name, const char *fallback = "") -> String
-    {
-        return req->hasParam(name, true) ? req->getParam(name, true)->value() : fallback;
-    };
-
-    auto getSafeParamInt = [](AsyncWebServerRequest *req, const char *name, int fallback = 0) -> int
-    {
-        return req->hasParam(name, true) ? req->getParam(name, true)->value().toInt() : fallback;
-    };
-
     // Check if LED hardware config changed (requires reinit)
     uint8_t oldChipType = printerConfig.ledConfig.chipType;
     uint8_t oldDataPin = printerConfig.ledConfig.dataPin;
@@ -299,8 +322,14 @@ void handleSubmitConfig(AsyncWebServerRequest *request)
     printerConfig.bedTempRGB = hex2rgb(getSafeParamValue(request, "bedTempRGB", "#FF0000"));
     // HMS Error handling
     printerConfig.hmsIgnoreList = getSafeParamValue(request, "hmsIgnoreList");
+    compileHMSIgnoreList(printerConfig.hmsIgnoreList);
+    stream.forgetReport();
     // Control Chamber Light
     printerConfig.controlChamberLight = request->hasParam("controlChamberLight", true);
+    printerConfig.amsColorMirror = request->hasParam("amsColorMirror", true);
+    printerConfig.stateDebounceMs = constrain(getSafeParamInt(request, "stateDebounceMs", DEFAULT_STATE_DEBOUNCE_MS),
+                                              0, (int)MAX_STATE_DEBOUNCE_MS);
+    wakeMqttTask(); // Held transitions settle on the new hold time
 
     // LED Hardware Configuration
     printerConfig.ledConfig.chipType = getSafeParamInt(request, "ledChipType", CHIP_WS2812B);
@@ -406,11 +435,108 @@ void handleLedTest(AsyncWebServerRequest *request)
     request->send(200, "application/json", "{\"status\":\"testing\"}");
 }
 
-void sendJsonToAll(JsonDocument &doc)
+// Runtime counters for diagnosing printer state handling
+void handleMetrics(AsyncWebServerRequest *request)
 {
-    String jsonString;
-    serializeJson(doc, jsonString);
-    ws.textAll(jsonString);
+    if (!isAuthorized(request))
+    {
+        return request->requestAuthentication();
+    }
+
+    JsonDocument doc;
+    doc["uptime"] = millis() / 1000;
+    doc["freeHeap"] = ESP.getFreeHeap();
+
+    JsonObject task = doc["mqttTask"].to<JsonObject>();
+    task["waits"] = socketWaitStats.waits;
+    task["socketWakeups"] = socketWaitStats.socketWakeups;
+    task["timerWakeups"] = socketWaitStats.timerWakeups;
+    task["loopbackWakeups"] = socketWaitStats.loopbackWakeups;
+    task["maxDispatchUs"] = socketWaitStats.maxDispatchUs;
+
+    JsonObject stateFilter = doc["stateFilter"].to<JsonObject>();
+    stateFilter["debounceMs"] = printerConfig.stateDebounceMs;
+    stateFilter["held"] = stateFilterStats.heldTransitions;
+    stateFilter["dropped"] = stateFilterStats.droppedTransitions;
+    stateFilter["committed"] = stateFilterStats.committedTransitions;
+    stateFilter["bypassed"] = stateFilterStats.bypassedTransitions;
+    stateFilter["resolves"] = stateFilterStats.resolves;
+    stateFilter["redundantResolves"] = stateFilterStats.redundantResolves;
+    stateFilter["ledChanges"] = stateFilterStats.ledChanges;
+
+    JsonObject ingest = doc["ingest"].to<JsonObject>();
+    ingest["messages"] = stream.message_count();
+    ingest["parseErrors"] = stream.error_count();
+    ingest["maxMessageSize"] = stream.max_message_size();
+    ingest["duplicates"] = stream.duplicate_count();
+    ingest["duplicatePercent"] = stream.message_count() ? (stream.duplicate_count() * 100.0f / stream.message_count()) : 0.0f;
+    ingest["rawBufferSize"] = rawStream.capacity();
+    ingest["rawOverflows"] = rawStream.overflow_count();
+    ingest["largeReports"] = stream.large_message_count();
+    ingest["minFreeHeapDuringReport"] = stream.large_message_count() ? stream.min_free_heap() : 0;
+
+    static const char *const connectPhases[] = {"", "dns", "tls", "mqtt"};
+    JsonObject connect = doc["connect"].to<JsonObject>();
+    serializeConnectionTracker(mqttConnection, connect);
+    connect["dnsMs"] = connectTiming.dnsMs;
+    connect["tlsMs"] = connectTiming.tlsMs;
+    connect["maxTlsMs"] = connectTiming.maxTlsMs;
+    connect["tlsHeap"] = connectTiming.tlsHeap;
+    connect["mqttMs"] = connectTiming.mqttMs;
+    connect["firstReportMs"] = connectTiming.firstReportMs;
+    connect["totalMs"] = connectTiming.totalMs;
+    connect["failedPhase"] = connectPhases[connectTiming.failedPhase];
+
+    JsonObject liveness = doc["liveness"].to<JsonObject>();
+    serializeLiveness(printerLiveness, liveness);
+
+    JsonObject latency = doc["latency"].to<JsonObject>();
+    serializeLatencyTrace(latency);
+
+    JsonObject commands = doc["commands"].to<JsonObject>();
+    serializeCommandQueue(commands);
+
+    JsonObject capture = doc["capture"].to<JsonObject>();
+    serializeReportCapture(capture);
+
+    JsonObject cache = doc["stateCache"].to<JsonObject>();
+    cache["complete"] = isStateComplete();
+    cache["bootstrapping"] = isStateBootstrapping();
+    cache["bootstraps"] = stateCache.bootstraps;
+    cache["bootstrapTimeouts"] = stateCache.bootstrapTimeouts;
+    cache["lastBootstrapMs"] = stateCache.lastBootstrapMs;
+    cache["maxBootstrapMs"] = stateCache.maxBootstrapMs;
+    JsonObject ages = cache["fieldAgeMs"].to<JsonObject>();
+    ages["gcode_state"] = stateFieldAgeMs(FIELD_GCODE_STATE);
+    ages["stg_cur"] = stateFieldAgeMs(FIELD_STAGE);
+    ages["mc_percent"] = stateFieldAgeMs(FIELD_PROGRESS);
+    ages["home_flag"] = stateFieldAgeMs(FIELD_HOME_FLAG);
+    ages["hms"] = stateFieldAgeMs(FIELD_HMS);
+    ages["chamber_light"] = stateFieldAgeMs(FIELD_CHAMBER_LIGHT);
+
+    JsonArray printers = doc["printers"].to<JsonArray>();
+    printerSessionStats(printers);
+
+    JsonObject relay = doc["relay"].to<JsonObject>();
+    relay["mqttEnabled"] = printerConfig.reportRelayMqtt;
+    relay["reports"] = relayStats.reports;
+    relay["wsSent"] = relayStats.wsSent;
+    relay["wsDropped"] = relayStats.wsDropped;
+    relay["mqttSent"] = relayStats.mqttSent;
+    relay["mqttDropped"] = relayStats.mqttDropped;
+    relay["mqttRejected"] = relayStats.mqttRejected;
+    JsonArray subscribers = relay["subscribers"].to<JsonArray>();
+    relaySubscriberStats(subscribers);
+
+    JsonObject status = doc["statusChannel"].to<JsonObject>();
+    serializeStatusChannel(status);
+
+    JsonObject preview = doc["preview"].to<JsonObject>();
+    serializeLedPreview(preview);
+
+    String json;
+    serializeJson(doc, json);
+    request->send(200, "application/json", json);
 }
 
 // Printer and Auth setup pages (available for all builds)
@@ -566,6 +692,44 @@ void handleSubmitPrinter(AsyncWebServerRequest *request)
     restartRequestTime = millis();
 }
 
+void handleSubmitExtraPrinters(AsyncWebServerRequest *request)
+{
+    if (!isAuthorized(request))
+    {
+        return request->requestAuthentication();
+    }
+
+    // The printer sessions read printerConfig.extraPrinters while they run,
+    // so the new list is only written to the config file and takes effect
+    // with the restart below
+    ExtraPrinter extraPrinters[MAX_EXTRA_PRINTERS];
+    for (uint8_t i = 0; i < MAX_EXTRA_PRINTERS; i++)
+    {
+        ExtraPrinter &extra = extraPrinters[i];
+        String prefix = "p" + String(i) + "_";
+
+        String printerIP = getSafeParamValue(request, (prefix + "printerIP").c_str());
+        String printerSerial = getSafeParamValue(request, (prefix + "printerSerial").c_str());
+        String accessCode = getSafeParamValue(request, (prefix + "accessCode").c_str());
+        printerIP.trim();
+        printerSerial.trim();
+        accessCode.trim();
+
+        strlcpy(extra.printerIP, printerIP.c_str(), sizeof(extra.printerIP));
+        strlcpy(extra.serialNumber, printerSerial.c_str(), sizeof(extra.serialNumber));
+        strlcpy(extra.accessCode, accessCode.c_str(), sizeof(extra.accessCode));
+        extra.ledStart = constrain(getSafeParamInt(request, (prefix + "ledStart").c_str()), 0, (int)MAX_LEDS - 1);
+        extra.ledCount = constrain(getSafeParamInt(request, (prefix + "ledCount").c_str()), 0, (int)MAX_LEDS);
+    }
+
+    LogSerial.println(F("[PrinterSetup] Additional printers updated"));
+    saveFileSystem(extraPrinters);
+
+    request->send(200, "text/plain", "Printer settings saved, restarting...");
+    shouldRestart = true;
+    restartRequestTime = millis();
+}
+
 void handleSubmitAuth(AsyncWebServerRequest *request)
 {
     if (!isAuthorized(request))
@@ -605,6 +769,22 @@ void handleSubmitDebug(AsyncWebServerRequest *request)
     request->send(200, "text/plain", "Debug settings saved");
 }
 
+void handleSubmitRelay(AsyncWebServerRequest *request)
+{
+    if (!isAuthorized(request))
+    {
+        return request->requestAuthentication();
+    }
+
+    printerConfig.reportRelayMqtt = request->hasParam("reportRelayMqtt", true) && request->getParam("reportRelayMqtt", true)->value() == "true";
+    setRelayMqttEnabled(printerConfig.reportRelayMqtt);
+
+    LogSerial.println(F("[Advanced] Report relay settings updated"));
+    saveFileSystem();
+
+    request->send(200, "text/plain", "Relay settings saved");
+}
+
 void handleSubmitHostname(AsyncWebServerRequest *request)
 {
     if (!isAuthorized(request))
@@ -640,36 +820,6 @@ void handleSubmitHostname(AsyncWebServerRequest *request)
     request->send(200, "text/plain", "Hostname saved. Reboot to apply.");
 }
 
-void websocketLoop()
-{
-    if (ws.count() == 0)
-        return;
-    if (millis() - lastWsPush > wsPushInterval)
-    {
-        lastWsPush = millis();
-
-        JsonDocument doc;
-#ifdef USE_ETHERNET
-        doc["network_type"] = "ethernet";
-        doc["link_speed"] = ETH.linkSpeed();
-        doc["ip"] = ETH.localIP().toString();
-#else
-        doc["network_type"] = "wifi";
-        doc["wifi_rssi"] = WiFi.RSSI();
-        doc["ip"] = WiFi.localIP().toString();
-#endif
-        doc["uptime"] = millis() / 1000;
-        doc["doorOpen"] = printerVariables.doorOpen;
-        doc["printerConnection"] = printerVariables.online;
-        doc["clients"] = ws.count();
-        doc["stg_cur"] = printerVariables.stage;
-        doc["gcodeState"] = printerVariables.gcodeState;
-        doc["ledReason"] = printerVariables.ledReason;
-        doc["printProgress"] = printerVariables.printProgress;
-        sendJsonToAll(doc);
-    }
-}
-
 void handleConfigPage(AsyncWebServerRequest *request)
 {
     if (!isAuthorized(request))
@@ -717,6 +867,81 @@ void handleDownloadConfigFile(AsyncWebServerRequest *request)
     request->send(response);
 }
 
+void handleDownloadHMSCatalogue(AsyncWebServerRequest *request)
+{
+    if (!isAuthorized(request))
+    {
+        return request->requestAuthentication();
+    }
+
+    JsonDocument doc;
+    serializeHMSCatalogue(doc);
+
+    String jsonString;
+    serializeJsonPretty(doc, jsonString);
+
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", jsonString);
+    response->addHeader("Content-Disposition", "attachment; filename=\"hmscatalogue.json\"");
+    request->send(response);
+}
+
+void handleUploadHMSCatalogue(AsyncWebServerRequest *request)
+{
+    if (!isAuthorized(request))
+    {
+        return request->requestAuthentication();
+    }
+
+    if (!LittleFS.exists(hmsCatalogueUploadPath))
+    {
+        request->send(500, "text/plain", "HMS catalogue upload failed");
+        return;
+    }
+
+    // The upload is only kept if it loads, the active catalogue and its file
+    // stay as they are otherwise
+    int loaded = loadHMSCatalogue(hmsCatalogueUploadPath);
+    if (loaded < 0)
+    {
+        LittleFS.remove(hmsCatalogueUploadPath);
+        request->send(400, "text/plain", "Invalid HMS catalogue file");
+        return;
+    }
+    stream.forgetReport();
+    if (!LittleFS.rename(hmsCatalogueUploadPath, hmsCataloguePath))
+    {
+        LittleFS.remove(hmsCatalogueUploadPath);
+        request->send(500, "text/plain", "HMS catalogue loaded but could not be saved");
+        return;
+    }
+
+    request->send(200, "text/plain", "HMS catalogue loaded: " + String(loaded) + " entries");
+}
+
+void handleUploadHMSCatalogueData(AsyncWebServerRequest *request, const String &filename,
+                                  size_t index, uint8_t *data, size_t len, bool final)
+{
+    static File uploadFile;
+
+    if (!isAuthorized(request))
+        return;
+
+    if (!index)
+    {
+        LogSerial.println(F("[HMS] Catalogue upload start"));
+        uploadFile = LittleFS.open(hmsCatalogueUploadPath, "w");
+    }
+    if (uploadFile)
+    {
+        uploadFile.write(data, len);
+    }
+    if (final)
+    {
+        uploadFile.close();
+        LogSerial.println(F("[HMS] Catalogue upload finished"));
+    }
+}
+
 void handleWebSerialPage(AsyncWebServerRequest *request)
 {
     if (!isAuthorized(request))
@@ -793,32 +1018,6 @@ void handleUploadConfigFileData(AsyncWebServerRequest *request, const String &fi
     restartRequestTime = millis();
 }
 
-void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
-               void *arg, uint8_t *data, size_t len)
-{
-    switch (type)
-    {
-    case WS_EVT_CONNECT:
-        LogSerial.printf("[WS] Client connected: %u\n", client->id());
-        websocketLoop();
-        break;
-    case WS_EVT_DISCONNECT:
-        LogSerial.printf("[WS] Client disconnected: %u\n", client->id());
-        ws.cleanupClients();
-        break;
-    case WS_EVT_DATA:
-        LogSerial.printf("[WS] Data received from client %u\n", client->id());
-        break;
-    case WS_EVT_PONG:
-        LogSerial.printf("[WS] Pong received from %u\n", client->id());
-        break;
-    case WS_EVT_ERROR:
-        LogSerial.printf("[WS] Error on connection %u\n", client->id());
-        ws.cleanupClients();
-        break;
-    }
-}
-
 void setupWebserver()
 {
     if (!MDNS.begin(globalVariables.hostname))
@@ -861,9 +1060,11 @@ void setupWebserver()
     webServer.on("/debug", HTTP_GET, handleDebugSetupPage);
     webServer.on("/advanced", HTTP_GET, handleAdvancedSetupPage);
     webServer.on("/submitPrinter", HTTP_POST, handleSubmitPrinter);
+    webServer.on("/submitExtraPrinters", HTTP_POST, handleSubmitExtraPrinters);
     webServer.on("/submitAuth", HTTP_POST, handleSubmitAuth);
     webServer.on("/submitDebug", HTTP_POST, handleSubmitDebug);
     webServer.on("/submitHostname", HTTP_POST, handleSubmitHostname);
+    webServer.on("/submitRelay", HTTP_POST, handleSubmitRelay);
 
 #ifdef USE_ETHERNET
     // Ethernet mode - redirect /wifi to /printer (no WiFi configuration)
@@ -878,11 +1079,14 @@ void setupWebserver()
     webServer.on("/style.css", HTTP_GET, handleStyleCss);
     webServer.on("/backuprestore", HTTP_GET, handleConfigPage);
     webServer.on("/configfile.json", HTTP_GET, handleDownloadConfigFile);
+    webServer.on("/hmscatalogue.json", HTTP_GET, handleDownloadHMSCatalogue);
+    webServer.on("/hmscatalogue", HTTP_POST, handleUploadHMSCatalogue, handleUploadHMSCatalogueData);
     webServer.on("/webserial", HTTP_GET, handleWebSerialPage);
     webServer.on("/printerList", HTTP_GET, handlePrinterList);
     webServer.on("/factoryreset", HTTP_GET, handleFactoryReset);
     webServer.on("/reboot", HTTP_GET, handleReboot);
     webServer.on("/api/ledtest", HTTP_POST, handleLedTest);
+    webServer.on("/api/metrics", HTTP_GET, handleMetrics);
     webServer.on("/configrestore", HTTP_POST, [](AsyncWebServerRequest *request)
                  {
         if (!isAuthorized(request)) {
@@ -934,8 +1138,10 @@ void setupWebserver()
 
     LogSerial.begin(&webServer);
 
-    ws.onEvent(onWsEvent);
-    webServer.addHandler(&ws);
+    setupStatusChannel(webServer);
+    setupLedPreview(webServer);
+    setupReportRelay(webServer);
+    setupReportCapture(webServer);
 
     webServer.begin();
 
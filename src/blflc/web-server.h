@@ -6,11 +6,6 @@
 
 // Web server instance
 extern AsyncWebServer webServer;
-extern AsyncWebSocket ws;
-
-// WebSocket timing
-extern unsigned long lastWsPush;
-extern const unsigned long wsPushInterval;
 
 // Authorization check
 bool isAuthorized(AsyncWebServerRequest *request);
@@ -26,6 +21,7 @@ void handlePrinterConfigJson(AsyncWebServerRequest *request);
 void handleStyleCss(AsyncWebServerRequest *request);
 void handleSubmitConfig(AsyncWebServerRequest *request);
 void handleLedTest(AsyncWebServerRequest *request);
+void handleMetrics(AsyncWebServerRequest *request);
 #ifdef USE_ETHERNET
 void handlePrinterSetupPage(AsyncWebServerRequest *request);
 #else
@@ -35,18 +31,16 @@ void handleWiFiSetupPage(AsyncWebServerRequest *request);
 void handleSubmitWiFi(AsyncWebServerRequest *request);
 void handleConfigPage(AsyncWebServerRequest *request);
 void handleDownloadConfigFile(AsyncWebServerRequest *request);
+void handleDownloadHMSCatalogue(AsyncWebServerRequest *request);
+void handleUploadHMSCatalogue(AsyncWebServerRequest *request);
+void handleUploadHMSCatalogueData(AsyncWebServerRequest *request, const String &filename,
+                                  size_t index, uint8_t *data, size_t len, bool final);
 void handleWebSerialPage(AsyncWebServerRequest *request);
 void handlePrinterList(AsyncWebServerRequest *request);
 void handleFactoryReset(AsyncWebServerRequest *request);
 void handleUploadConfigFileData(AsyncWebServerRequest *request, const String &filename,
                                 size_t index, uint8_t *data, size_t len, bool final);
 
-// WebSocket functions
-void sendJsonToAll(JsonDocument &doc);
-void websocketLoop();
-void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
-               void *arg, uint8_t *data, size_t len);
-
 // Setup function
 void setupWebserver();
 
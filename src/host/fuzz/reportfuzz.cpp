@@ -0,0 +1,446 @@
+// Fuzz target for the report ingest path of the MQTT task: bytes go through
+// ReportStream (ReportParser) with the AutoGrowBufferStream tap attached, and
+// the parsed ReportDelta is handed to the code that consumes it (HMS rules,
+// state cache). Each input is checked for
+//   - crashes and undefined behaviour (build with ASan / UBSan),
+//   - broken invariants (delta bounds, tap contents at the buffer limit,
+//     identical bytes giving an identical, duplicate report),
+//   - slow inputs: parsing must stay within a per-input time budget.
+//
+// libFuzzer (clang):
+//   clang++ -DBLFLC_LIBFUZZER -fsanitize=fuzzer,address,undefined ...
+//   ./reportfuzz -dict=src/host/fuzz/report.dict -max_len=70000 corpus/ src/host/fuzz/corpus
+// Without libFuzzer (pio run -e native_fuzz, g++) the built-in driver below
+// replays the corpus and applies random mutations:
+//   .pio/build/native_fuzz/program -runs=200000 -dict=src/host/fuzz/report.dict src/host/fuzz/corpus
+
+#include <Arduino.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "../../blflc/types.h"
+#include "../../blflc/logserial.h"
+#include "../../blflc/reportparser.h"
+#include "../../blflc/statecache.h"
+#include "../../blflc/autogrowbufferstream.h"
+#include "../../blflc/mqttparsingutility.h"
+
+#if defined(__SANITIZE_ADDRESS__)
+#define FUZZ_HAS_SANITIZER 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define FUZZ_HAS_SANITIZER 1
+#endif
+#endif
+#ifdef FUZZ_HAS_SANITIZER
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+EspClass ESP;
+LogSerialClass LogSerial;
+
+static const auto startTime = std::chrono::steady_clock::now();
+
+unsigned long millis()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void delay(unsigned long) {}
+
+// The firmware logs (buffer overflow, ...) would only slow the fuzzer down
+size_t LogSerialClass::write(uint8_t) { return 1; }
+size_t LogSerialClass::write(const uint8_t *, size_t size) { return size; }
+int LogSerialClass::available() { return 0; }
+int LogSerialClass::read() { return -1; }
+int LogSerialClass::peek() { return -1; }
+void LogSerialClass::flush() {}
+
+// ============================================================================
+// Target
+// ============================================================================
+
+// Time budget per input (both passes). Generous enough for a sanitizer build
+// on a loaded machine; a parser that is linear in the input never gets close.
+static const uint32_t FUZZ_BUDGET_BASE_US = 5000;
+static uint32_t budgetNsPerByte = 2000;    // BLFLC_FUZZ_BUDGET_NS_PER_BYTE
+
+static ReportStream stream;
+static AutoGrowBufferStream rawStream;
+static const uint8_t *currentData = nullptr;
+static size_t currentSize = 0;
+static bool lastParsed = false;
+
+static void saveInput(const char *reason)
+{
+#ifndef BLFLC_LIBFUZZER
+    // libFuzzer writes crash-<sha1> itself
+    char path[32];
+    snprintf(path, sizeof(path), "crash-%s", reason);
+    FILE *out = fopen(path, "wb");
+    if (out != nullptr)
+    {
+        fwrite(currentData, 1, currentSize, out);
+        fclose(out);
+        fprintf(stderr, "Input (%zu bytes) saved to %s\n", currentSize, path);
+    }
+#else
+    (void)reason;
+#endif
+}
+
+static void fail(const char *reason, const char *detail)
+{
+    fprintf(stderr, "==reportfuzz== %s: %s\n", reason, detail);
+    saveInput(reason);
+    abort();
+}
+
+static void checkString(const char *value, size_t size, const char *name)
+{
+    if (memchr(value, '\0', size) == nullptr)
+        fail("invariant", name);
+}
+
+static void checkDelta(const ReportDelta &report)
+{
+    if (report.present >> FIELD_COUNT)
+        fail("invariant", "unknown field flagged as present");
+    if (report.hmsCount > REPORT_MAX_HMS)
+        fail("invariant", "hmsCount");
+    if (report.trayCount > REPORT_MAX_TRAYS)
+        fail("invariant", "trayCount");
+    checkString(report.command, sizeof(report.command), "command");
+    checkString(report.gcodeState, sizeof(report.gcodeState), "gcodeState");
+    checkString(report.systemCommand, sizeof(report.systemCommand), "systemCommand");
+}
+
+// The parse* helpers in mqttmanager.cpp need the whole firmware; this runs the
+// shared pieces they call on the same delta
+static void consumeReport(const ReportDelta &report)
+{
+    for (uint8_t i = 0; i < report.hmsCount; i++)
+    {
+        uint64_t code = ((uint64_t)report.hms[i].attr << 32) + report.hms[i].code;
+        char text[24];
+        formatHMSCode(code, text, sizeof(text));
+        if (strlen(text) != 23)
+            fail("invariant", "formatHMSCode");
+        if (isHMSCodeIgnored(code))
+            continue;
+        hmsSeverityName(ParseHMSSeverity(report.hms[i].code));
+    }
+
+    uint64_t code, mask;
+    parseHMSCodeString(report.gcodeState, strlen(report.gcodeState), code, mask);
+    mergeStateReport(report);
+}
+
+// The tap keeps the raw report for the debug log, relay and capture. Reports
+// up to MAX_BUFFER_SIZE - 1 bytes are kept whole, longer ones are truncated
+// there and flagged.
+static void checkTap(const uint8_t *data, size_t size)
+{
+    uint32_t kept = rawStream.current_length();
+    if (size < MAX_BUFFER_SIZE)
+    {
+        if (rawStream.overflowed() || kept != size || memcmp(rawStream.get_buffer(), data, size) != 0)
+            fail("invariant", "tap lost report bytes");
+    }
+    else if (!rawStream.overflowed() || kept != MAX_BUFFER_SIZE - 1)
+    {
+        fail("invariant", "tap overflow");
+    }
+    if (rawStream.capacity() > MAX_BUFFER_SIZE || rawStream.get_string()[kept] != '\0')
+        fail("invariant", "tap terminator");
+}
+
+// One report as mqttCallback() handles it; returns true if it parsed
+static bool ingest(const uint8_t *data, size_t size)
+{
+    stream.setTap(&rawStream);
+    stream.write(data, size);
+    checkTap(data, size);
+
+    bool parsed = stream.endMessage();
+    if (parsed)
+    {
+        const ReportDelta &report = stream.report();
+        checkDelta(report);
+        if (!stream.isDuplicate())
+        {
+            consumeReport(report);
+            stream.acceptReport();
+        }
+    }
+    stream.reset();
+    return parsed;
+}
+
+extern "C" int LLVMFuzzerInitialize(int *, char ***)
+{
+    const char *budget = getenv("BLFLC_FUZZ_BUDGET_NS_PER_BYTE");
+    if (budget != nullptr && atoi(budget) > 0)
+        budgetNsPerByte = atoi(budget);
+    compileHMSIgnoreList("HMS_0300_0100_0001_0007,HMS_0500_0200_0002_0001");
+    beginStateBootstrap();
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    currentData = data;
+    currentSize = size;
+    auto start = std::chrono::steady_clock::now();
+
+    // The same bytes twice: the result must not depend on the previous
+    // report, and an accepted report must be detected as a duplicate
+    stream.forgetReport();
+    bool parsed = ingest(data, size);
+    uint32_t duplicatesBefore = stream.duplicate_count();
+    if (ingest(data, size) != parsed)
+        fail("invariant", "same input parsed differently");
+    if (parsed && stream.duplicate_count() != duplicatesBefore + 1)
+        fail("invariant", "same input not detected as duplicate");
+    lastParsed = parsed;
+
+    uint64_t budgetUs = FUZZ_BUDGET_BASE_US + (uint64_t)size * 2 * budgetNsPerByte / 1000;
+    uint64_t elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    if (elapsedUs > budgetUs)
+    {
+        // Timed again before it counts, a preempted run is not a slow input
+        start = std::chrono::steady_clock::now();
+        ingest(data, size);
+        ingest(data, size);
+        elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (elapsedUs > budgetUs)
+    {
+        char detail[64];
+        snprintf(detail, sizeof(detail), "%zu bytes took %llu us", size, (unsigned long long)elapsedUs);
+        fail("slow", detail);
+    }
+    return 0;
+}
+
+// ============================================================================
+// Standalone driver (no libFuzzer)
+// ============================================================================
+
+#ifndef BLFLC_LIBFUZZER
+
+static std::vector<std::string> corpus;
+static std::vector<std::string> dictionary;
+static const size_t MAX_KEPT_INPUT = 16384;
+
+static bool readFile(const std::string &path, std::string &data)
+{
+    FILE *in = fopen(path.c_str(), "rb");
+    if (in == nullptr)
+        return false;
+    char buffer[4096];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        data.append(buffer, got);
+    fclose(in);
+    return true;
+}
+
+static void addCorpus(const std::string &path)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+    {
+        perror(path.c_str());
+        return;
+    }
+    if (S_ISDIR(info.st_mode))
+    {
+        DIR *dir = opendir(path.c_str());
+        if (dir == nullptr)
+            return;
+        while (dirent *entry = readdir(dir))
+        {
+            if (entry->d_name[0] != '.')
+                addCorpus(path + "/" + entry->d_name);
+        }
+        closedir(dir);
+        return;
+    }
+    std::string data;
+    if (readFile(path, data))
+        corpus.push_back(data);
+}
+
+// libFuzzer dictionary format: one "quoted" token per line, \\ \" and \xNN escapes
+static void loadDictionary(const char *path)
+{
+    std::string data;
+    if (!readFile(path, data))
+    {
+        perror(path);
+        return;
+    }
+    size_t start = 0;
+    while (start < data.size())
+    {
+        size_t end = data.find('\n', start);
+        if (end == std::string::npos)
+            end = data.size();
+        size_t open = data.find('"', start);
+        size_t close = data.rfind('"', end - 1);
+        if (data[start] != '#' && open < end && close > open)
+        {
+            std::string token;
+            for (size_t i = open + 1; i < close; i++)
+            {
+                if (data[i] == '\\' && i + 1 < close && data[i + 1] == 'x' && i + 3 < close)
+                {
+                    token += (char)strtol(data.substr(i + 2, 2).c_str(), nullptr, 16);
+                    i += 3;
+                }
+                else if (data[i] == '\\' && i + 1 < close)
+                {
+                    token += data[++i];
+                }
+                else
+                {
+                    token += data[i];
+                }
+            }
+            dictionary.push_back(token);
+        }
+        start = end + 1;
+    }
+}
+
+static void mutate(std::string &data, std::mt19937 &rng, size_t maxLen)
+{
+    static const char structural[] = "{}[]:,\"\\-.0123456789eE tfnu";
+    auto pick = [&rng](size_t n) { return n == 0 ? 0 : (size_t)(rng() % n); };
+
+    int count = 1 + pick(4);
+    for (int i = 0; i < count; i++)
+    {
+        size_t pos = pick(data.size() + 1);
+        switch (pick(7))
+        {
+        case 0:
+            if (!data.empty())
+                data[pick(data.size())] ^= (char)(1 << pick(8));
+            break;
+        case 1:
+            if (!data.empty())
+                data[pick(data.size())] = structural[pick(sizeof(structural) - 1)];
+            break;
+        case 2:
+            data.erase(pos, 1 + pick(16));
+            break;
+        case 3:
+            if (!data.empty())
+            {
+                size_t from = pick(data.size());
+                data.insert(pos, data.substr(from, 1 + pick(64)));
+            }
+            break;
+        case 4:
+            if (!dictionary.empty())
+                data.insert(pos, dictionary[pick(dictionary.size())]);
+            break;
+        case 5:
+        {
+            // Splice with the tail of another corpus entry
+            const std::string &other = corpus[pick(corpus.size())];
+            data.resize(pos);
+            data.append(other, pick(other.size() + 1), std::string::npos);
+            break;
+        }
+        default:
+            // Repeat a chunk to reach the tap buffer limit / nesting depth
+            if (!data.empty())
+            {
+                std::string chunk = data.substr(pick(data.size()), 1 + pick(256));
+                for (size_t n = 1 + pick(512); n > 0 && data.size() < maxLen; n--)
+                    data.insert(pos, chunk);
+            }
+            break;
+        }
+    }
+    if (data.size() > maxLen)
+        data.resize(maxLen);
+}
+
+#ifdef FUZZ_HAS_SANITIZER
+static void onSanitizerDeath()
+{
+    saveInput("sanitizer");
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    unsigned long runs = 100000;
+    unsigned long seed = std::random_device()();
+    size_t maxLen = 70000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "-runs=", 6) == 0)
+            runs = strtoul(argv[i] + 6, nullptr, 10);
+        else if (strncmp(argv[i], "-seed=", 6) == 0)
+            seed = strtoul(argv[i] + 6, nullptr, 10);
+        else if (strncmp(argv[i], "-max_len=", 9) == 0)
+            maxLen = strtoul(argv[i] + 9, nullptr, 10);
+        else if (strncmp(argv[i], "-dict=", 6) == 0)
+            loadDictionary(argv[i] + 6);
+        else if (argv[i][0] == '-')
+            fprintf(stderr, "Ignoring unknown option %s\n", argv[i]);
+        else
+            addCorpus(argv[i]);
+    }
+    if (corpus.empty())
+    {
+        fprintf(stderr, "Usage: %s [-runs=N] [-seed=N] [-max_len=N] [-dict=file] corpus-file-or-dir...\n", argv[0]);
+        return 1;
+    }
+
+#ifdef FUZZ_HAS_SANITIZER
+    __sanitizer_set_death_callback(onSanitizerDeath);
+#endif
+    LLVMFuzzerInitialize(&argc, &argv);
+
+    // Replay the corpus as is first (also how a saved crash is reproduced)
+    for (const std::string &input : corpus)
+        LLVMFuzzerTestOneInput((const uint8_t *)input.data(), input.size());
+    fprintf(stderr, "Replayed %zu inputs, fuzzing %lu runs (seed %lu)\n", corpus.size(), runs, seed);
+
+    std::mt19937 rng(seed);
+    unsigned long parsed = 0;
+    const size_t maxCorpus = corpus.size() + 4096;
+    for (unsigned long run = 1; run <= runs; run++)
+    {
+        std::string input = corpus[rng() % corpus.size()];
+        mutate(input, rng, maxLen);
+        LLVMFuzzerTestOneInput((const uint8_t *)input.data(), input.size());
+        // Mutants that still parse are kept as seeds, so mutations can stack
+        // (large ones would make every later run slow)
+        if (lastParsed)
+        {
+            parsed++;
+            if (corpus.size() < maxCorpus && input.size() <= MAX_KEPT_INPUT)
+                corpus.push_back(input);
+        }
+        if (run % 50000 == 0 || run == runs)
+            fprintf(stderr, "#%lu parsed %lu corpus %zu\n", run, parsed, corpus.size());
+    }
+    return 0;
+}
+
+#endif
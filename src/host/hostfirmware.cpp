@@ -0,0 +1,23 @@
+// Firmware parts the LED logic (leds.cpp), the report parsers
+// (printerstate.cpp) and the HMS catalogue call that do not exist on the host: no chamber light, live preview, latency trace or
+// additional printers, and a printer that is never found dark.
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <LittleFS.h>
+#include <WiFi.h>
+#include "../blflc/leds.h"
+#include "../blflc/liveness.h"
+
+CFastLED FastLED;
+WiFiClass WiFi;
+LittleFSClass LittleFS;
+LivenessTracker printerLiveness;
+
+void controlChamberLight(bool on) {}
+void previewFrame(const CRGB *pixels, uint16_t count, uint8_t brightness) {}
+void renderPrinterSegments(CRGB *leds, uint16_t count) {}
+
+void traceResolved() {}
+void traceFrameRendered() {}
+void traceFrameShown() {}
@@ -0,0 +1,260 @@
+#include "hostmqtt.h"
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static void appendString(std::string &out, const char *s)
+{
+    size_t len = strlen(s);
+    out += (char)(len >> 8);
+    out += (char)(len & 0xFF);
+    out.append(s, len);
+}
+
+HostMqttClient::~HostMqttClient()
+{
+    disconnect();
+}
+
+bool HostMqttClient::connect(const char *host, uint16_t port, const char *user, const char *password,
+                             const char *clientId, uint16_t keepAliveS)
+{
+    disconnect();
+
+    char portText[8];
+    snprintf(portText, sizeof(portText), "%u", port);
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *result = nullptr;
+    if (getaddrinfo(host, portText, &hints, &result) != 0)
+    {
+        fprintf(stderr, "[MQTT] Cannot resolve %s\n", host);
+        return false;
+    }
+    for (addrinfo *ai = result; ai != nullptr && _fd < 0; ai = ai->ai_next)
+    {
+        _fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (_fd >= 0 && ::connect(_fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            close(_fd);
+            _fd = -1;
+        }
+    }
+    freeaddrinfo(result);
+    if (_fd < 0)
+    {
+        fprintf(stderr, "[MQTT] TCP connect to %s:%u failed\n", host, port);
+        return false;
+    }
+
+    _ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_verify(_ctx, SSL_VERIFY_NONE, nullptr);
+    _ssl = SSL_new(_ctx);
+    SSL_set_fd(_ssl, _fd);
+    SSL_set_tlsext_host_name(_ssl, host);
+    if (SSL_connect(_ssl) != 1)
+    {
+        fprintf(stderr, "[MQTT] TLS handshake with %s failed\n", host);
+        disconnect();
+        return false;
+    }
+
+    _keepAliveS = keepAliveS;
+    std::string body;
+    appendString(body, "MQTT");
+    body += (char)4;                        // Protocol level 3.1.1
+    body += (char)(0x02 | 0x80 | 0x40);     // Clean session, user name, password
+    body += (char)(keepAliveS >> 8);
+    body += (char)(keepAliveS & 0xFF);
+    appendString(body, clientId);
+    appendString(body, user);
+    appendString(body, password);
+    uint8_t connack[4];
+    if (!sendPacket(0x10, body) || !readAll(connack, sizeof(connack)) || connack[0] != 0x20)
+    {
+        fprintf(stderr, "[MQTT] No CONNACK\n");
+        disconnect();
+        return false;
+    }
+    if (connack[3] != 0)
+    {
+        fprintf(stderr, "[MQTT] Connection refused (%u)%s\n", connack[3],
+                connack[3] == 4 || connack[3] == 5 ? ", check the access code" : "");
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+bool HostMqttClient::subscribe(const char *topic)
+{
+    std::string body;
+    _packetId++;
+    body += (char)(_packetId >> 8);
+    body += (char)(_packetId & 0xFF);
+    appendString(body, topic);
+    body += (char)0;                        // QoS 0
+    return sendPacket(0x82, body);
+}
+
+bool HostMqttClient::publish(const char *topic, const char *payload)
+{
+    std::string body;
+    appendString(body, topic);
+    body += payload;
+    return sendPacket(0x30, body);
+}
+
+void HostMqttClient::disconnect()
+{
+    if (_ssl != nullptr)
+    {
+        SSL_shutdown(_ssl);
+        SSL_free(_ssl);
+        _ssl = nullptr;
+    }
+    if (_ctx != nullptr)
+    {
+        SSL_CTX_free(_ctx);
+        _ctx = nullptr;
+    }
+    if (_fd >= 0)
+    {
+        close(_fd);
+        _fd = -1;
+    }
+}
+
+int HostMqttClient::poll(Stream &sink, int timeoutMs)
+{
+    if (_ssl == nullptr)
+        return -1;
+
+    if (_keepAliveS != 0 && millis() - _lastTxMs >= _keepAliveS * 1000UL / 2)
+    {
+        if (!sendPacket(0xC0, std::string()))
+            return -1;
+    }
+
+    if (SSL_pending(_ssl) == 0)
+    {
+        pollfd pfd = {_fd, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, timeoutMs);
+        if (ready == 0)
+            return 0;
+        if (ready < 0)
+            return -1;
+    }
+
+    uint8_t header;
+    uint32_t remaining;
+    if (!readAll(&header, 1) || !readRemainingLength(remaining))
+    {
+        disconnect();
+        return -1;
+    }
+
+    if ((header & 0xF0) != 0x30)
+    {
+        // CONNACK / SUBACK / PINGRESP: nothing to do
+        uint8_t discard[64];
+        while (remaining > 0)
+        {
+            uint32_t chunk = min<uint32_t>(remaining, sizeof(discard));
+            if (!readAll(discard, chunk))
+            {
+                disconnect();
+                return -1;
+            }
+            remaining -= chunk;
+        }
+        return 0;
+    }
+
+    // PUBLISH: skip the topic (and packet id for QoS > 0), stream the payload
+    uint8_t topicLength[2];
+    if (remaining < 2 || !readAll(topicLength, 2))
+    {
+        disconnect();
+        return -1;
+    }
+    uint32_t skip = ((uint32_t)topicLength[0] << 8 | topicLength[1]) + ((header & 0x06) ? 2 : 0);
+    remaining -= 2;
+    uint8_t buffer[4096];
+    while (remaining > 0)
+    {
+        uint32_t chunk = min<uint32_t>(remaining, sizeof(buffer));
+        if (!readAll(buffer, chunk))
+        {
+            disconnect();
+            return -1;
+        }
+        remaining -= chunk;
+        uint32_t offset = min(skip, chunk);
+        skip -= offset;
+        if (offset < chunk)
+            sink.write(buffer + offset, chunk - offset);
+    }
+    return 1;
+}
+
+bool HostMqttClient::writeAll(const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        int written = SSL_write(_ssl, data, (int)len);
+        if (written <= 0)
+            return false;
+        data += written;
+        len -= written;
+    }
+    _lastTxMs = millis();
+    return true;
+}
+
+bool HostMqttClient::readAll(uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        int got = SSL_read(_ssl, data, (int)len);
+        if (got <= 0)
+            return false;
+        data += got;
+        len -= got;
+    }
+    return true;
+}
+
+bool HostMqttClient::readRemainingLength(uint32_t &length)
+{
+    length = 0;
+    for (uint8_t shift = 0; shift < 28; shift += 7)
+    {
+        uint8_t byte;
+        if (!readAll(&byte, 1))
+            return false;
+        length |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool HostMqttClient::sendPacket(uint8_t header, const std::string &body)
+{
+    if (_ssl == nullptr)
+        return false;
+    std::string packet;
+    packet += (char)header;
+    size_t length = body.size();
+    do
+    {
+        uint8_t byte = length & 0x7F;
+        length >>= 7;
+        packet += (char)(length > 0 ? byte | 0x80 : byte);
+    } while (length > 0);
+    packet += body;
+    return writeAll((const uint8_t *)packet.data(), packet.size());
+}
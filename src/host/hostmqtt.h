@@ -0,0 +1,43 @@
+#ifndef _HOSTMQTT
+#define _HOSTMQTT
+
+#include <Arduino.h>
+#include <openssl/ssl.h>
+
+// Minimal MQTT 3.1.1 client over OpenSSL for the virtual controller. Like
+// PubSubClient with setStream(), PUBLISH payloads are streamed into a
+// Stream (the ReportStream) while they are read off the socket, never
+// buffered whole. QoS 0 only; the certificate is not checked (printers use a
+// self-signed one, the firmware uses setInsecure()).
+class HostMqttClient
+{
+public:
+    ~HostMqttClient();
+
+    bool connect(const char *host, uint16_t port, const char *user, const char *password,
+                 const char *clientId, uint16_t keepAliveS);
+    bool subscribe(const char *topic);
+    bool publish(const char *topic, const char *payload);
+    void disconnect();
+    bool connected() const { return _ssl != nullptr; }
+
+    // Waits up to timeoutMs for a packet. A PUBLISH payload is written to
+    // sink; returns 1 once a PUBLISH has been read completely, 0 if nothing
+    // (or another packet type) arrived, -1 if the connection was lost.
+    int poll(Stream &sink, int timeoutMs);
+
+private:
+    SSL_CTX *_ctx = nullptr;
+    SSL *_ssl = nullptr;
+    int _fd = -1;
+    uint16_t _keepAliveS = 0;
+    unsigned long _lastTxMs = 0;
+    uint16_t _packetId = 0;
+
+    bool writeAll(const uint8_t *data, size_t len);
+    bool readAll(uint8_t *data, size_t len);
+    bool readRemainingLength(uint32_t &length);
+    bool sendPacket(uint8_t header, const std::string &body);
+};
+
+#endif
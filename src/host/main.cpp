@@ -0,0 +1,784 @@
+// Virtual controller: the firmware's report parser, state cache, report
+// parsers (printerstate.cpp), LED state rules (leds.cpp), HMS rules and LED
+// patterns built for Linux (pio run -e native). Reports come from a printer
+// or a local TLS broker, or from a capture file, and the LED frame is drawn in
+// the terminal and/or written to a PPM image (one row per frame).
+//
+// The firmware parts without a host counterpart (LED hardware, chamber light
+// commands, live preview) are stubbed in hostfirmware.cpp. The unit tests in
+// test/ (pio test -e native) link the same sources and bring their own main(),
+// so they build this file without the command line program.
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <FastLED.h>
+#include <chrono>
+#include <signal.h>
+#include <thread>
+#include <vector>
+#include "hostmqtt.h"
+#include "../blflc/types.h"
+#include "../blflc/logserial.h"
+#include "../blflc/reportparser.h"
+#include "../blflc/statecache.h"
+#include "../blflc/printerstate.h"
+#include "../blflc/statefilter.h"
+#include "../blflc/leds.h"
+#include "../blflc/patterns.h"
+#include "../blflc/mqttparsingutility.h"
+
+EspClass ESP;
+LogSerialClass LogSerial;
+ReportStream stream;
+
+#ifdef PIO_UNIT_TESTING
+// Unit tests run on a clock they set, so patterns render at fixed timestamps
+static unsigned long testMillis = 0;
+
+void setTestMillis(unsigned long ms)
+{
+    testMillis = ms;
+}
+
+unsigned long millis()
+{
+    return testMillis;
+}
+
+unsigned long micros()
+{
+    return testMillis * 1000;
+}
+
+void delay(unsigned long ms)
+{
+    testMillis += ms;
+}
+#else
+static const auto startTime = std::chrono::steady_clock::now();
+
+unsigned long millis()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+#endif
+
+// The benchmark keeps the log formatting but not the terminal output
+static bool logMuted = false;
+
+size_t LogSerialClass::write(uint8_t b)
+{
+    if (logMuted)
+        return 1;
+    return fputc(b, stderr) == EOF ? 0 : 1;
+}
+
+size_t LogSerialClass::write(const uint8_t *buffer, size_t size)
+{
+    if (logMuted)
+        return size;
+    return fwrite(buffer, 1, size, stderr);
+}
+
+int LogSerialClass::available() { return 0; }
+int LogSerialClass::read() { return -1; }
+int LogSerialClass::peek() { return -1; }
+void LogSerialClass::flush() { fflush(stderr); }
+
+// The unit tests only need the clock and the log above
+#ifndef PIO_UNIT_TESTING
+
+// ============================================================================
+// Options
+// ============================================================================
+
+struct HostOptions {
+    const char *broker = nullptr;
+    uint16_t port = 8883;
+    const char *serial = "0000";
+    const char *accessCode = "bblp";
+    const char *replay = nullptr;
+    bool realtime = false;          // Replay with the recorded timing
+    uint32_t loops = 1;             // Replay the capture this many times (profiling)
+    uint16_t ledCount = 30;
+    uint16_t fps = 30;
+    const char *ppm = nullptr;
+    bool terminal = true;
+    uint8_t pattern = PATTERN_SOLID;
+    bool bench = false;
+    double maxNsPerPixel = 0;       // Benchmark limits, 0 = not checked
+    double maxNsPerResolve = 0;
+};
+
+static HostOptions options;
+static volatile bool stopRequested = false;
+
+static void usage()
+{
+    fprintf(stderr,
+            "Usage: blflc-host --broker <ip> [--port 8883] --serial <sn> --access-code <code>\n"
+            "       blflc-host --replay <capture.bin|reports.jsonl> [--realtime] [--loops N]\n"
+            "       blflc-host --bench [--max-ns-per-pixel X] [--max-ns-per-resolve Y]\n"
+            "Options: --leds N (30)  --fps N (30)  --pattern 0-6 (printing pattern)\n"
+            "         --ppm <file> (one image row per frame)  --quiet (no terminal output)\n");
+}
+
+static bool parseOptions(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--realtime") == 0)
+        {
+            options.realtime = true;
+            continue;
+        }
+        if (strcmp(arg, "--quiet") == 0)
+        {
+            options.terminal = false;
+            continue;
+        }
+        if (strcmp(arg, "--bench") == 0)
+        {
+            options.bench = true;
+            continue;
+        }
+
+        // All other options take a value
+        if (i + 1 >= argc)
+            return false;
+        const char *value = argv[++i];
+        int number = atoi(value);
+        if (strcmp(arg, "--broker") == 0)
+            options.broker = value;
+        else if (strcmp(arg, "--port") == 0)
+            options.port = (uint16_t)number;
+        else if (strcmp(arg, "--serial") == 0)
+            options.serial = value;
+        else if (strcmp(arg, "--access-code") == 0)
+            options.accessCode = value;
+        else if (strcmp(arg, "--replay") == 0)
+            options.replay = value;
+        else if (strcmp(arg, "--loops") == 0)
+            options.loops = max(1, number);
+        else if (strcmp(arg, "--leds") == 0)
+            options.ledCount = (uint16_t)constrain(number, 1, 1000);
+        else if (strcmp(arg, "--fps") == 0)
+            options.fps = (uint16_t)constrain(number, 1, 1000);
+        else if (strcmp(arg, "--pattern") == 0)
+            options.pattern = (uint8_t)constrain(number, 0, (int)PATTERN_LAYER_PULSE);
+        else if (strcmp(arg, "--ppm") == 0)
+            options.ppm = value;
+        else if (strcmp(arg, "--max-ns-per-pixel") == 0)
+            options.maxNsPerPixel = atof(value);
+        else if (strcmp(arg, "--max-ns-per-resolve") == 0)
+            options.maxNsPerResolve = atof(value);
+        else
+            return false;
+    }
+    return options.broker != nullptr || options.replay != nullptr || options.bench;
+}
+
+// Firmware defaults for a new unit (filesystem.cpp)
+static void applyDefaultConfig()
+{
+    printerConfig.runningColor = hex2rgb("#FFFFFF");
+    printerConfig.testColor = hex2rgb("#FFFFFF");
+    printerConfig.finishColor = hex2rgb("#00FF00");
+    printerConfig.stage14Color = hex2rgb("#000000");
+    printerConfig.stage1Color = hex2rgb("#000000");
+    printerConfig.stage8Color = hex2rgb("#000000");
+    printerConfig.stage9Color = hex2rgb("#000000");
+    printerConfig.stage10Color = hex2rgb("#000000");
+    printerConfig.wifiRGB = hex2rgb("#FFFFFF");
+    printerConfig.pauseRGB = hex2rgb("#0000FF");
+    printerConfig.firstlayerRGB = hex2rgb("#0000FF");
+    printerConfig.nozzleclogRGB = hex2rgb("#0000FF");
+    printerConfig.hmsSeriousRGB = hex2rgb("#FF0000");
+    printerConfig.hmsFatalRGB = hex2rgb("#FF0000");
+    printerConfig.filamentRunoutRGB = hex2rgb("#FF0000");
+    printerConfig.frontCoverRGB = hex2rgb("#FF0000");
+    printerConfig.nozzleTempRGB = hex2rgb("#FF0000");
+    printerConfig.bedTempRGB = hex2rgb("#FF0000");
+    printerConfig.progressBarColor = hex2rgb("#FFFFFF");
+    printerConfig.progressBarBackground = hex2rgb("#000000");
+    printerConfig.runningPattern = options.pattern;
+    printerConfig.ledConfig.ledCount = options.ledCount;
+}
+
+// ============================================================================
+// Printer state (the firmware's report parsers and LED state rules)
+// ============================================================================
+
+struct HostStats {
+    uint32_t reports = 0;
+    uint32_t parseErrors = 0;
+    uint32_t duplicates = 0;
+    uint64_t parseUs = 0;           // First byte to parsed (includes the network read when live)
+    uint32_t maxParseUs = 0;
+    uint64_t renderUs = 0;
+    uint32_t frames = 0;
+};
+
+static HostStats stats;
+
+// ParseCallback (mqttmanager.cpp) without the LED command queue, the report
+// relay and the mqttdebug output
+static void applyReport(const ReportDelta &report)
+{
+    mergeStateReport(report);
+    if (report.present & TELEMETRY_FIELDS)
+        applyTelemetry(report);
+
+    if (shouldSkipCommand(report) || (report.present & ~TELEMETRY_FIELDS) == 0)
+        return;
+
+    if (stream.isDuplicate())
+    {
+        stats.duplicates++;
+        if (report.has(FIELD_GCODE_STATE) && (millis() - lastMQTTupdate) > MQTT_STATUS_DEBOUNCE_MS)
+            refreshActiveGcodeState(report.gcodeState);
+        return;
+    }
+
+    bool changed = parseReportFields(report);
+    if ((millis() - lastMQTTupdate) > MQTT_STATUS_DEBOUNCE_MS)
+        stream.acceptReport();
+    else
+        stream.forgetReport();
+
+    if (changed)
+        applyMqttChanges();
+    completeStateBootstrap();
+}
+
+// The report bytes have been written to the stream
+static void finishReport(unsigned long startUs)
+{
+    bool parsed = stream.endMessage();
+    uint32_t elapsed = micros() - startUs;
+    stats.reports++;
+    stats.parseUs += elapsed;
+    stats.maxParseUs = max(stats.maxParseUs, elapsed);
+
+    if (parsed)
+        applyReport(stream.report());
+    else
+        stats.parseErrors++;
+    stream.reset();
+}
+
+// Printer link up or down, as the MQTT task reports it
+static void setOnline(bool online)
+{
+    printerVariables.online = online;
+    printerVariables.disconnectMQTTms = online ? 0 : millis();
+    if (online)
+    {
+        stream.forgetReport();
+        resetStateFilter();
+        beginStateBootstrap();
+    }
+}
+
+// One frame the way ledsloop() draws it, minus the hardware
+static const char *render(CRGB *pixels, uint16_t count)
+{
+    applyHeldTransitions();
+    completeStateBootstrap();
+    checkLedTimers();
+    applyPattern(pixels, count, currentPattern, currentColor, patternState, currentBgColor,
+                 printerVariables.printProgress, &printerTelemetry);
+    return ledReasonName(printerVariables.ledReason);
+}
+
+// ============================================================================
+// Frame sinks
+// ============================================================================
+
+static std::vector<CRGB> frame;
+static std::vector<CRGB> shownFrame;
+static std::vector<uint8_t> ppmRows;
+static const char *shownLabel = "";
+
+static void renderFrame()
+{
+    unsigned long startUs = micros();
+    const char *label = render(frame.data(), options.ledCount);
+    stats.renderUs += micros() - startUs;
+    stats.frames++;
+
+    if (options.ppm != nullptr)
+    {
+        for (const CRGB &led : frame)
+        {
+            ppmRows.push_back(led.r);
+            ppmRows.push_back(led.g);
+            ppmRows.push_back(led.b);
+        }
+    }
+
+    if (options.terminal && (frame != shownFrame || label != shownLabel))
+    {
+        std::string line = "\r";
+        char cell[32];
+        for (const CRGB &led : frame)
+        {
+            snprintf(cell, sizeof(cell), "\x1b[48;2;%u;%u;%um ", led.r, led.g, led.b);
+            line += cell;
+        }
+        snprintf(cell, sizeof(cell), "\x1b[0m %-16s %3u%%", label, printerVariables.printProgress);
+        line += cell;
+        fputs(line.c_str(), stdout);
+        fflush(stdout);
+        shownFrame = frame;
+        shownLabel = label;
+    }
+}
+
+static void writePpm()
+{
+    if (options.ppm == nullptr || stats.frames == 0)
+        return;
+    FILE *out = fopen(options.ppm, "wb");
+    if (out == nullptr)
+    {
+        perror(options.ppm);
+        return;
+    }
+    fprintf(out, "P6\n%u %u\n255\n", options.ledCount, stats.frames);
+    fwrite(ppmRows.data(), 1, ppmRows.size(), out);
+    fclose(out);
+}
+
+static void printStats()
+{
+    if (options.terminal)
+        fputs("\n", stdout);
+    fprintf(stderr, "reports %u, parse errors %u, duplicates %u\n", stats.reports, stats.parseErrors, stats.duplicates);
+    if (stats.reports > 0)
+        fprintf(stderr, "parse avg %.1f us, max %u us\n", (double)stats.parseUs / stats.reports, stats.maxParseUs);
+    if (stats.frames > 0)
+        fprintf(stderr, "render avg %.2f us over %u frames\n", (double)stats.renderUs / stats.frames, stats.frames);
+}
+
+// ============================================================================
+// Report sources
+// ============================================================================
+
+struct CapturedReport {
+    uint32_t offsetUs;      // From the first report
+    std::string payload;
+};
+
+// capture.bin from /capture.bin (see reportcapture.h) or one report per line
+static bool loadCapture(const char *path, std::vector<CapturedReport> &reports)
+{
+    FILE *in = fopen(path, "rb");
+    if (in == nullptr)
+    {
+        perror(path);
+        return false;
+    }
+    std::string data;
+    char buffer[4096];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        data.append(buffer, got);
+    fclose(in);
+
+    if (data.compare(0, 6, "BLFCAP") == 0)
+    {
+        size_t offset = 8;
+        uint32_t firstUs = 0;
+        while (offset + 8 <= data.size())
+        {
+            uint32_t us, length;
+            memcpy(&us, data.data() + offset, 4);
+            memcpy(&length, data.data() + offset + 4, 4);
+            offset += 8;
+            if (offset + length > data.size())
+                break;
+            if (reports.empty())
+                firstUs = us;
+            reports.push_back({us - firstUs, data.substr(offset, length)});
+            offset += length;
+        }
+        return true;
+    }
+
+    size_t start = 0;
+    while (start < data.size())
+    {
+        size_t end = data.find('\n', start);
+        if (end == std::string::npos)
+            end = data.size();
+        if (end > start)
+            reports.push_back({0, data.substr(start, end - start)});
+        start = end + 1;
+    }
+    return true;
+}
+
+static int runReplay()
+{
+    std::vector<CapturedReport> reports;
+    if (!loadCapture(options.replay, reports))
+        return 1;
+    fprintf(stderr, "Replaying %zu reports from %s\n", reports.size(), options.replay);
+
+    setOnline(true);
+    for (uint32_t loop = 0; loop < options.loops && !stopRequested; loop++)
+    {
+        unsigned long loopStartUs = micros();
+        for (const CapturedReport &report : reports)
+        {
+            if (stopRequested)
+                break;
+            if (options.realtime)
+            {
+                unsigned long dueUs = loopStartUs + report.offsetUs;
+                long waitUs = (long)(dueUs - micros());
+                if (waitUs > 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds(waitUs));
+            }
+            unsigned long startUs = micros();
+            stream.write((const uint8_t *)report.payload.data(), report.payload.size());
+            finishReport(startUs);
+            renderFrame();
+        }
+    }
+    return 0;
+}
+
+static int runLive()
+{
+    char clientId[24];
+    snprintf(clientId, sizeof(clientId), "blflc-host-%04x", (unsigned)(micros() & 0xFFFF));
+    char reportTopic[48];
+    char requestTopic[48];
+    snprintf(reportTopic, sizeof(reportTopic), "device/%s/report", options.serial);
+    snprintf(requestTopic, sizeof(requestTopic), "device/%s/request", options.serial);
+
+    HostMqttClient client;
+    unsigned long frameIntervalMs = 1000 / options.fps;
+    unsigned long retryMs = 1000;
+    unsigned long lastFrameMs = 0;
+    while (!stopRequested)
+    {
+        if (!client.connected())
+        {
+            if (!client.connect(options.broker, options.port, "bblp", options.accessCode, clientId, 5) ||
+                !client.subscribe(reportTopic))
+            {
+                delay(retryMs);
+                retryMs = min(retryMs * 2, 60000UL);
+                continue;
+            }
+            retryMs = 1000;
+            setOnline(true);
+            client.publish(requestTopic, "{\"pushing\":{\"sequence_id\":\"0\",\"command\":\"pushall\"}}");
+            fprintf(stderr, "[MQTT] Connected to %s:%u\n", options.broker, options.port);
+        }
+
+        int result = client.poll(stream, (int)frameIntervalMs);
+        if (result > 0)
+        {
+            finishReport(stream.first_byte_us());
+        }
+        else if (result < 0)
+        {
+            stream.reset();
+            setOnline(false);
+            fprintf(stderr, "\n[MQTT] Connection lost\n");
+        }
+
+        if (millis() - lastFrameMs >= frameIntervalMs)
+        {
+            lastFrameMs = millis();
+            renderFrame();
+        }
+    }
+    return 0;
+}
+
+// ============================================================================
+// Benchmark
+// ============================================================================
+
+constexpr uint32_t BENCH_FRAMES = 20000;
+constexpr uint32_t BENCH_RESOLVES = 1400000;
+constexpr size_t BENCH_PARSE_BYTES = 20 * 1024 * 1024;  // Parsed per report size and parser
+
+static const char *const patternNames[] = {"solid", "breathing", "chase", "rainbow", "progress", "heatmap", "layer pulse"};
+
+static double elapsedNs(std::chrono::steady_clock::time_point start)
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A pushall shaped report of at least targetBytes: the status fields of a
+// print in progress, then AMS trays as the printer sends them until the size
+// is reached
+static std::string benchReport(size_t targetBytes)
+{
+    std::string report =
+        "{\"print\":{\"command\":\"push_status\",\"msg\":0,\"sequence_id\":\"412\",\"gcode_state\":\"RUNNING\","
+        "\"stg_cur\":0,\"mc_percent\":37,\"mc_remaining_time\":119,\"layer_num\":70,\"total_layer_num\":500,"
+        "\"nozzle_temper\":219.84,\"nozzle_target_temper\":220,\"bed_temper\":60.5,\"bed_target_temper\":60,"
+        "\"home_flag\":8388608,\"hms\":[{\"attr\":117448704,\"code\":196609}],"
+        "\"gcode_file\":\"/data/Metadata/plate_1.gcode\",\"subtask_name\":\"benchy\","
+        "\"lights_report\":[{\"node\":\"chamber_light\",\"mode\":\"on\"}],\"ams\":{\"ams\":[";
+    char tray[600];
+    for (int i = 0; report.size() < targetBytes; i++)
+    {
+        if (i % 4 == 0)
+        {
+            snprintf(tray, sizeof(tray), "%s{\"id\":\"%d\",\"humidity\":\"4\",\"temp\":\"24.5\",\"tray\":[",
+                     i ? "]}," : "", i / 4);
+            report += tray;
+        }
+        snprintf(tray, sizeof(tray),
+                 "%s{\"id\":\"%d\",\"remain\":16,\"k\":0.02,\"n\":1.0,\"tag_uid\":\"0000000000000000\","
+                 "\"tray_id_name\":\"A00-K0\",\"tray_info_idx\":\"GFA00\",\"tray_type\":\"PLA\","
+                 "\"tray_sub_brands\":\"PLA Basic\",\"tray_color\":\"%02X%02X00FF\",\"tray_weight\":\"1000\","
+                 "\"tray_diameter\":\"1.75\",\"tray_temp\":\"55\",\"tray_time\":\"8\",\"bed_temp_type\":\"1\","
+                 "\"bed_temp\":\"35\",\"nozzle_temp_max\":\"230\",\"nozzle_temp_min\":\"190\","
+                 "\"xcam_info\":\"000000000000000000000000\",\"tray_uuid\":\"00000000000000000000000000000000\","
+                 "\"cols\":[\"FF0000FF\"],\"ctype\":0}",
+                 i % 4 ? "," : "", i % 4, (i * 40) & 0xFF, (i * 90) & 0xFF);
+        report += tray;
+    }
+    report += "]}],\"tray_now\":\"1\"},\"vt_tray\":{\"id\":\"254\",\"tray_color\":\"00FF00FF\"}}}";
+    return report;
+}
+
+// The values ReportParser extracts, read the way the firmware did before it:
+// the report filtered into a JsonDocument, then looked up key by key
+static uint32_t parseWithArduinoJson(const std::string &report)
+{
+    JsonDocument filter;
+    filter["print"]["command"] = true;
+    filter["print"]["gcode_state"] = true;
+    filter["print"]["stg_cur"] = true;
+    filter["print"]["mc_percent"] = true;
+    filter["print"]["home_flag"] = true;
+    filter["print"]["hms"] = true;
+    filter["print"]["lights_report"] = true;
+    filter["print"]["nozzle_temper"] = true;
+    filter["print"]["nozzle_target_temper"] = true;
+    filter["print"]["bed_temper"] = true;
+    filter["print"]["bed_target_temper"] = true;
+    filter["print"]["layer_num"] = true;
+    filter["print"]["total_layer_num"] = true;
+    filter["print"]["mc_remaining_time"] = true;
+    filter["print"]["ams"]["tray_now"] = true;
+    filter["print"]["ams"]["ams"][0]["id"] = true;
+    filter["print"]["ams"]["ams"][0]["tray"][0]["id"] = true;
+    filter["print"]["ams"]["ams"][0]["tray"][0]["tray_color"] = true;
+    filter["print"]["vt_tray"]["id"] = true;
+    filter["print"]["vt_tray"]["tray_color"] = true;
+    filter["system"]["command"] = true;
+    filter["system"]["led_mode"] = true;
+
+    JsonDocument doc;
+    if (deserializeJson(doc, report.data(), report.size(), DeserializationOption::Filter(filter)))
+        return 0;
+
+    JsonObject print = doc["print"];
+    uint32_t sum = strlen(print["command"] | "") + strlen(print["gcode_state"] | "");
+    sum += (print["stg_cur"] | 0) + (print["mc_percent"] | 0) + (print["home_flag"] | 0u);
+    sum += (int)((print["nozzle_temper"] | 0.0f) * 10) + (int)((print["bed_temper"] | 0.0f) * 10);
+    sum += (print["layer_num"] | 0) + (print["total_layer_num"] | 0) + (print["mc_remaining_time"] | 0);
+    for (JsonObject hms : print["hms"].as<JsonArray>())
+        sum += (hms["attr"] | 0u) ^ (hms["code"] | 0u);
+    for (JsonObject light : print["lights_report"].as<JsonArray>())
+        sum += strcmp(light["node"] | "", "chamber_light") == 0 && strcmp(light["mode"] | "", "on") == 0;
+    for (JsonObject unit : print["ams"]["ams"].as<JsonArray>())
+        for (JsonObject tray : unit["tray"].as<JsonArray>())
+            sum += atoi(tray["id"] | "0") + strtoul(tray["tray_color"] | "0", nullptr, 16);
+    return sum;
+}
+
+static ReportParser benchParser;
+
+static uint32_t parseWithReportParser(const std::string &report)
+{
+    benchParser.reset();
+    for (char c : report)
+        benchParser.feed((uint8_t)c);
+    const ReportDelta &delta = benchParser.delta();
+    uint32_t sum = delta.present + delta.stage + delta.progress + delta.nozzleTemp + delta.layer;
+    for (uint8_t i = 0; i < delta.trayCount; i++)
+        sum += delta.trays[i].id + delta.trays[i].color;
+    return sum;
+}
+
+// µs per report and MB/s for both parsers on a 1 kB and a 20 kB report
+static void runParseBench()
+{
+    printf("%-12s %8s %12s %10s %12s %10s\n", "report", "bytes", "ReportParser", "MB/s", "ArduinoJson", "MB/s");
+    for (size_t target : {1024u, 20480u})
+    {
+        std::string report = benchReport(target);
+        uint32_t iterations = max(10u, (uint32_t)(BENCH_PARSE_BYTES / report.size()));
+        volatile uint32_t sink = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+            sink = sink + parseWithReportParser(report);
+        double parserNs = elapsedNs(start) / iterations;
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+            sink = sink + parseWithArduinoJson(report);
+        double jsonNs = elapsedNs(start) / iterations;
+
+        char name[32];
+        snprintf(name, sizeof(name), "pushall %zuk", target / 1024);
+        printf("%-12s %8zu %9.2f us %10.1f %9.2f us %10.1f\n", name, report.size(), parserNs / 1000,
+               report.size() * 1000.0 / parserNs, jsonNs / 1000, report.size() * 1000.0 / jsonNs);
+    }
+}
+
+// ns per pixel for every pattern and ns per updateleds(), then the report
+// parse comparison; returns 1 if a limit given on the command line is
+// exceeded (for use as a CI gate)
+static int runBench()
+{
+    std::vector<CRGB> leds(options.ledCount);
+    PatternState state;
+    PrinterTelemetry telemetry;
+    telemetry.nozzleTemp = 2150;
+    telemetry.nozzleTarget = 2200;
+    telemetry.bedTemp = 580;
+    telemetry.bedTarget = 600;
+    bool failed = false;
+
+    printf("%u LEDs, %u frames per pattern\n", options.ledCount, BENCH_FRAMES);
+    printf("%-12s %10s\n", "pattern", "ns/pixel");
+    for (uint8_t pattern = 0; pattern <= PATTERN_LAYER_PULSE; pattern++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < BENCH_FRAMES; i++)
+        {
+            telemetry.layer = i / 100;
+            applyPattern(leds.data(), options.ledCount, pattern, CRGB(255, 128, 0), state, CRGB::Black,
+                         i % 101, &telemetry);
+        }
+        double ns = elapsedNs(start) / ((double)BENCH_FRAMES * options.ledCount);
+        bool over = options.maxNsPerPixel > 0 && ns > options.maxNsPerPixel;
+        failed |= over;
+        printf("%-12s %10.2f%s\n", patternNames[pattern], ns, over ? "  over limit" : "");
+    }
+
+    // updateleds() for every gcode_state / stage / HMS level / door combination
+    // (the cases of test/test_ledstate)
+    static const char *const states[] = {"IDLE", "PREPARE", "RUNNING", "PAUSE", "FINISH", "FAILED", "OFFLINE"};
+    static const int stages[] = {-1, 0, 1, 2, 6, 8, 10, 14, 17, 20, 34, 35};
+    static const uint8_t levels[] = {HMS_NONE, HMS_COMMON, HMS_SERIOUS, HMS_FATAL};
+    enum BenchDoor { DOOR_IDLE, DOOR_JUST_CLOSED, DOOR_DOUBLE_TAP, DOOR_CASES };
+    constexpr uint32_t combinations = (sizeof(states) / sizeof(states[0])) * (sizeof(stages) / sizeof(stages[0])) *
+                                      sizeof(levels) * DOOR_CASES;
+    constexpr uint32_t resolves = BENCH_RESOLVES / combinations;
+    double totalNs = 0;
+    double maxNs = 0;
+    char slowest[64] = "";
+    volatile uint32_t sink = 0;
+    logMuted = true;
+    printerConfig.debugOnChange = false;
+    for (const char *gcodeState : states)
+    {
+        for (int stage : stages)
+        {
+            for (uint8_t level : levels)
+            {
+                for (uint8_t door = 0; door < DOOR_CASES; door++)
+                {
+                    unsigned long now = millis();
+                    printerVariables = PrinterVariables();
+                    printerVariables.online = true;
+                    printerVariables.initializedLEDs = true;
+                    printerVariables.gcodeState = gcodeState;
+                    printerVariables.stage = stage;
+                    printerVariables.parsedHMSlevel = level;
+                    printerVariables.hmsstate = level != HMS_NONE;
+                    printerVariables.lastdoorOpenms = now - 10 * DOOR_DEBOUNCE_MS;
+                    printerVariables.lastdoorClosems = door == DOOR_JUST_CLOSED ? now : now - 10 * DOOR_DEBOUNCE_MS;
+                    printerConfig.inactivityStartms = now;
+                    printerConfig.isIdleOFFActive = false;
+                    printerConfig.finishStartms = now - printerConfig.finishTimeOut - 1;
+
+                    auto start = std::chrono::steady_clock::now();
+                    for (uint32_t i = 0; i < resolves; i++)
+                    {
+                        // The toggle is consumed by the resolve that shows it
+                        printerVariables.doorSwitchTriggered = door == DOOR_DOUBLE_TAP;
+                        updateleds();
+                        sink = sink + currentPattern;
+                    }
+                    double ns = elapsedNs(start);
+                    totalNs += ns;
+                    if (ns > maxNs)
+                    {
+                        maxNs = ns;
+                        snprintf(slowest, sizeof(slowest), "%s stage %d, %s, %s", gcodeState, stage,
+                                 hmsSeverityName(level), door == DOOR_IDLE ? "door idle" :
+                                 door == DOOR_JUST_CLOSED ? "door just closed" : "door double tap");
+                    }
+                }
+            }
+        }
+    }
+    logMuted = false;
+    double ns = totalNs / ((double)resolves * combinations);
+    bool over = options.maxNsPerResolve > 0 && ns > options.maxNsPerResolve;
+    failed |= over;
+    printf("%-12s %10.2f ns/resolve (%u states)%s\n", "updateleds", ns, combinations, over ? "  over limit" : "");
+    printf("%-12s %10.2f ns/resolve (%s)\n", "slowest", maxNs / resolves, slowest);
+
+    printf("\n");
+    runParseBench();
+
+    return failed ? 1 : 0;
+}
+
+static void onSignal(int)
+{
+    stopRequested = true;
+}
+
+int main(int argc, char **argv)
+{
+    if (!parseOptions(argc, argv))
+    {
+        usage();
+        return 2;
+    }
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    applyDefaultConfig();
+    frame.resize(options.ledCount);
+    // No manual pause seen: gcode_state is applied from the first report on
+    lastMQTTupdate = millis() - MQTT_STATUS_DEBOUNCE_MS - 1;
+
+    if (options.bench)
+        return runBench();
+
+    int result = options.replay != nullptr ? runReplay() : runLive();
+    printStats();
+    writePpm();
+    return result;
+}
+#endif
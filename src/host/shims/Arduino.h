@@ -0,0 +1,120 @@
+#ifndef _HOST_ARDUINO
+#define _HOST_ARDUINO
+
+// Thin Arduino shim for the native (Linux) build: only what the engine
+// sources compiled into the virtual controller use.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <limits.h>
+#include <algorithm>
+#include <string>
+#include <functional>
+
+using std::max;
+using std::min;
+
+#define F(s) (s)
+#define PROGMEM
+#define pgm_read_ptr(addr) (*(const void *const *)(addr))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+
+#define LOW 0x0
+#define HIGH 0x1
+#define OUTPUT 0x03
+
+// strlcpy() is part of newlib, glibc only has it from 2.38
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size)
+    {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
+
+// GPIO writes (relay) go nowhere on the host
+inline void pinMode(uint8_t pin, uint8_t mode) {}
+inline void digitalWrite(uint8_t pin, uint8_t val) {}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+#ifdef PIO_UNIT_TESTING
+// Unit tests set the time millis() and micros() return (host/main.cpp)
+void setTestMillis(unsigned long ms);
+#endif
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+class String : public std::string
+{
+public:
+    String() {}
+    String(const char *s) : std::string(s ? s : "") {}
+    String(const std::string &s) : std::string(s) {}
+
+    char charAt(size_t index) const { return index < size() ? (*this)[index] : 0; }
+    void remove(size_t index, size_t count) { erase(index, count); }
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t byte) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+            write(buffer[i]);
+        return size;
+    }
+
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const String &s) { return write((const uint8_t *)s.data(), s.size()); }
+    size_t print(long value) { return printf("%ld", value); }
+    size_t println() { return print("\n"); }
+    template <typename T>
+    size_t println(const T &value) { return print(value) + println(); }
+    size_t printf(const char *format, ...)
+    {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return len > 0 ? write((const uint8_t *)buffer, min((size_t)len, sizeof(buffer) - 1)) : 0;
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+};
+
+// Free heap is not meaningful on the host, the ingest statistics read 0
+struct EspClass
+{
+    uint32_t getFreeHeap() { return 0; }
+};
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef _HOST_FASTLED
+#define _HOST_FASTLED
+
+// Thin FastLED shim for the native build: the pixel types and helpers used by
+// patterns.cpp, and a controller that accepts the strip setup of leds.h and
+// draws nothing. HSV conversion is a plain spectrum mapping, so hues can look
+// slightly different from FastLED's rainbow conversion on a real strip.
+
+#include "Arduino.h"
+
+inline uint8_t scale8(uint8_t i, uint8_t scale)
+{
+    return (uint8_t)(((uint16_t)i * (1 + (uint16_t)scale)) >> 8);
+}
+
+inline uint8_t sin8(uint8_t theta)
+{
+    return (uint8_t)lround(127.5 + 127.5 * sin(theta * (2 * M_PI / 256)));
+}
+
+struct CHSV
+{
+    uint8_t h, s, v;
+    CHSV() : h(0), s(0), v(0) {}
+    CHSV(uint8_t hue, uint8_t sat, uint8_t val) : h(hue), s(sat), v(val) {}
+};
+
+struct CRGB
+{
+    uint8_t r, g, b;
+
+    enum HTMLColorCode : uint32_t
+    {
+        Black = 0x000000,
+        White = 0xFFFFFF,
+        Red = 0xFF0000,
+        Green = 0x008000,
+        Blue = 0x0000FF,
+        Cyan = 0x00FFFF,
+        DarkGreen = 0x006400,
+        Yellow = 0xFFFF00
+    };
+
+    CRGB() : r(0), g(0), b(0) {}
+    CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+    CRGB(HTMLColorCode code) : r((code >> 16) & 0xFF), g((code >> 8) & 0xFF), b(code & 0xFF) {}
+    CRGB(const CHSV &hsv)
+    {
+        uint8_t region = hsv.h / 43;
+        uint8_t remainder = (hsv.h - region * 43) * 6;
+        uint8_t p = scale8(hsv.v, 255 - hsv.s);
+        uint8_t q = scale8(hsv.v, 255 - scale8(hsv.s, remainder));
+        uint8_t t = scale8(hsv.v, 255 - scale8(hsv.s, 255 - remainder));
+        switch (region)
+        {
+        case 0: r = hsv.v; g = t; b = p; break;
+        case 1: r = q; g = hsv.v; b = p; break;
+        case 2: r = p; g = hsv.v; b = t; break;
+        case 3: r = p; g = q; b = hsv.v; break;
+        case 4: r = t; g = p; b = hsv.v; break;
+        default: r = hsv.v; g = p; b = q; break;
+        }
+    }
+
+    CRGB &nscale8(uint8_t scale)
+    {
+        r = scale8(r, scale);
+        g = scale8(g, scale);
+        b = scale8(b, scale);
+        return *this;
+    }
+
+    bool operator==(const CRGB &other) const { return r == other.r && g == other.g && b == other.b; }
+    bool operator!=(const CRGB &other) const { return !(*this == other); }
+};
+
+inline void fill_solid(CRGB *leds, int count, const CRGB &color)
+{
+    for (int i = 0; i < count; i++)
+        leds[i] = color;
+}
+
+inline void fill_rainbow(CRGB *leds, int count, uint8_t initialHue, uint8_t deltaHue = 5)
+{
+    for (int i = 0; i < count; i++)
+        leds[i] = CHSV(initialHue + i * deltaHue, 240, 255);
+}
+
+// Chipsets and color orders only select a controller template on the ESP32
+enum ESPIChipsets { APA102 };
+enum EOrder { RGB, RBG, GRB, GBR, BRG, BGR };
+enum EOrderW { W3, W2, W1, W0 };
+template <uint8_t DATA_PIN> struct WS2812B {};
+template <uint8_t DATA_PIN> struct SK6812 {};
+template <uint8_t DATA_PIN> struct WS2811 {};
+template <uint8_t DATA_PIN> struct NEOPIXEL {};
+
+enum RGBW_MODE { kRGBWExactColors };
+constexpr uint16_t kRGBWDefaultColorTemp = 6000;
+
+struct Rgbw
+{
+    Rgbw(uint16_t temp, RGBW_MODE mode, EOrderW order) {}
+};
+
+struct CLEDController
+{
+    CLEDController &setRgbw(const Rgbw &rgbw) { return *this; }
+};
+
+class CFastLED
+{
+private:
+    CLEDController _controller;
+    uint8_t _brightness = 255;
+
+public:
+    template <template <uint8_t DATA_PIN> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER = GRB>
+    CLEDController &addLeds(CRGB *data, int count) { return _controller; }
+    template <ESPIChipsets CHIPSET, uint8_t DATA_PIN, uint8_t CLOCK_PIN, EOrder RGB_ORDER = RGB>
+    CLEDController &addLeds(CRGB *data, int count) { return _controller; }
+
+    void setBrightness(uint8_t scale) { _brightness = scale; }
+    uint8_t getBrightness() const { return _brightness; }
+    void clear() {}
+    void show() {}
+};
+
+extern CFastLED FastLED;
+
+#endif
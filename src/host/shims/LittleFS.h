@@ -0,0 +1,70 @@
+#ifndef _HOST_LITTLEFS
+#define _HOST_LITTLEFS
+
+// LittleFS on the host: paths are files below the directory given to begin()
+
+#include "Arduino.h"
+#include <errno.h>
+#include <memory>
+#include <sys/stat.h>
+
+class File : public Stream
+{
+private:
+    std::shared_ptr<FILE> _file;
+
+public:
+    File() {}
+    explicit File(FILE *file) : _file(file, fclose) {}
+
+    explicit operator bool() const { return _file != nullptr; }
+
+    int available() override
+    {
+        if (!_file)
+            return 0;
+        long pos = ftell(_file.get());
+        fseek(_file.get(), 0, SEEK_END);
+        long end = ftell(_file.get());
+        fseek(_file.get(), pos, SEEK_SET);
+        return (int)(end - pos);
+    }
+    int read() override { return _file ? fgetc(_file.get()) : -1; }
+    int peek() override
+    {
+        int c = read();
+        if (c >= 0)
+            ungetc(c, _file.get());
+        return c;
+    }
+    size_t readBytes(char *buffer, size_t length) { return _file ? fread(buffer, 1, length, _file.get()) : 0; }
+    size_t write(uint8_t b) override { return _file && fputc(b, _file.get()) != EOF ? 1 : 0; }
+    size_t write(const uint8_t *buffer, size_t size) override { return _file ? fwrite(buffer, 1, size, _file.get()) : 0; }
+    void close() { _file.reset(); }
+};
+
+class LittleFSClass
+{
+private:
+    std::string _root = ".";
+
+    std::string hostPath(const char *path) const { return _root + (path[0] == '/' ? "" : "/") + path; }
+
+public:
+    bool begin(bool formatOnFail = false, const char *basePath = ".")
+    {
+        _root = basePath;
+        return mkdir(basePath, 0755) == 0 || errno == EEXIST;
+    }
+    bool exists(const char *path) const
+    {
+        struct stat info;
+        return stat(hostPath(path).c_str(), &info) == 0;
+    }
+    File open(const char *path, const char *mode) { return File(fopen(hostPath(path).c_str(), mode)); }
+    bool remove(const char *path) { return ::remove(hostPath(path).c_str()) == 0; }
+    bool rename(const char *from, const char *to) { return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0; }
+};
+extern LittleFSClass LittleFS;
+
+#endif
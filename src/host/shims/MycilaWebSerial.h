@@ -0,0 +1,9 @@
+#ifndef _HOST_WEBSERIAL
+#define _HOST_WEBSERIAL
+
+// The web serial log does not exist on the host, LogSerial writes to stderr
+class WebSerial
+{
+};
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _HOST_STREAM
+#define _HOST_STREAM
+
+#include "Arduino.h"
+
+#endif
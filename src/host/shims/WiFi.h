@@ -0,0 +1,17 @@
+#ifndef _HOST_WIFI
+#define _HOST_WIFI
+
+// The host has no WiFi of its own, the station always reads disconnected
+#include "Arduino.h"
+
+enum wl_status_t { WL_CONNECTED = 3, WL_DISCONNECTED = 6 };
+
+class WiFiClass
+{
+public:
+    wl_status_t status() { return WL_DISCONNECTED; }
+    int8_t RSSI() { return 0; }
+};
+extern WiFiClass WiFi;
+
+#endif
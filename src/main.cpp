@@ -7,8 +7,10 @@ unsigned long restartRequestTime = 0;
 #include "./blflc/types.h"
 #include "./blflc/bblprinterdiscovery.h"
 #include "./blflc/web-server.h"
+#include "./blflc/statuschannel.h"
 #include "./blflc/mqttmanager.h"
 #include "./blflc/ssdp.h"
+#include "./blflc/hmscatalogue.h"
 
 #ifdef USE_ETHERNET
 #include "./blflc/eth-manager.h"
@@ -60,6 +62,7 @@ void setup()
 
     setupFileSystem();
     loadFileSystem();
+    loadHMSCatalogue();
 
     Serial.println(F(""));
 
@@ -149,7 +152,7 @@ void loop()
 
     if (globalVariables.started)
     {
-        websocketLoop();
+        statusChannelLoop();
         ledsloop();
 
 #ifdef USE_ETHERNET
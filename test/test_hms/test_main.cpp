@@ -0,0 +1,144 @@
+// HMS ignore list and HMS catalogue (override) matching
+
+#include <unity.h>
+#include <LittleFS.h>
+#include "../../src/blflc/mqttparsingutility.h"
+#include "../../src/blflc/hmscatalogue.h"
+
+static const char *catalogueDir = "/tmp/blflc-test-hms";
+
+static void writeFile(const char *path, const char *text)
+{
+    File file = LittleFS.open(path, "w");
+    file.print(text);
+    file.close();
+}
+
+void setUp(void)
+{
+    LittleFS.begin(true, catalogueDir);
+    LittleFS.remove(hmsCataloguePath);
+    LittleFS.remove(hmsCatalogueUploadPath);
+    compileHMSIgnoreList("");
+}
+
+void tearDown(void)
+{
+}
+
+static void test_parse_code_string(void)
+{
+    uint64_t code, mask;
+    const char *exact[] = {"HMS_0300_1200_0002_0001", "hms-0300-1200-0002-0001", "  0300 1200 0002 0001",
+                           "0300120000020001"};
+    for (const char *text : exact)
+    {
+        TEST_ASSERT_TRUE_MESSAGE(parseHMSCodeString(text, strlen(text), code, mask), text);
+        TEST_ASSERT_EQUAL_HEX64(0x0300120000020001ULL, code);
+        TEST_ASSERT_EQUAL_HEX64(~0ULL, mask);
+    }
+
+    const char *pattern = "0700_2000_XXXX_xxxx";
+    TEST_ASSERT_TRUE(parseHMSCodeString(pattern, strlen(pattern), code, mask));
+    TEST_ASSERT_EQUAL_HEX64(0x0700200000000000ULL, code);
+    TEST_ASSERT_EQUAL_HEX64(0xFFFFFFFF00000000ULL, mask);
+
+    const char *invalid[] = {"", "HMS_0300_1200_0002", "0300_1200_0002_0001_0", "0300_1200_0002_000G"};
+    for (const char *text : invalid)
+        TEST_ASSERT_FALSE_MESSAGE(parseHMSCodeString(text, strlen(text), code, mask), text);
+}
+
+static void test_ignore_list(void)
+{
+    compileHMSIgnoreList("HMS_0300_1200_0002_0001, hms-0700-2000-0003-0001\n"
+                         "bogus;0C00_0300_0003_000B\r\n0700_XXXX_0000_0001,HMS_0300_1200_0002_0001");
+
+    TEST_ASSERT_TRUE(isHMSCodeIgnored(0x0300120000020001ULL));
+    TEST_ASSERT_TRUE(isHMSCodeIgnored(0x0700200000030001ULL));
+    TEST_ASSERT_TRUE(isHMSCodeIgnored(0x0C0003000003000BULL));
+    TEST_ASSERT_FALSE(isHMSCodeIgnored(0x0300120000020002ULL));
+    // Wildcards are not accepted in the ignore list
+    TEST_ASSERT_FALSE(isHMSCodeIgnored(0x0700000000000001ULL));
+    TEST_ASSERT_FALSE(isHMSCodeIgnored(0x0700120000000001ULL));
+
+    compileHMSIgnoreList("");
+    TEST_ASSERT_FALSE(isHMSCodeIgnored(0x0300120000020001ULL));
+}
+
+static void test_builtin_catalogue(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, loadHMSCatalogue());
+
+    const HMSCatalogueEntry *entry = findHMSCatalogueEntry(0x0300120000020001ULL);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_INT16(17, entry->stage);
+    TEST_ASSERT_FALSE(entry->hasColor);
+
+    entry = findHMSCatalogueEntry(0x0700200000030001ULL);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_INT16(6, entry->stage);
+
+    TEST_ASSERT_NULL(findHMSCatalogueEntry(0x0700200000030002ULL));
+}
+
+static void test_catalogue_file(void)
+{
+    writeFile(hmsCataloguePath,
+              "{\"codes\":["
+              "{\"code\":\"0700_XXXX_XXXX_XXXX\",\"severity\":\"info\"},"
+              "{\"code\":\"0700_2000_XXXX_XXXX\",\"severity\":\"serious\",\"color\":\"#FF8000\",\"pattern\":2},"
+              "{\"code\":\"0700_2000_0003_0001\",\"stage\":21},"
+              "{\"code\":\"not a code\",\"stage\":1}"
+              "]}");
+    TEST_ASSERT_EQUAL_INT(3, loadHMSCatalogue());
+
+    // The file entry replaces the built-in one with the same code
+    const HMSCatalogueEntry *entry = findHMSCatalogueEntry(0x0700200000030001ULL);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_INT16(21, entry->stage);
+
+    // The most specific pattern wins
+    entry = findHMSCatalogueEntry(0x0700200000050002ULL);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_UINT8(HMS_SERIOUS, entry->severity);
+    TEST_ASSERT_EQUAL_INT16(HMS_NO_STAGE, entry->stage);
+    TEST_ASSERT_TRUE(entry->hasColor);
+    TEST_ASSERT_EQUAL_UINT8(0xFF, entry->color.r);
+    TEST_ASSERT_EQUAL_UINT8(0x80, entry->color.g);
+    TEST_ASSERT_EQUAL_UINT8(0x00, entry->color.b);
+    TEST_ASSERT_EQUAL_UINT8(PATTERN_CHASE, entry->pattern);
+
+    entry = findHMSCatalogueEntry(0x0700100000000000ULL);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_UINT8(HMS_INFO, entry->severity);
+    TEST_ASSERT_FALSE(entry->hasColor);
+
+    // Built-in entries are still there
+    TEST_ASSERT_NOT_NULL(findHMSCatalogueEntry(0x0300120000020001ULL));
+    TEST_ASSERT_NULL(findHMSCatalogueEntry(0x0800200000030001ULL));
+}
+
+// An upload that does not parse leaves the active catalogue in place
+static void test_invalid_upload(void)
+{
+    writeFile(hmsCataloguePath, "{\"codes\":[{\"code\":\"0C00_XXXX_XXXX_XXXX\",\"stage\":10}]}");
+    TEST_ASSERT_EQUAL_INT(1, loadHMSCatalogue());
+
+    writeFile(hmsCatalogueUploadPath, "{\"codes\":[{\"code\":");
+    TEST_ASSERT_EQUAL_INT(-1, loadHMSCatalogue(hmsCatalogueUploadPath));
+
+    const HMSCatalogueEntry *entry = findHMSCatalogueEntry(0x0C00010000000001ULL);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_INT16(10, entry->stage);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_code_string);
+    RUN_TEST(test_ignore_list);
+    RUN_TEST(test_builtin_catalogue);
+    RUN_TEST(test_catalogue_file);
+    RUN_TEST(test_invalid_upload);
+    return UNITY_END();
+}
@@ -0,0 +1,138 @@
+// updateleds() must not touch the heap: every new / delete in this binary is
+// counted, and the counter has to stay put across a state resolve
+
+#include <unity.h>
+#include <new>
+#include <stdlib.h>
+#include "../../src/blflc/leds.h"
+
+static volatile bool counting = false;
+static volatile size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    if (counting)
+        allocations = allocations + 1;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+struct AllocCase {
+    const char *gcodeState;
+    int stage;
+    uint8_t hmsLevel;
+};
+
+// One of each kind of handler: stage colors, errors, HMS, pause, finish, idle
+static const AllocCase cases[] = {
+    {"IDLE", -1, HMS_NONE},     {"RUNNING", 0, HMS_NONE},   {"RUNNING", 2, HMS_NONE},
+    {"PREPARE", 0, HMS_NONE},   {"RUNNING", 13, HMS_NONE},  {"RUNNING", 14, HMS_NONE},
+    {"RUNNING", 6, HMS_NONE},   {"RUNNING", 35, HMS_NONE},  {"RUNNING", 0, HMS_SERIOUS},
+    {"RUNNING", 0, HMS_FATAL},  {"PAUSE", 0, HMS_NONE},     {"FAILED", 0, HMS_NONE},
+    {"FINISH", -1, HMS_NONE},   {"OFFLINE", 0, HMS_NONE},   {"RUNNING", 3, HMS_NONE},
+};
+
+static void resetPrinter()
+{
+    printerVariables = PrinterVariables();
+    printerConfig = PrinterConfig();
+
+    unsigned long now = millis();
+    printerVariables.online = true;
+    printerVariables.initializedLEDs = true;
+    printerVariables.lastdoorOpenms = now - 10 * DOOR_DEBOUNCE_MS;
+    printerVariables.lastdoorClosems = now - 10 * DOOR_DEBOUNCE_MS;
+    printerConfig.inactivityStartms = now;
+    printerConfig.finishStartms = now - printerConfig.finishTimeOut - 1;
+}
+
+// Walk through every case, so each resolve changes the LED state and logs it
+static size_t countResolveAllocations()
+{
+    size_t total = 0;
+    for (const AllocCase &c : cases)
+    {
+        printerVariables.gcodeState = c.gcodeState;
+        printerVariables.stage = c.stage;
+        printerVariables.parsedHMSlevel = c.hmsLevel;
+        printerVariables.hmsstate = c.hmsLevel != HMS_NONE;
+
+        allocations = 0;
+        counting = true;
+        updateleds();
+        counting = false;
+        if (allocations)
+            printf("%s stage %d hms %d: %u allocations\n", c.gcodeState, c.stage, c.hmsLevel,
+                   (unsigned)allocations);
+        total += allocations;
+    }
+    return total;
+}
+
+void setUp(void)
+{
+    resetPrinter();
+}
+
+void tearDown(void)
+{
+    counting = false;
+}
+
+static void test_counter_works(void)
+{
+    counting = true;
+    int *p = new int(1);
+    counting = false;
+    delete p;
+    TEST_ASSERT_EQUAL_UINT32(1, allocations);
+}
+
+static void test_resolve_without_logging(void)
+{
+    printerConfig.debugOnChange = false;
+    TEST_ASSERT_EQUAL_UINT32(0, countResolveAllocations());
+}
+
+static void test_resolve_with_logging(void)
+{
+    printerConfig.debugOnChange = true;
+    printerConfig.debugging = true;
+    TEST_ASSERT_EQUAL_UINT32(0, countResolveAllocations());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_counter_works);
+    RUN_TEST(test_resolve_without_logging);
+    RUN_TEST(test_resolve_with_logging);
+    return UNITY_END();
+}
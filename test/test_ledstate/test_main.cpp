@@ -0,0 +1,322 @@
+// updateleds() priority ladder: printer state in, LedReason out
+
+#include <unity.h>
+#include "../../src/blflc/leds.h"
+
+// A printer that is online, booted, printing nothing and has its chamber
+// light on, with no door activity, finish window or idle timeout pending
+static void resetPrinter()
+{
+    printerVariables = PrinterVariables();
+    printerConfig = PrinterConfig();
+    printerConfig.debugOnChange = false;
+
+    unsigned long now = millis();
+    printerVariables.online = true;
+    printerVariables.initializedLEDs = true;
+    printerVariables.gcodeState = "IDLE";
+    printerVariables.stage = -1;
+    printerVariables.lastdoorOpenms = now - 10 * DOOR_DEBOUNCE_MS;
+    printerVariables.lastdoorClosems = now - 10 * DOOR_DEBOUNCE_MS;
+    printerConfig.inactivityStartms = now;
+    printerConfig.finishStartms = now - printerConfig.finishTimeOut - 1;
+}
+
+void setUp(void)
+{
+    resetPrinter();
+}
+
+void tearDown(void)
+{
+}
+
+struct LadderCase {
+    const char *name;
+    const char *gcodeState;
+    int stage;
+    int overridestage;
+    uint8_t hmsLevel;
+    uint8_t expected;
+};
+
+static void runCases(const LadderCase *cases, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        resetPrinter();
+        printerVariables.gcodeState = cases[i].gcodeState;
+        printerVariables.stage = cases[i].stage;
+        printerVariables.overridestage = cases[i].overridestage;
+        printerVariables.parsedHMSlevel = cases[i].hmsLevel;
+        printerVariables.hmsstate = cases[i].hmsLevel != HMS_NONE;
+        updateleds();
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(ledReasonName(cases[i].expected),
+                                         ledReasonName(printerVariables.ledReason), cases[i].name);
+    }
+}
+
+static void test_printer_states(void)
+{
+    static const LadderCase cases[] = {
+        {"idle", "IDLE", -1, 999, HMS_NONE, REASON_IDLE},
+        {"idle (stage 255)", "IDLE", 255, 999, HMS_NONE, REASON_IDLE},
+        {"printing", "RUNNING", 0, 999, HMS_NONE, REASON_PRINTING},
+        {"preheating", "RUNNING", 2, 999, HMS_NONE, REASON_PREHEATING},
+        {"preparing", "PREPARE", 0, 999, HMS_NONE, REASON_PREPARING},
+        {"failed", "FAILED", 0, 999, HMS_NONE, REASON_FAILED},
+        {"homing", "RUNNING", 13, 999, HMS_NONE, REASON_HOMING},
+        {"offline state", "OFFLINE", 0, 999, HMS_NONE, REASON_OFFLINE},
+        {"offline stage", "RUNNING", -2, 999, HMS_NONE, REASON_OFFLINE},
+        {"finished, idle", "FINISH", -1, 999, HMS_NONE, REASON_IDLE},
+        {"prepare at idle stage", "PREPARE", -1, 999, HMS_NONE, REASON_IDLE},
+    };
+    runCases(cases, sizeof(cases) / sizeof(cases[0]));
+}
+
+static void test_stage_colors(void)
+{
+    static const LadderCase cases[] = {
+        {"stage 14", "RUNNING", 14, 999, HMS_NONE, REASON_CLEANING_NOZZLE},
+        {"stage 1", "RUNNING", 1, 999, HMS_NONE, REASON_BED_LEVELING},
+        {"stage 8", "RUNNING", 8, 999, HMS_NONE, REASON_CALIBRATING_EXTRUSION},
+        {"stage 9", "RUNNING", 9, 999, HMS_NONE, REASON_SCANNING_BED},
+        {"stage 10", "RUNNING", 10, 999, HMS_NONE, REASON_FIRST_LAYER_SCAN},
+        {"override stage 10", "RUNNING", 0, 10, HMS_NONE, REASON_FIRST_LAYER_SCAN},
+        {"stage 12", "RUNNING", 12, 999, HMS_NONE, REASON_CALIBRATING_LIDAR},
+    };
+    runCases(cases, sizeof(cases) / sizeof(cases[0]));
+}
+
+static void test_errors_and_pauses(void)
+{
+    static const LadderCase cases[] = {
+        {"filament runout", "RUNNING", 6, 999, HMS_NONE, REASON_FILAMENT_RUNOUT},
+        {"filament runout override", "RUNNING", 0, 6, HMS_NONE, REASON_FILAMENT_RUNOUT},
+        {"front cover", "RUNNING", 17, 999, HMS_NONE, REASON_FRONT_COVER},
+        {"nozzle temp", "RUNNING", 20, 999, HMS_NONE, REASON_NOZZLE_TEMP_FAIL},
+        {"bed temp", "RUNNING", 21, 999, HMS_NONE, REASON_BED_TEMP_FAIL},
+        {"hms serious", "RUNNING", 0, 999, HMS_SERIOUS, REASON_HMS_SERIOUS},
+        {"hms fatal", "RUNNING", 0, 999, HMS_FATAL, REASON_HMS_FATAL},
+        {"hms common", "RUNNING", 0, 999, HMS_COMMON, REASON_PRINTING},
+        {"paused", "PAUSE", 0, 999, HMS_NONE, REASON_PAUSED},
+        {"stage 16", "RUNNING", 16, 999, HMS_NONE, REASON_PAUSED},
+        {"stage 30", "RUNNING", 30, 999, HMS_NONE, REASON_PAUSED},
+        {"stage 34", "RUNNING", 34, 999, HMS_NONE, REASON_FIRST_LAYER_ERROR},
+        {"stage 35", "RUNNING", 35, 999, HMS_NONE, REASON_NOZZLE_CLOG},
+        {"error over pause", "PAUSE", 6, 999, HMS_NONE, REASON_FILAMENT_RUNOUT},
+        {"hms over pause", "PAUSE", 0, 999, HMS_FATAL, REASON_HMS_FATAL},
+        {"pause over stage color", "PAUSE", 14, 999, HMS_NONE, REASON_PAUSED},
+        {"pause over first layer error", "PAUSE", 34, 999, HMS_NONE, REASON_PAUSED},
+    };
+    runCases(cases, sizeof(cases) / sizeof(cases[0]));
+}
+
+static void test_hms_catalogue_color(void)
+{
+    printerVariables.gcodeState = "RUNNING";
+    printerVariables.stage = 6;
+    printerVariables.hmsstate = true;
+    printerVariables.hmsColorOverride = true;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_HMS_CATALOGUE, printerVariables.ledReason);
+
+    resetPrinter();
+    printerConfig.errordetection = false;
+    printerVariables.gcodeState = "RUNNING";
+    printerVariables.stage = 0;
+    printerVariables.parsedHMSlevel = HMS_FATAL;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_PRINTING, printerVariables.ledReason);
+}
+
+static void test_off_states(void)
+{
+    printerVariables.online = false;
+    printerVariables.disconnectMQTTms = millis() - MQTT_OFFLINE_TIMEOUT_MS;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_PRINTER_OFFLINE, printerVariables.ledReason);
+    TEST_ASSERT_TRUE(areLedsOff());
+
+    // Pauses are shown even when the printer is no longer heard from
+    resetPrinter();
+    printerVariables.online = false;
+    printerVariables.disconnectMQTTms = millis() - MQTT_OFFLINE_TIMEOUT_MS;
+    printerVariables.gcodeState = "PAUSE";
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_PAUSED, printerVariables.ledReason);
+
+    resetPrinter();
+    printerVariables.printerLedState = false;
+    printerVariables.gcodeState = "RUNNING";
+    printerVariables.stage = 0;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_CHAMBER_LIGHT_OFF, printerVariables.ledReason);
+    TEST_ASSERT_TRUE(areLedsOff());
+
+    // Disconnected only just now: not offline yet
+    resetPrinter();
+    printerVariables.online = false;
+    printerVariables.disconnectMQTTms = millis();
+    printerVariables.printerLedState = false;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_CHAMBER_LIGHT_OFF, printerVariables.ledReason);
+}
+
+static void test_special_modes(void)
+{
+    printerConfig.maintMode = true;
+    printerVariables.stage = 6;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_MAINTENANCE, printerVariables.ledReason);
+
+    resetPrinter();
+    printerConfig.debugwifi = true;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_WIFI_SIGNAL, printerVariables.ledReason);
+
+    resetPrinter();
+    printerConfig.testcolorEnabled = true;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_COLOR_TEST, printerVariables.ledReason);
+
+    resetPrinter();
+    printerConfig.discoMode = true;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_RGB_CYCLE, printerVariables.ledReason);
+
+    resetPrinter();
+    printerConfig.progressBarEnabled = true;
+    printerVariables.gcodeState = "RUNNING";
+    printerVariables.stage = 0;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_PROGRESS_BAR, printerVariables.ledReason);
+
+    // Special modes hold the LEDs: the printer state below is not resolved
+    resetPrinter();
+    printerConfig.testcolorEnabled = true;
+    updateleds();
+    printerVariables.gcodeState = "RUNNING";
+    printerVariables.stage = 0;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_COLOR_TEST, printerVariables.ledReason);
+}
+
+static void test_boot_door_and_timeouts(void)
+{
+    printerVariables.initializedLEDs = false;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_BOOTING, printerVariables.ledReason);
+
+    // The door toggle wins over errors
+    resetPrinter();
+    printerVariables.stage = 6;
+    printerVariables.doorSwitchTriggered = true;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_DOOR_TOGGLE, printerVariables.ledReason);
+    TEST_ASSERT_FALSE(printerVariables.doorSwitchTriggered);
+
+    resetPrinter();
+    printerConfig.inactivityStartms = millis() - printerConfig.inactivityTimeOut - 1;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_IDLE_TIMEOUT, printerVariables.ledReason);
+    TEST_ASSERT_TRUE(printerConfig.isIdleOFFActive);
+}
+
+static void test_finish_window(void)
+{
+    // Door exit: finished print waits for the door
+    printerVariables.gcodeState = "FINISH";
+    printerVariables.finished = true;
+    printerVariables.waitingForDoor = true;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_PRINT_FINISHED, printerVariables.ledReason);
+
+    // Timer exit
+    resetPrinter();
+    printerConfig.finishExit = false;
+    printerConfig.finishStartms = millis();
+    printerVariables.gcodeState = "FINISH";
+    printerVariables.finished = true;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_PRINT_FINISHED, printerVariables.ledReason);
+
+    // Nothing else matches while the finish color is shown: it stays
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_PRINT_FINISHED, printerVariables.ledReason);
+
+    // A failed print in the finish window is not idle
+    resetPrinter();
+    printerVariables.gcodeState = "FAILED";
+    printerVariables.waitingForDoor = true;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_FAILED, printerVariables.ledReason);
+}
+
+static void test_unmatched_state_keeps_reason(void)
+{
+    printerVariables.gcodeState = "RUNNING";
+    printerVariables.stage = 0;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_PRINTING, printerVariables.ledReason);
+
+    // A stage without a color of its own leaves the LEDs and their reason alone
+    printerVariables.stage = 3;
+    printerConfig.replicate_update = false;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_PRINTING, printerVariables.ledReason);
+
+    // Unless the chamber light state is to be replicated
+    printerConfig.replicate_update = true;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(REASON_CHAMBER_LIGHT_ON, printerVariables.ledReason);
+}
+
+// Heat map and layer pulse follow a print, other running color states are solid
+static void test_telemetry_patterns_while_printing(void)
+{
+    static const LadderCase cases[] = {
+        {"printing", "RUNNING", 0, 999, HMS_NONE, PATTERN_HEATMAP},
+        {"preheating", "RUNNING", 2, 999, HMS_NONE, PATTERN_HEATMAP},
+        {"preparing", "PREPARE", 0, 999, HMS_NONE, PATTERN_HEATMAP},
+        {"idle", "IDLE", -1, 999, HMS_NONE, PATTERN_SOLID},
+        {"failed", "FAILED", 0, 999, HMS_NONE, PATTERN_SOLID},
+        {"offline", "OFFLINE", 0, 999, HMS_NONE, PATTERN_SOLID},
+        {"chamber light on", "RUNNING", 3, 999, HMS_NONE, PATTERN_SOLID},
+    };
+    for (uint8_t running : {PATTERN_HEATMAP, PATTERN_LAYER_PULSE})
+    {
+        for (const LadderCase &c : cases)
+        {
+            resetPrinter();
+            printerConfig.runningPattern = running;
+            printerVariables.gcodeState = c.gcodeState;
+            printerVariables.stage = c.stage;
+            updateleds();
+            uint8_t expected = c.expected == PATTERN_SOLID ? PATTERN_SOLID : running;
+            TEST_ASSERT_EQUAL_UINT8_MESSAGE(expected, currentPattern, c.name);
+        }
+    }
+
+    // Other running patterns are kept outside a print
+    resetPrinter();
+    printerConfig.runningPattern = PATTERN_BREATHING;
+    updateleds();
+    TEST_ASSERT_EQUAL_UINT8(PATTERN_BREATHING, currentPattern);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_printer_states);
+    RUN_TEST(test_stage_colors);
+    RUN_TEST(test_errors_and_pauses);
+    RUN_TEST(test_hms_catalogue_color);
+    RUN_TEST(test_off_states);
+    RUN_TEST(test_special_modes);
+    RUN_TEST(test_boot_door_and_timeouts);
+    RUN_TEST(test_finish_window);
+    RUN_TEST(test_unmatched_state_keeps_reason);
+    RUN_TEST(test_telemetry_patterns_while_printing);
+    return UNITY_END();
+}
@@ -0,0 +1,156 @@
+// Golden frames for every LED pattern at fixed timestamps. The colour math
+// comes from the FastLED shim in src/host/shims, so these frames pin the
+// pattern logic, not FastLED's own rounding.
+
+#include <unity.h>
+#include "../../src/blflc/patterns.h"
+
+static const uint16_t ledCount = 8;
+static CRGB leds[ledCount];
+static const CRGB color(200, 100, 50);
+
+static void assertFrame(const uint8_t (&expected)[ledCount * 3], const char *message)
+{
+    TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected, (const uint8_t *)leds, ledCount * 3, message);
+}
+
+void setUp(void)
+{
+    fill_solid(leds, ledCount, CRGB::Black);
+}
+
+void tearDown(void)
+{
+}
+
+static const uint8_t solidFrame[] = {0xC8, 0x64, 0x32, 0xC8, 0x64, 0x32, 0xC8, 0x64, 0x32, 0xC8, 0x64, 0x32,
+                                     0xC8, 0x64, 0x32, 0xC8, 0x64, 0x32, 0xC8, 0x64, 0x32, 0xC8, 0x64, 0x32};
+
+static void test_solid(void)
+{
+    PatternState state;
+    setTestMillis(1000);
+    applyPattern(leds, ledCount, PATTERN_SOLID, color, state);
+    assertFrame(solidFrame, "solid");
+}
+
+// The breathing phase lives in the pattern function, so this must be the
+// first breathing test in the run: 101 steps of 10 ms is half a period
+static void test_breathing(void)
+{
+    static const uint8_t half[] = {0x6F, 0x37, 0x1B, 0x6F, 0x37, 0x1B, 0x6F, 0x37, 0x1B, 0x6F, 0x37, 0x1B,
+                                   0x6F, 0x37, 0x1B, 0x6F, 0x37, 0x1B, 0x6F, 0x37, 0x1B, 0x6F, 0x37, 0x1B};
+    PatternState state;
+    for (unsigned long t = 1000; t <= 2000; t += 10)
+    {
+        setTestMillis(t);
+        applyPattern(leds, ledCount, PATTERN_BREATHING, color, state);
+    }
+    assertFrame(half, "breathing");
+}
+
+static void test_chase(void)
+{
+    static const uint8_t first[] = {0xA0, 0x50, 0x28, 0xC8, 0x64, 0x32, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                    0x00, 0x00, 0x00, 0x28, 0x14, 0x0A, 0x50, 0x28, 0x14, 0x78, 0x3C, 0x1E};
+    static const uint8_t moved[] = {0x78, 0x3C, 0x1E, 0xA0, 0x50, 0x28, 0xC8, 0x64, 0x32, 0x00, 0x00, 0x00,
+                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x28, 0x14, 0x0A, 0x50, 0x28, 0x14};
+    PatternState state;
+    setTestMillis(1000);
+    applyPattern(leds, ledCount, PATTERN_CHASE, color, state);
+    assertFrame(first, "chase at 1000");
+
+    setTestMillis(1049);
+    applyPattern(leds, ledCount, PATTERN_CHASE, color, state);
+    assertFrame(first, "chase before 50 ms");
+
+    setTestMillis(1050);
+    applyPattern(leds, ledCount, PATTERN_CHASE, color, state);
+    assertFrame(moved, "chase after 50 ms");
+}
+
+static void test_rainbow(void)
+{
+    static const uint8_t first[] = {0xFF, 0x15, 0x0F, 0xFF, 0xC3, 0x0F, 0x8E, 0xFF, 0x0F, 0x0F, 0xFF, 0x3C,
+                                    0x0F, 0xFF, 0xEB, 0x0F, 0x67, 0xFF, 0x64, 0x0F, 0xFF, 0xFF, 0x0F, 0xEE};
+    static const uint8_t shifted[] = {0xFF, 0x1B, 0x0F, 0xFF, 0xC9, 0x0F, 0x88, 0xFF, 0x0F, 0x0F, 0xFF, 0x42,
+                                      0x0F, 0xFF, 0xF0, 0x0F, 0x61, 0xFF, 0x69, 0x0F, 0xFF, 0xFF, 0x0F, 0xE8};
+    PatternState state;
+    setTestMillis(1000);
+    applyPattern(leds, ledCount, PATTERN_RAINBOW, color, state);
+    assertFrame(first, "rainbow at 1000");
+
+    setTestMillis(1020);
+    applyPattern(leds, ledCount, PATTERN_RAINBOW, color, state);
+    assertFrame(shifted, "rainbow at 1020");
+}
+
+static void test_progress(void)
+{
+    static const uint8_t half[] = {0xC8, 0x64, 0x32, 0xC8, 0x64, 0x32, 0xC8, 0x64, 0x32, 0xC8, 0x64, 0x32,
+                                   0x00, 0x00, 0x0A, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x0A};
+    PatternState state;
+    applyPattern(leds, ledCount, PATTERN_PROGRESS, color, state, CRGB(0, 0, 10), 50);
+    assertFrame(half, "progress 50");
+
+    applyPattern(leds, ledCount, PATTERN_PROGRESS, color, state, CRGB(0, 0, 10), 100);
+    assertFrame(solidFrame, "progress 100");
+}
+
+static void test_heatmap(void)
+{
+    static const uint8_t heating[] = {0x15, 0xFF, 0x00, 0x15, 0xFF, 0x00, 0x15, 0xFF, 0x00, 0x15, 0xFF, 0x00,
+                                      0xFF, 0x00, 0x00, 0xFF, 0x00, 0x00, 0xFF, 0x00, 0x00, 0xFF, 0x00, 0x00};
+    PatternState state;
+    PrinterTelemetry telemetry;
+    telemetry.nozzleTemp = 1200;
+    telemetry.nozzleTarget = 2200;
+    telemetry.bedTemp = 600;
+    telemetry.bedTarget = 600;
+    applyPattern(leds, ledCount, PATTERN_HEATMAP, color, state, CRGB::Black, 0, &telemetry);
+    assertFrame(heating, "nozzle heating, bed at target");
+
+    // Without telemetry the heat map falls back to the solid colour
+    applyPattern(leds, ledCount, PATTERN_HEATMAP, color, state);
+    assertFrame(solidFrame, "no telemetry");
+}
+
+static void test_layer_pulse(void)
+{
+    static const uint8_t dim[] = {0x3F, 0x1F, 0x0F, 0x3F, 0x1F, 0x0F, 0x3F, 0x1F, 0x0F, 0x3F, 0x1F, 0x0F,
+                                  0x3F, 0x1F, 0x0F, 0x3F, 0x1F, 0x0F, 0x3F, 0x1F, 0x0F, 0x3F, 0x1F, 0x0F};
+    static const uint8_t fading[] = {0x84, 0x42, 0x21, 0x84, 0x42, 0x21, 0x84, 0x42, 0x21, 0x84, 0x42, 0x21,
+                                     0x84, 0x42, 0x21, 0x84, 0x42, 0x21, 0x84, 0x42, 0x21, 0x84, 0x42, 0x21};
+    PatternState state;
+    PrinterTelemetry telemetry;
+    telemetry.layer = 5;
+    setTestMillis(1000);
+    applyPattern(leds, ledCount, PATTERN_LAYER_PULSE, color, state, CRGB::Black, 0, &telemetry);
+    assertFrame(dim, "first layer seen");
+
+    telemetry.layer = 6;
+    setTestMillis(2000);
+    applyPattern(leds, ledCount, PATTERN_LAYER_PULSE, color, state, CRGB::Black, 0, &telemetry);
+    assertFrame(solidFrame, "layer change flashes");
+
+    setTestMillis(2300);
+    applyPattern(leds, ledCount, PATTERN_LAYER_PULSE, color, state, CRGB::Black, 0, &telemetry);
+    assertFrame(fading, "half way through the fade");
+
+    setTestMillis(2600);
+    applyPattern(leds, ledCount, PATTERN_LAYER_PULSE, color, state, CRGB::Black, 0, &telemetry);
+    assertFrame(dim, "fade done");
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_solid);
+    RUN_TEST(test_breathing);
+    RUN_TEST(test_chase);
+    RUN_TEST(test_rainbow);
+    RUN_TEST(test_progress);
+    RUN_TEST(test_heatmap);
+    RUN_TEST(test_layer_pulse);
+    return UNITY_END();
+}
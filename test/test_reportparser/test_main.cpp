@@ -0,0 +1,238 @@
+// Golden printer reports through ReportParser: JSON in, ReportDelta out
+
+#include <unity.h>
+#include "../../src/blflc/reportparser.h"
+
+static ReportParser parser;
+
+static const ReportDelta &parse(const char *json)
+{
+    parser.reset();
+    for (const char *c = json; *c; c++)
+        parser.feed(*c);
+    return parser.delta();
+}
+
+static uint32_t fields(std::initializer_list<ReportField> list)
+{
+    uint32_t present = 0;
+    for (ReportField field : list)
+        present |= 1u << field;
+    return present;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static void test_push_status(void)
+{
+    const ReportDelta &d = parse(
+        "{\"print\":{\"command\":\"push_status\",\"gcode_state\":\"RUNNING\",\"stg_cur\":2,\"mc_percent\":37,"
+        "\"home_flag\":8388608,\"lights_report\":[{\"node\":\"work_light\",\"mode\":\"off\"},"
+        "{\"node\":\"chamber_light\",\"mode\":\"on\"}],"
+        "\"hms\":[{\"attr\":201327360,\"code\":196619},{\"attr\":117448704,\"code\":196609}]}}");
+
+    TEST_ASSERT_TRUE(parser.complete());
+    TEST_ASSERT_EQUAL_HEX32(fields({FIELD_COMMAND, FIELD_GCODE_STATE, FIELD_HMS, FIELD_HOME_FLAG,
+                                    FIELD_CHAMBER_LIGHT, FIELD_STAGE, FIELD_PROGRESS}),
+                            d.present);
+    TEST_ASSERT_EQUAL_STRING("push_status", d.command);
+    TEST_ASSERT_EQUAL_STRING("RUNNING", d.gcodeState);
+    TEST_ASSERT_EQUAL_INT32(2, d.stage);
+    TEST_ASSERT_EQUAL_INT32(37, d.progress);
+    TEST_ASSERT_EQUAL_UINT32(8388608, d.homeFlag);
+    TEST_ASSERT_TRUE(d.chamberLightOn);
+    TEST_ASSERT_EQUAL_UINT8(2, d.hmsCount);
+    TEST_ASSERT_EQUAL_UINT32(201327360, d.hms[0].attr);
+    TEST_ASSERT_EQUAL_UINT32(196619, d.hms[0].code);
+    TEST_ASSERT_EQUAL_UINT32(117448704, d.hms[1].attr);
+    TEST_ASSERT_EQUAL_UINT32(196609, d.hms[1].code);
+}
+
+static void test_partial_report(void)
+{
+    const ReportDelta &d = parse("{\"print\":{\"mc_percent\":50}}");
+
+    TEST_ASSERT_TRUE(parser.complete());
+    TEST_ASSERT_EQUAL_HEX32(fields({FIELD_PROGRESS}), d.present);
+    TEST_ASSERT_EQUAL_INT32(50, d.progress);
+}
+
+static void test_system_command(void)
+{
+    const ReportDelta &d = parse(
+        "{\"system\":{\"command\":\"ledctrl\",\"led_node\":\"chamber_light\",\"led_mode\":\"off\"}}");
+
+    TEST_ASSERT_EQUAL_HEX32(fields({FIELD_SYSTEM_COMMAND, FIELD_LED_MODE}), d.present);
+    TEST_ASSERT_EQUAL_STRING("ledctrl", d.systemCommand);
+    TEST_ASSERT_FALSE(d.ledModeOn);
+}
+
+static void test_telemetry(void)
+{
+    const ReportDelta &d = parse(
+        "{\"print\":{\"nozzle_temper\":219.84,\"nozzle_target_temper\":220,\"bed_temper\":\"60.5\","
+        "\"bed_target_temper\":-0.04,\"layer_num\":70000,\"total_layer_num\":500,\"mc_remaining_time\":119}}");
+
+    TEST_ASSERT_EQUAL_HEX32(TELEMETRY_FIELDS, d.present);
+    TEST_ASSERT_EQUAL_INT16(2198, d.nozzleTemp);
+    TEST_ASSERT_EQUAL_INT16(2200, d.nozzleTarget);
+    TEST_ASSERT_EQUAL_INT16(605, d.bedTemp);
+    TEST_ASSERT_EQUAL_INT16(0, d.bedTarget);
+    TEST_ASSERT_EQUAL_UINT16(65535, d.layer);
+    TEST_ASSERT_EQUAL_UINT16(500, d.totalLayers);
+    TEST_ASSERT_EQUAL_UINT16(119, d.remainingMin);
+}
+
+// Values far outside int64 / float range are clamped, nan is dropped
+static void test_telemetry_out_of_range(void)
+{
+    const ReportDelta &d = parse(
+        "{\"print\":{\"command\":\"push_status\",\"nozzle_temper\":2159223372036854775,"
+        "\"bed_temper\":-2159223372036854775.9,\"nozzle_target_temper\":\"1e39\",\"bed_target_temper\":\"nan\","
+        "\"layer_num\":\"-inf\",\"total_layer_num\":\"99999999999999999999999\","
+        "\"mc_remaining_time\":9223372036854775807}}");
+
+    TEST_ASSERT_TRUE(parser.complete());
+    TEST_ASSERT_FALSE(d.has(FIELD_BED_TARGET));
+    TEST_ASSERT_EQUAL_INT16(32767, d.nozzleTemp);
+    TEST_ASSERT_EQUAL_INT16(32767, d.nozzleTarget);
+    TEST_ASSERT_EQUAL_INT16(-32768, d.bedTemp);
+    TEST_ASSERT_EQUAL_UINT16(0, d.layer);
+    TEST_ASSERT_EQUAL_UINT16(65535, d.totalLayers);
+    TEST_ASSERT_EQUAL_UINT16(65535, d.remainingMin);
+}
+
+static void test_ams_trays(void)
+{
+    const ReportDelta &d = parse(
+        "{\"print\":{\"ams\":{\"ams\":[{\"id\":\"1\",\"tray\":[{\"id\":\"2\",\"tray_color\":\"FF0000FF\"},{\"id\":\"3\"}]}],"
+        "\"tray_now\":\"6\"},\"vt_tray\":{\"id\":\"254\",\"tray_color\":\"00FF00FF\"}}}");
+
+    TEST_ASSERT_EQUAL_HEX32(fields({FIELD_AMS_TRAYS, FIELD_TRAY_NOW}), d.present);
+    TEST_ASSERT_EQUAL_UINT8(6, d.trayNow);
+    // Tray 3 has no color and is left out
+    TEST_ASSERT_EQUAL_UINT8(2, d.trayCount);
+    TEST_ASSERT_EQUAL_UINT8(1 * 4 + 2, d.trays[0].id);
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000FF, d.trays[0].color);
+    TEST_ASSERT_EQUAL_UINT8(TRAY_EXTERNAL, d.trays[1].id);
+    TEST_ASSERT_EQUAL_HEX32(0x00FF00FF, d.trays[1].color);
+}
+
+// Only the listed key paths count: nested keys of the same name are skipped
+static void test_unknown_keys(void)
+{
+    const ReportDelta &d = parse(
+        "{\"print\":{\"gcode_file\":\"a\\\"b\\u00e9\",\"x\":{\"gcode_state\":\"FAILED\",\"stg_cur\":5},"
+        "\"list\":[[1,2],{\"mc_percent\":9}],\"gcode_state\":\"PAUSE\"}}");
+
+    TEST_ASSERT_TRUE(parser.complete());
+    TEST_ASSERT_EQUAL_HEX32(fields({FIELD_GCODE_STATE}), d.present);
+    TEST_ASSERT_EQUAL_STRING("PAUSE", d.gcodeState);
+}
+
+static void test_malformed(void)
+{
+    parse("{\"print\":{\"gcode_state\":\"RUN");
+    TEST_ASSERT_FALSE(parser.complete());
+    TEST_ASSERT_FALSE(parser.failed());
+
+    parse("{\"print\":]");
+    TEST_ASSERT_TRUE(parser.failed());
+
+    parse("{\"print\":{}} trailing");
+    TEST_ASSERT_FALSE(parser.complete());
+}
+
+// Reports with the same LED relevant values have the same fingerprint
+static void test_fingerprint(void)
+{
+    parse("{\"print\":{\"gcode_state\":\"RUNNING\",\"stg_cur\":0,\"nozzle_temper\":200}}");
+    uint32_t printing = parser.fingerprint();
+
+    parse("{\"print\":{\"gcode_state\":\"RUNNING\",\"stg_cur\":0,\"nozzle_temper\":210}}");
+    TEST_ASSERT_EQUAL_HEX32_MESSAGE(printing, parser.fingerprint(), "telemetry changed");
+
+    parse("{\"print\":{\"gcode_state\":\"RUNNING\",\"stg_cur\":1,\"nozzle_temper\":210}}");
+    TEST_ASSERT_TRUE_MESSAGE(parser.fingerprint() != printing, "stage changed");
+
+    // The same keys and values under another parent are a different report
+    parse("{\"print\":{\"vt_tray\":{\"id\":\"254\",\"tray_color\":\"FF0000FF\"}}}");
+    uint32_t external = parser.fingerprint();
+    parse("{\"print\":{\"ams\":{\"ams\":[{\"tray\":[{\"id\":\"254\",\"tray_color\":\"FF0000FF\"}]}]}}}");
+    TEST_ASSERT_TRUE_MESSAGE(parser.fingerprint() != external, "vt_tray vs AMS tray");
+
+    parse("{\"print\":{\"ams\":{\"ams\":[{\"tray\":[{\"id\":\"0\",\"tray_color\":\"FF0000FF\"}]},{\"tray\":[]}]}}}");
+    uint32_t firstUnit = parser.fingerprint();
+    parse("{\"print\":{\"ams\":{\"ams\":[{\"tray\":[]},{\"tray\":[{\"id\":\"0\",\"tray_color\":\"FF0000FF\"}]}]}}}");
+    TEST_ASSERT_TRUE_MESSAGE(parser.fingerprint() != firstUnit, "tray in another AMS unit");
+
+    parse("{\"print\":{\"stg_cur\":0}}");
+    uint32_t noHms = parser.fingerprint();
+    parse("{\"print\":{\"stg_cur\":0,\"hms\":[]}}");
+    TEST_ASSERT_TRUE_MESSAGE(parser.fingerprint() != noHms, "empty hms list");
+}
+
+static void feed(ReportStream &stream, const char *json)
+{
+    stream.reset();
+    for (const char *c = json; *c; c++)
+        stream.write(*c);
+    TEST_ASSERT_TRUE(stream.endMessage());
+}
+
+// A light command the printer did not honour: the light was switched locally
+// while the report was processed, so the identical next report, which still
+// has the light off, must not be skipped
+static void test_forget_while_processing(void)
+{
+    static const char *lightOff =
+        "{\"print\":{\"lights_report\":[{\"node\":\"chamber_light\",\"mode\":\"off\"}]}}";
+    ReportStream stream;
+
+    feed(stream, lightOff);
+    TEST_ASSERT_FALSE(stream.isDuplicate());
+    stream.acceptReport();
+    feed(stream, lightOff);
+    TEST_ASSERT_TRUE_MESSAGE(stream.isDuplicate(), "repeated report");
+
+    feed(stream, "{\"print\":{\"stg_cur\":0}}");
+    stream.forgetReport();
+    stream.acceptReport();
+    feed(stream, lightOff);
+    TEST_ASSERT_FALSE(stream.isDuplicate());
+    stream.forgetReport();
+    stream.acceptReport();
+    feed(stream, lightOff);
+    TEST_ASSERT_FALSE_MESSAGE(stream.isDuplicate(), "light forced on while processed");
+
+    // Forgetting between reports does not keep the next one from being remembered
+    stream.acceptReport();
+    stream.forgetReport();
+    feed(stream, lightOff);
+    TEST_ASSERT_FALSE(stream.isDuplicate());
+    stream.acceptReport();
+    feed(stream, lightOff);
+    TEST_ASSERT_TRUE_MESSAGE(stream.isDuplicate(), "remembered after forgetting");
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_push_status);
+    RUN_TEST(test_partial_report);
+    RUN_TEST(test_system_command);
+    RUN_TEST(test_telemetry);
+    RUN_TEST(test_telemetry_out_of_range);
+    RUN_TEST(test_ams_trays);
+    RUN_TEST(test_unknown_keys);
+    RUN_TEST(test_malformed);
+    RUN_TEST(test_fingerprint);
+    RUN_TEST(test_forget_while_processing);
+    return UNITY_END();
+}